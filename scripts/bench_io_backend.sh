@@ -0,0 +1,95 @@
+#!/bin/bash
+# Сравнение сборок game_server с epoll и io_uring под нагрузкой game_bots при разном числе соединений.
+# Запуск из каталога сборки, собранной с -DGAME_SERVER_IO_URING=ON:
+#   ../scripts/bench_io_backend.sh [число ботов...]
+# Переменные окружения BIN_DIR, RESULTS_DIR, DURATION, TICK_PERIOD и BACKENDS (по умолчанию "epoll io_uring")
+# меняют каталог программ, каталог результатов, длительность прогона, период тика и набор механизмов.
+# Для каждого механизма и числа ботов в каталог results (или $RESULTS_DIR) сохраняются вывод game_bots
+# и метрики сервера, а в конце печатается сводка: пропускная способность, перцентили задержки запросов
+# состояния, процессорное время сервера (пользовательское и системное) и отставание цикла событий.
+set -euo pipefail
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BIN_DIR=${BIN_DIR:-bin}
+RESULTS_DIR=${RESULTS_DIR:-results}
+DURATION=${DURATION:-30}
+TICK_PERIOD=${TICK_PERIOD:-50}
+BACKENDS=${BACKENDS:-epoll io_uring}
+PORT=8080
+BOTS=("$@")
+if [ ${#BOTS[@]} -eq 0 ]; then
+    BOTS=(1000 10000 30000)
+fi
+
+binaries=(game_server game_bots)
+if [[ " $BACKENDS " == *" io_uring "* ]]; then
+    binaries+=(game_server_uring)
+fi
+for binary in "${binaries[@]}"; do
+    if [ ! -x "$BIN_DIR/$binary" ]; then
+        echo "$BIN_DIR/$binary not found: build with -DGAME_SERVER_IO_URING=ON" >&2
+        exit 1
+    fi
+done
+
+# Каждый бот держит одно соединение
+ulimit -n 65536 2>/dev/null || ulimit -n "$(ulimit -Hn)"
+mkdir -p "$RESULTS_DIR"
+CLOCK_TICKS=$(getconf CLK_TCK)
+
+# Процессорное время процесса в секундах: "<пользовательское> <системное>"
+cpu_seconds() {
+    awk -v hz="$CLOCK_TICKS" '{ sub(/^.*\) /, ""); printf "%.2f %.2f\n", $12 / hz, $13 / hz }' "/proc/$1/stat"
+}
+
+wait_for_server() {
+    for _ in $(seq 50); do
+        if curl -s -o /dev/null "127.0.0.1:$PORT/api/v1/maps"; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo "server did not start" >&2
+    return 1
+}
+
+printf "%-9s %6s %14s %12s %12s %8s %8s %16s\n" \
+    backend bots throughput_rps state_p99_us state_max_us user_s sys_s loop_lag_max_le_s
+for bots in "${BOTS[@]}"; do
+    for backend in $BACKENDS; do
+        name="${backend}_${bots}"
+        "$BIN_DIR/game_server" "$SOURCE_DIR/data/config.json" "$SOURCE_DIR/static/" \
+            --tick-period "$TICK_PERIOD" --io-backend "$backend" --io-backend-strict \
+            > "$RESULTS_DIR/server_$name.log" 2>&1 &
+        server=$!
+        wait_for_server
+        before=$(cpu_seconds "$server")
+        "$BIN_DIR/game_bots" --bots "$bots" --duration "$DURATION" --action-rate 2 --state-rate 5 \
+            --tick-period "$TICK_PERIOD" > "$RESULTS_DIR/bots_$name.txt"
+        after=$(cpu_seconds "$server")
+        curl -s "127.0.0.1:$PORT/api/v1/metrics" > "$RESULTS_DIR/metrics_$name.txt"
+        kill -INT "$server"
+        wait "$server" || true
+
+        throughput=$(grep -o 'throughput_rps=[0-9.e+]*' "$RESULTS_DIR/bots_$name.txt" | cut -d= -f2)
+        state_p99=$(grep '^state:' "$RESULTS_DIR/bots_$name.txt" | grep -o 'p99_us=[0-9.e+]*' | cut -d= -f2)
+        state_max=$(grep '^state:' "$RESULTS_DIR/bots_$name.txt" | grep -o 'max_us=[0-9.e+]*' | cut -d= -f2)
+        read -r user sys <<< "$(echo "$before $after" | awk '{ printf "%.2f %.2f", $3 - $1, $4 - $2 }')"
+        # Наибольшее отставание цикла событий с точностью до корзины гистограммы: для каждого потока
+        # берётся граница корзины, на которой счётчик растёт в последний раз
+        lag=$(awk '/^game_loop_lag_seconds_bucket/ {
+                series = substr($0, 1, index($0, ",le=") - 1)
+                match($0, /le="[^"]*"/); le = substr($0, RSTART + 4, RLENGTH - 5)
+                if ($NF + 0 > count[series]) { count[series] = $NF + 0; bound[series] = le }
+            }
+            END {
+                for (series in bound) {
+                    if (bound[series] == "+Inf") { max = "+Inf"; break }
+                    if (bound[series] + 0 > max + 0) max = bound[series]
+                }
+                print (max == "" ? 0 : max)
+            }' "$RESULTS_DIR/metrics_$name.txt")
+        printf "%-9s %6s %14s %12s %12s %8s %8s %16s\n" "$backend" "$bots" "$throughput" \
+            "$state_p99" "$state_max" "$user" "$sys" "$lag"
+    done
+done
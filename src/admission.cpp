@@ -0,0 +1,212 @@
+#include "admission.h"
+
+#include <algorithm>
+
+#include "metrics.h"
+
+namespace admission
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        constexpr std::int64_t WINDOW_NS = std::chrono::nanoseconds{ 100ms }.count();
+
+        std::int64_t NowNs() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        std::string MakeRejection(std::chrono::seconds retry_after)
+        {
+            const std::string body = R"({"code": "serviceUnavailable", "message": "Server is overloaded"})"s;
+            return "HTTP/1.1 503 Service Unavailable\r\n"s
+                + "Content-Type: application/json\r\n"s
+                + "Cache-Control: no-cache\r\n"s
+                + "Retry-After: "s + std::to_string(retry_after.count()) + "\r\n"s
+                + "Content-Length: "s + std::to_string(body.size()) + "\r\n"s
+                + "Connection: close\r\n\r\n"s
+                + body;
+        }
+    }  // namespace
+
+    //------------------Controller----------------
+    Controller::Controller(const Limits& limits)
+        : limits_{ limits }
+        , min_limit_{ std::max<std::size_t>(1, limits.max_in_flight / 10) }
+        , rejection_{ MakeRejection(limits.retry_after) }
+        , limit_{ limits.max_in_flight }
+    {
+        metrics::SetInFlightLimit(limits.max_in_flight);
+    }
+
+    bool Controller::AcceptOrPause(std::function<void()> resume)
+    {
+        if (limits_.max_connections == 0)
+        {
+            return true;
+        }
+        std::lock_guard lock{ accept_mutex_ };
+        // Флаг ставится до проверки числа соединений: закрытие, которое его не увидело,
+        // уже уменьшило число соединений, и проверка это учтёт
+        accept_paused_.store(true);
+        if (connections_.load() < limits_.max_connections)
+        {
+            accept_paused_.store(false);
+            return true;
+        }
+        resume_ = std::move(resume);
+        metrics::CountAcceptPaused();
+        return false;
+    }
+
+    void Controller::ConnectionOpened() noexcept
+    {
+        connections_.fetch_add(1);
+    }
+
+    void Controller::ConnectionClosed()
+    {
+        connections_.fetch_sub(1);
+        if (!accept_paused_.load())
+        {
+            return;
+        }
+        std::function<void()> resume;
+        {
+            std::lock_guard lock{ accept_mutex_ };
+            if (!resume_ || connections_.load() >= limits_.max_connections)
+            {
+                return;
+            }
+            resume = std::move(resume_);
+            resume_ = nullptr;
+            accept_paused_.store(false);
+        }
+        resume();
+    }
+
+    bool Controller::TryStartRequest() noexcept
+    {
+        if (limits_.max_in_flight == 0)
+        {
+            return true;
+        }
+        const std::size_t limit = limit_.load(std::memory_order_relaxed);
+        const std::size_t in_flight = in_flight_.fetch_add(1, std::memory_order_relaxed);
+        if (in_flight + 1 >= limit)
+        {
+            saturated_.store(true, std::memory_order_relaxed);
+        }
+        if (in_flight >= limit)
+        {
+            in_flight_.fetch_sub(1, std::memory_order_relaxed);
+            metrics::CountShed();
+            return false;
+        }
+        return true;
+    }
+
+    void Controller::RequestStarted(std::chrono::nanoseconds wait) noexcept
+    {
+        if (limits_.target_delay == 0ms)
+        {
+            return;
+        }
+        window_count_.fetch_add(1, std::memory_order_relaxed);
+        window_sum_ns_.fetch_add(static_cast<std::uint64_t>(std::max<std::int64_t>(wait.count(), 0)),
+            std::memory_order_relaxed);
+        Adjust(NowNs());
+    }
+
+    void Controller::RequestFinished() noexcept
+    {
+        if (limits_.max_in_flight != 0)
+        {
+            in_flight_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Controller::Adjust(std::int64_t now_ns) noexcept
+    {
+        std::int64_t end = window_end_ns_.load(std::memory_order_relaxed);
+        // Окно закрывает один поток: тот, кто первым сдвинул его конец
+        if (now_ns < end || !window_end_ns_.compare_exchange_strong(end, now_ns + WINDOW_NS, std::memory_order_relaxed))
+        {
+            return;
+        }
+        const std::uint64_t count = window_count_.exchange(0, std::memory_order_relaxed);
+        const std::uint64_t sum = window_sum_ns_.exchange(0, std::memory_order_relaxed);
+        const bool saturated = saturated_.exchange(false, std::memory_order_relaxed);
+        if (count == 0)
+        {
+            return;
+        }
+        const std::uint64_t delay = sum / count;
+        std::size_t limit = limit_.load(std::memory_order_relaxed);
+        if (delay > static_cast<std::uint64_t>(std::chrono::nanoseconds{ limits_.target_delay }.count()))
+        {
+            limit = std::max(min_limit_, limit - std::max<std::size_t>(1, limit / 10));
+        }
+        else if (saturated)
+        {
+            limit = std::min(limits_.max_in_flight, limit + std::max<std::size_t>(1, limit / 16));
+        }
+        else
+        {
+            return;
+        }
+        limit_.store(limit, std::memory_order_relaxed);
+        metrics::SetInFlightLimit(limit);
+    }
+
+    void Controller::Stop()
+    {
+        std::lock_guard lock{ accept_mutex_ };
+        resume_ = nullptr;
+        accept_paused_.store(false);
+    }
+
+    //------------------Gate----------------
+    Gate::Gate(Controller* controller) noexcept
+        : controller_{ controller }
+    {
+        if (controller_)
+        {
+            controller_->ConnectionOpened();
+        }
+    }
+
+    Gate::~Gate()
+    {
+        if (controller_)
+        {
+            Complete();
+            controller_->ConnectionClosed();
+        }
+    }
+
+    bool Gate::Admit() noexcept
+    {
+        if (!controller_)
+        {
+            return true;
+        }
+        if (!controller_->TryStartRequest())
+        {
+            return false;
+        }
+        active_ = true;
+        return true;
+    }
+
+    void Gate::Complete() noexcept
+    {
+        if (active_)
+        {
+            active_ = false;
+            controller_->RequestFinished();
+        }
+    }
+}  // namespace admission
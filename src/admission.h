@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace admission
+{
+    struct Limits
+    {
+        // Открытые HTTP-соединения. При достижении предела сервер перестаёт принимать соединения, 0 - без предела
+        std::size_t max_connections = 0;
+        // Запросы, прочитанные и ещё не получившие ответа. Сверх предела запрос получает ответ 503, 0 - без предела
+        std::size_t max_in_flight = 0;
+        // Допустимая задержка запросов в очередях. Если она не 0, предел запросов подстраивается в диапазоне
+        // от max_in_flight / 10 до max_in_flight
+        std::chrono::milliseconds target_delay{ 0 };
+        // Значение заголовка Retry-After ответа 503
+        std::chrono::seconds retry_after{ 1 };
+    };
+
+    // Допуск соединений и запросов. Потоки ввода-вывода обращаются к нему без блокировок, кроме приостановки
+    // и возобновления приёма соединений.
+    // Задержка в очередях - измеренное время ожидания запросов в очередях планировщика, api strand и пула,
+    // усреднённое по окну в 100 мс. Если она больше target_delay, предел уменьшается на 10%, а если за окно
+    // предел был исчерпан и задержка в норме - увеличивается на 1/16
+    class Controller
+    {
+    public:
+        explicit Controller(const Limits& limits);
+
+        Controller(const Controller&) = delete;
+        Controller& operator=(const Controller&) = delete;
+
+        // Разрешает принять следующее соединение. Иначе сохраняет resume: его вызовет закрытие соединения,
+        // после которого число соединений опустится ниже предела
+        bool AcceptOrPause(std::function<void()> resume);
+
+        void ConnectionOpened() noexcept;
+
+        void ConnectionClosed();
+
+        // Допускает запрос к обработке. false - предел исчерпан, запрос получает Rejection()
+        bool TryStartRequest() noexcept;
+
+        // Допущенный запрос начал обрабатываться, прождав в очередях wait
+        void RequestStarted(std::chrono::nanoseconds wait) noexcept;
+
+        // Ответ на допущенный запрос готов
+        void RequestFinished() noexcept;
+
+        // Заранее сформированный ответ 503 с заголовками Retry-After и Connection: close
+        std::string_view Rejection() const noexcept
+        {
+            return rejection_;
+        }
+
+        // Отменяет ожидание приёма соединений. Вызывается после остановки io_context:
+        // ожидающий обработчик владеет приёмником соединений
+        void Stop();
+
+    private:
+        Limits limits_;
+        std::size_t min_limit_;
+        std::string rejection_;
+
+        std::atomic<std::size_t> connections_{ 0 };
+        std::atomic<std::size_t> in_flight_{ 0 };
+        std::atomic<std::size_t> limit_;
+        // Предел запросов был исчерпан в текущем окне
+        std::atomic<bool> saturated_{ false };
+
+        std::atomic<std::int64_t> window_end_ns_{ 0 };
+        std::atomic<std::uint64_t> window_count_{ 0 };
+        std::atomic<std::uint64_t> window_sum_ns_{ 0 };
+
+        std::mutex accept_mutex_;
+        std::atomic<bool> accept_paused_{ false };
+        std::function<void()> resume_;
+
+        void Adjust(std::int64_t now_ns) noexcept;
+    };
+
+    // Соединение и его текущий запрос в Controller. Без Controller допускает всё
+    class Gate
+    {
+    public:
+        explicit Gate(Controller* controller) noexcept;
+        ~Gate();
+
+        Gate(const Gate&) = delete;
+        Gate& operator=(const Gate&) = delete;
+
+        bool Admit() noexcept;
+
+        // Ответ на запрос сформирован. Запросы, прошедшие мимо Admit, не учитываются
+        void Complete() noexcept;
+
+        std::string_view Rejection() const noexcept
+        {
+            return controller_->Rejection();
+        }
+
+    private:
+        Controller* controller_;
+        bool active_ = false;
+    };
+}  // namespace admission
@@ -0,0 +1,133 @@
+#include "application.h"
+
+#include <stdexcept>
+
+namespace app
+{
+    std::optional<JoinResult> Application::JoinGame(std::string user_name, const model::Map::Id& map_id)
+    {
+        model::GameSession* session = game_.GetSession(map_id);
+        if (!session)
+        {
+            return std::nullopt;
+        }
+        const model::Dog& dog = session->AddDog(std::move(user_name));
+        return AddPlayer(*session, dog, std::nullopt);
+    }
+
+    std::optional<JoinResult> Application::JoinGame(std::string user_name, const model::Map::Id& map_id, Token token)
+    {
+        model::GameSession* session = game_.GetSession(map_id);
+        if (!session)
+        {
+            return std::nullopt;
+        }
+        const model::Dog& dog = session->AddDog(std::move(user_name));
+        return AddPlayer(*session, dog, std::move(token));
+    }
+
+    std::optional<JoinResult> Application::AddPlayer(model::GameSession& session, const model::Dog& dog,
+        std::optional<Token> token)
+    {
+        const Player& player = token ? players_.Add(std::move(*token), session, dog.GetId())
+                                     : players_.Add(session, dog);
+        for (ActionJournal* journal : journals_)
+        {
+            journal->OnJoin(player.GetToken(), dog.GetName(), session.GetMap().GetId());
+        }
+        return JoinResult{ player.GetToken(), player.GetId() };
+    }
+
+    void Application::MovePlayer(const Player& player, std::optional<model::Direction> direction)
+    {
+        model::GameSession& session = player.GetSession();
+        if (model::Dog* dog = session.FindDog(player.GetId()))
+        {
+            session.SetDogDirection(*dog, direction);
+            for (ActionJournal* journal : journals_)
+            {
+                journal->OnMove(player.GetToken(), direction);
+            }
+        }
+    }
+
+    void Application::CaptureSnapshot(ApplicationSnapshot& snapshot) const
+    {
+        const auto& sessions = game_.GetSessions();
+        snapshot.sessions.resize(sessions.size());
+        for (size_t i = 0; i < sessions.size(); ++i)
+        {
+            sessions[i].CaptureSnapshot(snapshot.sessions[i]);
+        }
+
+        snapshot.next_record_id = next_record_id_;
+        const auto& players = players_.GetPlayers();
+        snapshot.players.resize(players.size());
+        for (size_t i = 0; i < players.size(); ++i)
+        {
+            PlayerSnapshot& record = snapshot.players[i];
+            record.token = players[i].GetToken();
+            record.map_id = players[i].GetSession().GetMap().GetId();
+            record.dog_id = players[i].GetId();
+        }
+    }
+
+    void Application::Restore(const ApplicationSnapshot& snapshot)
+    {
+        for (const auto& session_snapshot : snapshot.sessions)
+        {
+            model::GameSession* session = game_.GetSession(session_snapshot.map_id);
+            if (!session)
+            {
+                throw std::invalid_argument("Snapshot refers to unknown map " + *session_snapshot.map_id);
+            }
+            session->Restore(session_snapshot);
+        }
+        for (const auto& record : snapshot.players)
+        {
+            model::GameSession* session = game_.GetSession(record.map_id);
+            if (!session || !session->FindDog(record.dog_id))
+            {
+                throw std::invalid_argument("Snapshot refers to unknown dog of player " + *record.token);
+            }
+            players_.Add(record.token, *session, record.dog_id);
+        }
+        next_record_id_ = snapshot.next_record_id;
+    }
+
+    void Application::Tick(std::chrono::milliseconds delta)
+    {
+        game_.Tick(std::chrono::duration<double>(delta).count());
+        RetireDogs();
+        for (ActionJournal* journal : journals_)
+        {
+            journal->OnTick(delta);
+        }
+        for (ApplicationListener* listener : listeners_)
+        {
+            listener->OnTick(delta);
+        }
+    }
+
+    void Application::RetireDogs()
+    {
+        bool retired = false;
+        for (const model::GameSession& session : game_.GetSessions())
+        {
+            for (const model::Dog& dog : session.GetRetiredDogs())
+            {
+                players_.RemoveByDog(session, dog.GetId());
+                const std::uint64_t id = next_record_id_++;
+                if (records_)
+                {
+                    records_->Add({ id, dog.GetName(), dog.GetScore(), dog.GetPlayTime() });
+                }
+                retired = true;
+            }
+        }
+        if (retired && records_)
+        {
+            records_->Commit();
+        }
+    }
+}  // namespace app
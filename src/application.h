@@ -0,0 +1,175 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "model.h"
+#include "players.h"
+
+namespace app
+{
+    struct JoinResult
+    {
+        Token token;
+        model::Dog::Id player_id;
+    };
+
+    struct PlayerSnapshot
+    {
+        Token token{ std::string{} };
+        model::Map::Id map_id{ std::string{} };
+        model::Dog::Id dog_id{ 0u };
+    };
+
+    // Копия состояния игры на границе тика: игровые сеансы и игроки
+    struct ApplicationSnapshot
+    {
+        std::vector<model::GameSessionSnapshot> sessions;
+        std::vector<PlayerSnapshot> players;
+        // Номер последней записи журнала действий, уже учтённой в снимке
+        std::uint64_t journal_sequence = 0;
+        // Номер, который получит следующий рекорд
+        std::uint64_t next_record_id = 1;
+    };
+
+    // Итог игры собаки, покинувшей игру. Номера рекордов возрастают в порядке ухода собак
+    // и не зависят от того, ушла собака в обычной работе или при воспроизведении журнала
+    struct PlayerRecord
+    {
+        std::uint64_t id = 0;
+        std::string name;
+        int score = 0;
+        std::chrono::milliseconds play_time{};
+    };
+
+    // Хранилище рекордов. Вызывается в том же потоке, что и Application
+    class RecordsSink
+    {
+    public:
+        // Рекорд с уже известным хранилищу номером должен игнорироваться:
+        // так при воспроизведении журнала не появляются дубликаты
+        virtual void Add(const PlayerRecord& record) = 0;
+
+        // Вызывается после добавления всех рекордов тика
+        virtual void Commit() = 0;
+
+        // Номер последнего рекорда в хранилище, 0 - рекордов нет
+        virtual std::uint64_t GetLastId() const noexcept = 0;
+
+    protected:
+        ~RecordsSink() = default;
+    };
+
+    // Журнал принятых действий. Вызывается после применения действия, в том же потоке, что и Application.
+    // OnTick вызывается, когда тик полностью применён, включая уход собак из игры
+    class ActionJournal
+    {
+    public:
+        virtual void OnJoin(const Token& token, std::string_view user_name, const model::Map::Id& map_id) = 0;
+
+        virtual void OnMove(const Token& token, std::optional<model::Direction> direction) = 0;
+
+        virtual void OnTick(std::chrono::milliseconds delta) = 0;
+
+    protected:
+        ~ActionJournal() = default;
+    };
+
+    // Получает уведомления о событиях игры. Вызывается в том же потоке, что и Application
+    class ApplicationListener
+    {
+    public:
+        virtual void OnTick(std::chrono::milliseconds delta) = 0;
+
+    protected:
+        ~ApplicationListener() = default;
+    };
+
+    // Сценарии использования игры: вход игрока, управление собакой, игровые тики.
+    // Не потокобезопасен: все вызовы должны выполняться последовательно (в api strand)
+    class Application
+    {
+    public:
+        explicit Application(model::Game& game) noexcept
+            : game_{ game }
+        {}
+
+        Application(const Application&) = delete;
+        Application& operator=(const Application&) = delete;
+
+        const model::Game& GetGame() const noexcept
+        {
+            return game_;
+        }
+
+        // Добавляет на карту собаку нового игрока. std::nullopt, если карта не найдена
+        std::optional<JoinResult> JoinGame(std::string user_name, const model::Map::Id& map_id);
+
+        // Вход игрока с заранее известным токеном, например при воспроизведении журнала
+        std::optional<JoinResult> JoinGame(std::string user_name, const model::Map::Id& map_id, Token token);
+
+        Player* FindPlayer(const Token& token) noexcept
+        {
+            return players_.FindByToken(token);
+        }
+
+        // Задаёт направление движения собаки игрока. std::nullopt останавливает собаку
+        void MovePlayer(const Player& player, std::optional<model::Direction> direction);
+
+        void Tick(std::chrono::milliseconds delta);
+
+        // Копирует состояние игры в snapshot, переиспользуя уже выделенную в нём память.
+        // Выполняется в api strand между тиками, поэтому снимок согласован
+        void CaptureSnapshot(ApplicationSnapshot& snapshot) const;
+
+        // Восстанавливает игру из снимка. Вызывается до начала обработки запросов
+        void Restore(const ApplicationSnapshot& snapshot);
+
+        void AddListener(ApplicationListener& listener)
+        {
+            listeners_.push_back(&listener);
+        }
+
+        // Действия записываются в журналы раньше, чем о тике узнают слушатели,
+        // поэтому снимок, сделанный слушателем, учитывает все записи журнала до текущей
+        void AddJournal(ActionJournal& journal)
+        {
+            journals_.push_back(&journal);
+        }
+
+        // Собаки, покинувшие игру, удаляются вместе с игроками, а их итоги передаются в records.
+        // Номера рекордов продолжают номера, уже сохранённые в records
+        void SetRecords(RecordsSink* records) noexcept
+        {
+            records_ = records;
+            ContinueRecordIds();
+        }
+
+        // Продолжает нумерацию рекордов после последнего номера в хранилище. Restore возвращает нумерацию
+        // снимка, чтобы воспроизведённый журнал повторил номера уже сохранённых рекордов и хранилище
+        // пропустило их, поэтому вызывается после восстановления снимка и воспроизведения журнала
+        void ContinueRecordIds() noexcept
+        {
+            if (records_)
+            {
+                next_record_id_ = std::max(next_record_id_, records_->GetLastId() + 1);
+            }
+        }
+
+    private:
+        model::Game& game_;
+        Players players_;
+        std::vector<ApplicationListener*> listeners_;
+        std::vector<ActionJournal*> journals_;
+        RecordsSink* records_ = nullptr;
+        std::uint64_t next_record_id_ = 1;
+
+        void RetireDogs();
+
+        std::optional<JoinResult> AddPlayer(model::GameSession& session, const model::Dog& dog, std::optional<Token> token);
+    };
+}  // namespace app
@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace serialization
+{
+    constexpr std::uint64_t FNV1A_OFFSET = 0xCBF29CE484222325ull;
+
+    // FNV-1a, контрольная сумма снимков и записей журнала. Передав результат предыдущего вызова
+    // в hash, можно вычислить сумму данных, разбитых на части
+    inline std::uint64_t Fnv1a(std::string_view data, std::uint64_t hash = FNV1A_OFFSET) noexcept
+    {
+        for (const char c : data)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    // Дописывает значения в строку в порядке байтов машины. Строки и массивы - с 32-битной длиной впереди
+    class BinaryWriter
+    {
+    public:
+        explicit BinaryWriter(std::string& out) noexcept
+            : out_{ out }
+        {}
+
+        template <typename T>
+        void Pod(T value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            out_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void Size(size_t size)
+        {
+            if (size > UINT32_MAX)
+            {
+                throw std::length_error("Serialized container is too large");
+            }
+            Pod(static_cast<std::uint32_t>(size));
+        }
+
+        void String(std::string_view str)
+        {
+            Size(str.size());
+            out_.append(str);
+        }
+
+        // Массив пишется одним блоком без префикса: длина должна быть записана отдельно
+        void Doubles(const std::vector<double>& values)
+        {
+            out_.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+        }
+
+    private:
+        std::string& out_;
+    };
+
+    // Читает значения, записанные BinaryWriter. Бросает std::runtime_error, если данных не хватает
+    class BinaryReader
+    {
+    public:
+        explicit BinaryReader(std::string_view data) noexcept
+            : data_{ data }
+        {}
+
+        template <typename T>
+        T Pod()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            T value;
+            std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+            return value;
+        }
+
+        size_t Size()
+        {
+            return Pod<std::uint32_t>();
+        }
+
+        std::string String()
+        {
+            const size_t size = Size();
+            return std::string{ Take(size) };
+        }
+
+        void Doubles(std::vector<double>& values, size_t count)
+        {
+            const std::string_view bytes = Take(count * sizeof(double));
+            values.resize(count);
+            std::memcpy(values.data(), bytes.data(), bytes.size());
+        }
+
+        std::string_view Take(size_t size)
+        {
+            if (size > data_.size())
+            {
+                throw std::runtime_error("Unexpected end of serialized data");
+            }
+            const std::string_view result = data_.substr(0, size);
+            data_.remove_prefix(size);
+            return result;
+        }
+
+        bool AtEnd() const noexcept
+        {
+            return data_.empty();
+        }
+
+        size_t Remaining() const noexcept
+        {
+            return data_.size();
+        }
+
+    private:
+        std::string_view data_;
+    };
+}  // namespace serialization
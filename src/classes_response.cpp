@@ -19,13 +19,18 @@ namespace classes_response
 		res.insert(http::field::content_type, ContentType::APPLICATION_JSON);
 	}
 
+	bool Response::HasBody(http::verb method) const noexcept
+	{
+		return method == http::verb::get;
+	}
+
 	StringResponse Response::GetStringResponse(const TypeClassResponse& req) const noexcept
 	{
 		StringResponse res;
 		res.version(11);
 		res.result(GetStatus());
 		SetContentType(res);
-		if (req.method == http::verb::get)
+		if (HasBody(req.method))
 		{
 			http::string_body::value_type str_body{ MakeStringResponse(req.data) };
 			res.body() = std::move(str_body);
@@ -155,6 +160,13 @@ namespace classes_response
 		return GetStringResponse(map_id);
 	}
 
+	//--------class ResponseErrorGameMapNotFound-----------
+
+	bool ResponseErrorGameMapNotFound::HasBody(http::verb method) const noexcept
+	{
+		return method != http::verb::head;
+	}
+
 	//--------class ResponseFileNotFound-----------
 
 	http::status ResponseFileNotFound::GetStatus() const noexcept
@@ -199,6 +211,169 @@ namespace classes_response
 		return  data;
 	}
 
+	//--------------class ResponseGame-----------------------
+
+	std::string ResponseGame::MakeStringResponse(const std::string& data) const noexcept
+	{
+		return data;
+	}
+
+	void ResponseGame::SetContentType(StringResponse& res) const noexcept
+	{
+		res.insert(http::field::content_type, ContentType::APPLICATION_JSON);
+		res.insert(http::field::cache_control, "no-cache"sv);
+	}
+
+	bool ResponseGame::HasBody(http::verb method) const noexcept
+	{
+		return method != http::verb::head;
+	}
+
+	Responses ResponseGame::GetResponses(const TypeClassResponse& req) const noexcept
+	{
+		return GetStringResponse(req);
+	}
+
+	//--------------class ResponseMetrics--------------------
+
+	std::string ResponseMetrics::MakeStringResponse(const std::string& data) const noexcept
+	{
+		return data;
+	}
+
+	void ResponseMetrics::SetContentType(StringResponse& res) const noexcept
+	{
+		res.insert(http::field::content_type, ContentType::TEXT_PROMETHEUS);
+		res.insert(http::field::cache_control, "no-cache"sv);
+	}
+
+	Responses ResponseMetrics::GetResponses(const TypeClassResponse& req) const noexcept
+	{
+		return GetStringResponse(req);
+	}
+
+	//--------------class ResponseErrorInvalidArgument-------
+
+	std::string ResponseErrorInvalidArgument::MakeStringResponse(const std::string& data) const noexcept
+	{
+		json::object jv;
+		jv["code"] = "invalidArgument";
+		jv["message"] = data;
+		return json::serialize(jv);
+	}
+
+	http::status ResponseErrorInvalidArgument::GetStatus() const noexcept
+	{
+		return http::status::bad_request;
+	}
+
+	void ResponseErrorInvalidArgument::SetContentType(StringResponse& res) const noexcept
+	{
+		res.insert(http::field::content_type, ContentType::APPLICATION_JSON);
+		res.insert(http::field::cache_control, "no-cache"sv);
+	}
+
+	bool ResponseErrorInvalidArgument::HasBody(http::verb method) const noexcept
+	{
+		return method != http::verb::head;
+	}
+
+	Responses ResponseErrorInvalidArgument::GetResponses(const TypeClassResponse& req) const noexcept
+	{
+		return GetStringResponse(req);
+	}
+
+	//--------------class ResponseErrorInvalidToken-------------
+
+	std::string ResponseErrorInvalidToken::MakeStringResponse(const std::string&) const noexcept
+	{
+		return "{\n  \"code\": \"invalidToken\",\n  \"message\": \"Authorization header is missing or malformed\"\n}";
+	}
+
+	http::status ResponseErrorInvalidToken::GetStatus() const noexcept
+	{
+		return http::status::unauthorized;
+	}
+
+	void ResponseErrorInvalidToken::SetContentType(StringResponse& res) const noexcept
+	{
+		res.insert(http::field::content_type, ContentType::APPLICATION_JSON);
+		res.insert(http::field::cache_control, "no-cache"sv);
+	}
+
+	bool ResponseErrorInvalidToken::HasBody(http::verb method) const noexcept
+	{
+		return method != http::verb::head;
+	}
+
+	Responses ResponseErrorInvalidToken::GetResponses(const TypeClassResponse& req) const noexcept
+	{
+		return GetStringResponse(req);
+	}
+
+	//--------------class ResponseErrorUnknownToken-------------
+
+	std::string ResponseErrorUnknownToken::MakeStringResponse(const std::string&) const noexcept
+	{
+		return "{\n  \"code\": \"unknownToken\",\n  \"message\": \"Player token has not been found\"\n}";
+	}
+
+	http::status ResponseErrorUnknownToken::GetStatus() const noexcept
+	{
+		return http::status::unauthorized;
+	}
+
+	void ResponseErrorUnknownToken::SetContentType(StringResponse& res) const noexcept
+	{
+		res.insert(http::field::content_type, ContentType::APPLICATION_JSON);
+		res.insert(http::field::cache_control, "no-cache"sv);
+	}
+
+	bool ResponseErrorUnknownToken::HasBody(http::verb method) const noexcept
+	{
+		return method != http::verb::head;
+	}
+
+	Responses ResponseErrorUnknownToken::GetResponses(const TypeClassResponse& req) const noexcept
+	{
+		return GetStringResponse(req);
+	}
+
+	//--------------class ResponseErrorMethodNotAllowed---------
+
+	std::string ResponseErrorMethodNotAllowed::MakeStringResponse(const std::string&) const noexcept
+	{
+		return "{\n  \"code\": \"invalidMethod\",\n  \"message\": \"Invalid method\"\n}";
+	}
+
+	http::status ResponseErrorMethodNotAllowed::GetStatus() const noexcept
+	{
+		return http::status::method_not_allowed;
+	}
+
+	void ResponseErrorMethodNotAllowed::SetContentType(StringResponse& res) const noexcept
+	{
+		res.insert(http::field::content_type, ContentType::APPLICATION_JSON);
+		res.insert(http::field::cache_control, "no-cache"sv);
+	}
+
+	bool ResponseErrorMethodNotAllowed::HasBody(http::verb method) const noexcept
+	{
+		return method != http::verb::head;
+	}
+
+	StringResponse ResponseErrorMethodNotAllowed::GetStringResponse(const TypeClassResponse& req) const noexcept
+	{
+		StringResponse res = Response::GetStringResponse(req);
+		res.set(http::field::allow, req.data);
+		return res;
+	}
+
+	Responses ResponseErrorMethodNotAllowed::GetResponses(const TypeClassResponse& req) const noexcept
+	{
+		return GetStringResponse(req);
+	}
+
 	//--------------class ResponseFile-----------------------
 
 	void ResponseFile::SetContentType(FileResponse& res, const TypeClassResponse& req) const noexcept
@@ -16,10 +16,11 @@ namespace classes_response
     namespace json = boost::json;
 
 
-    using StringResponse = http::response<http::string_body>;
+    //       ,      
+    using StringResponse = http::response<http::string_body, http_server::ArenaFields>;
 
     // ,      
-    using FileResponse = http::response<http::file_body>;
+    using FileResponse = http::response<http::file_body, http_server::ArenaFields>;
 
     using Responses = std::variant<StringResponse, FileResponse>;
 
@@ -41,6 +42,7 @@ namespace classes_response
         constexpr static std::string_view IMAGE_TIFF = "image/tiff"sv;
         constexpr static std::string_view IMAGE_SVG_XML = "image/svg+xml"sv;
         constexpr static std::string_view AUDIO_MPEG = "audio/mpeg"sv;
+        constexpr static std::string_view TEXT_PROMETHEUS = "text/plain; version=0.0.4"sv;
     };
 
     struct RequestType
@@ -48,6 +50,15 @@ namespace classes_response
         RequestType() = delete;
         constexpr static std::string_view API = "/api/"sv;
         constexpr static std::string_view API_V1_MAPS = "/api/v1/maps"sv;
+        constexpr static std::string_view API_V1_GAME = "/api/v1/game/"sv;
+        constexpr static std::string_view API_V1_GAME_JOIN = "/api/v1/game/join"sv;
+        constexpr static std::string_view API_V1_GAME_PLAYERS = "/api/v1/game/players"sv;
+        constexpr static std::string_view API_V1_GAME_STATE = "/api/v1/game/state"sv;
+        constexpr static std::string_view API_V1_GAME_ACTION = "/api/v1/game/player/action"sv;
+        constexpr static std::string_view API_V1_GAME_TICK = "/api/v1/game/tick"sv;
+        constexpr static std::string_view API_V1_GAME_WS = "/api/v1/game/ws"sv;
+        constexpr static std::string_view API_V1_GAME_RECORDS = "/api/v1/game/records"sv;
+        constexpr static std::string_view API_V1_METRICS = "/api/v1/metrics"sv;
     };
 
     struct ResponseType
@@ -59,7 +70,14 @@ namespace classes_response
         constexpr static std::string_view MAPS = "maps"sv;
         constexpr static std::string_view FIND_MAP_ID = "find_map_id"sv;
         constexpr static std::string_view ERROR_FIND_MAP_ID = "error_find_map_id"sv;
+        constexpr static std::string_view ERROR_GAME_MAP_NOT_FOUND = "error_game_map_not_found"sv;
         constexpr static std::string_view ERROR_TYPE_REQUEST = "error_type_request"sv;
+        constexpr static std::string_view GAME = "game"sv;
+        constexpr static std::string_view METRICS = "metrics"sv;
+        constexpr static std::string_view ERROR_INVALID_ARGUMENT = "error_invalid_argument"sv;
+        constexpr static std::string_view ERROR_INVALID_TOKEN = "error_invalid_token"sv;
+        constexpr static std::string_view ERROR_UNKNOWN_TOKEN = "error_unknown_token"sv;
+        constexpr static std::string_view ERROR_METHOD_NOT_ALLOWED = "error_method_not_allowed"sv;
     };
 
     enum class Extension
@@ -85,6 +103,9 @@ namespace classes_response
 
         virtual void SetContentType(StringResponse& res) const noexcept;        
 
+        //          ;      GET
+        virtual bool HasBody(http::verb method) const noexcept;
+
         virtual StringResponse GetStringResponse(const TypeClassResponse& req) const noexcept;       
 
         virtual void SetContentType(FileResponse& res, const TypeClassResponse& req) const noexcept;        
@@ -161,6 +182,14 @@ namespace classes_response
     };
 
 
+    // ,     ,  
+    class ResponseErrorGameMapNotFound : public ResponseErrorFindIdMap
+    {
+    public:
+        bool HasBody(http::verb method) const noexcept override;
+    };
+
+
     class ResponseFileNotFound : public Response
     {
     public:
@@ -187,6 +216,96 @@ namespace classes_response
     };
 
 
+    //   API:         data
+    class ResponseGame : public Response
+    {
+    public:
+        std::string MakeStringResponse(const std::string& data) const noexcept override;
+
+        void SetContentType(StringResponse& res) const noexcept override;
+
+        bool HasBody(http::verb method) const noexcept override;
+
+        Responses GetResponses(const TypeClassResponse& req) const noexcept override;
+    };
+
+
+    //      Prometheus,       data
+    class ResponseMetrics : public Response
+    {
+    public:
+        std::string MakeStringResponse(const std::string& data) const noexcept override;
+
+        void SetContentType(StringResponse& res) const noexcept override;
+
+        Responses GetResponses(const TypeClassResponse& req) const noexcept override;
+    };
+
+
+    //  data     
+    class ResponseErrorInvalidArgument : public Response
+    {
+    public:
+        std::string MakeStringResponse(const std::string& data) const noexcept override;
+
+        http::status GetStatus() const noexcept override;
+
+        void SetContentType(StringResponse& res) const noexcept override;
+
+        bool HasBody(http::verb method) const noexcept override;
+
+        Responses GetResponses(const TypeClassResponse& req) const noexcept override;
+    };
+
+
+    class ResponseErrorInvalidToken : public Response
+    {
+    public:
+        std::string MakeStringResponse(const std::string&) const noexcept override;
+
+        http::status GetStatus() const noexcept override;
+
+        void SetContentType(StringResponse& res) const noexcept override;
+
+        bool HasBody(http::verb method) const noexcept override;
+
+        Responses GetResponses(const TypeClassResponse& req) const noexcept override;
+    };
+
+
+    class ResponseErrorUnknownToken : public Response
+    {
+    public:
+        std::string MakeStringResponse(const std::string&) const noexcept override;
+
+        http::status GetStatus() const noexcept override;
+
+        void SetContentType(StringResponse& res) const noexcept override;
+
+        bool HasBody(http::verb method) const noexcept override;
+
+        Responses GetResponses(const TypeClassResponse& req) const noexcept override;
+    };
+
+
+    //  data       Allow
+    class ResponseErrorMethodNotAllowed : public Response
+    {
+    public:
+        std::string MakeStringResponse(const std::string&) const noexcept override;
+
+        http::status GetStatus() const noexcept override;
+
+        void SetContentType(StringResponse& res) const noexcept override;
+
+        bool HasBody(http::verb method) const noexcept override;
+
+        StringResponse GetStringResponse(const TypeClassResponse& req) const noexcept override;
+
+        Responses GetResponses(const TypeClassResponse& req) const noexcept override;
+    };
+
+
     class ResponseFile : public Response
     {
     public:
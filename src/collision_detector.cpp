@@ -0,0 +1,164 @@
+#include "collision_detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+
+namespace collision_detector
+{
+    CollectionResult TryCollectPoint(Point2D a, Point2D b, Point2D c) noexcept
+    {
+        const double u_x = c.x - a.x;
+        const double u_y = c.y - a.y;
+        const double v_x = b.x - a.x;
+        const double v_y = b.y - a.y;
+        const double u_dot_v = u_x * v_x + u_y * v_y;
+        const double u_len2 = u_x * u_x + u_y * u_y;
+        const double v_len2 = v_x * v_x + v_y * v_y;
+        const double proj_ratio = u_dot_v / v_len2;
+        const double sq_distance = u_len2 - (u_dot_v * u_dot_v) / v_len2;
+
+        return CollectionResult{ sq_distance, proj_ratio };
+    }
+
+    namespace
+    {
+        // Собиратель, покрывающий больше ячеек, проверяется со всеми предметами напрямую
+        constexpr std::int64_t MAX_CELLS_PER_GATHERER = 64;
+        constexpr double MIN_CELL_SIZE = 1e-3;
+
+        struct CellEntry
+        {
+            std::uint64_t key;
+            std::uint32_t gatherer;
+
+            bool operator<(const CellEntry& other) const noexcept
+            {
+                return std::tie(key, gatherer) < std::tie(other.key, other.gatherer);
+            }
+        };
+
+        std::int64_t CellCoord(double value, double cell_size) noexcept
+        {
+            return static_cast<std::int64_t>(std::floor(value / cell_size));
+        }
+
+        // Совпадение ключей разных ячеек после усечения до 32 бит приводит лишь к лишней
+        // проверке в узкой фазе, но не к ошибке
+        std::uint64_t CellKey(std::int64_t x, std::int64_t y) noexcept
+        {
+            return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32)
+                | static_cast<std::uint32_t>(y);
+        }
+    }  // namespace
+
+    std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider)
+    {
+        std::vector<GatheringEvent> events;
+        const size_t items_count = provider.ItemsCount();
+        const size_t gatherers_count = provider.GatherersCount();
+        if (items_count == 0 || gatherers_count == 0)
+        {
+            return events;
+        }
+
+        std::vector<Item> items;
+        items.reserve(items_count);
+        double max_item_width = 0.0;
+        for (size_t i = 0; i < items_count; ++i)
+        {
+            const Item& item = items.emplace_back(provider.GetItem(i));
+            max_item_width = std::max(max_item_width, item.width);
+        }
+
+        // Стоящие на месте собиратели ничего не подбирают
+        std::vector<Gatherer> gatherers;
+        std::vector<size_t> gatherer_ids;
+        gatherers.reserve(gatherers_count);
+        gatherer_ids.reserve(gatherers_count);
+        double max_gatherer_width = 0.0;
+        double extent_sum = 0.0;
+        for (size_t g = 0; g < gatherers_count; ++g)
+        {
+            const Gatherer gatherer = provider.GetGatherer(g);
+            const double dx = std::abs(gatherer.end_pos.x - gatherer.start_pos.x);
+            const double dy = std::abs(gatherer.end_pos.y - gatherer.start_pos.y);
+            if (!(dx > 0.0 || dy > 0.0))
+            {
+                continue;
+            }
+            gatherers.push_back(gatherer);
+            gatherer_ids.push_back(g);
+            max_gatherer_width = std::max(max_gatherer_width, gatherer.width);
+            extent_sum += std::max(dx, dy);
+        }
+        if (gatherers.empty())
+        {
+            return events;
+        }
+
+        // Ячейка не меньше среднего отрезка перемещения, чтобы типичный отрезок занимал
+        // не больше нескольких ячеек
+        const double cell_size = std::max({ extent_sum / static_cast<double>(gatherers.size()),
+            2.0 * (max_gatherer_width + max_item_width), MIN_CELL_SIZE });
+
+        std::vector<CellEntry> entries;
+        entries.reserve(gatherers.size() * 4);
+        std::vector<std::uint32_t> oversized;
+        for (size_t g = 0; g < gatherers.size(); ++g)
+        {
+            const Gatherer& gatherer = gatherers[g];
+            const double reach = gatherer.width + max_item_width;
+            const std::int64_t x0 = CellCoord(std::min(gatherer.start_pos.x, gatherer.end_pos.x) - reach, cell_size);
+            const std::int64_t x1 = CellCoord(std::max(gatherer.start_pos.x, gatherer.end_pos.x) + reach, cell_size);
+            const std::int64_t y0 = CellCoord(std::min(gatherer.start_pos.y, gatherer.end_pos.y) - reach, cell_size);
+            const std::int64_t y1 = CellCoord(std::max(gatherer.start_pos.y, gatherer.end_pos.y) + reach, cell_size);
+            if ((x1 - x0 + 1) * (y1 - y0 + 1) > MAX_CELLS_PER_GATHERER)
+            {
+                oversized.push_back(static_cast<std::uint32_t>(g));
+                continue;
+            }
+            for (std::int64_t cy = y0; cy <= y1; ++cy)
+            {
+                for (std::int64_t cx = x0; cx <= x1; ++cx)
+                {
+                    entries.push_back({ CellKey(cx, cy), static_cast<std::uint32_t>(g) });
+                }
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+
+        auto test = [&](size_t item_idx, std::uint32_t g)
+        {
+            const Gatherer& gatherer = gatherers[g];
+            const Item& item = items[item_idx];
+            const CollectionResult result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
+            if (result.IsCollected(gatherer.width + item.width))
+            {
+                events.push_back({ item_idx, gatherer_ids[g], result.sq_distance, result.proj_ratio });
+            }
+        };
+
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+            const std::uint64_t key = CellKey(CellCoord(items[i].position.x, cell_size),
+                CellCoord(items[i].position.y, cell_size));
+            auto it = std::lower_bound(entries.begin(), entries.end(), CellEntry{ key, 0 });
+            for (; it != entries.end() && it->key == key; ++it)
+            {
+                test(i, it->gatherer);
+            }
+            for (const std::uint32_t g : oversized)
+            {
+                test(i, g);
+            }
+        }
+
+        std::sort(events.begin(), events.end(), [](const GatheringEvent& lhs, const GatheringEvent& rhs)
+        {
+            return std::tie(lhs.time, lhs.gatherer_id, lhs.item_id) < std::tie(rhs.time, rhs.gatherer_id, rhs.item_id);
+        });
+        return events;
+    }
+}  // namespace collision_detector
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace collision_detector
+{
+    struct Point2D
+    {
+        double x, y;
+    };
+
+    struct CollectionResult
+    {
+        bool IsCollected(double collect_radius) const noexcept
+        {
+            return proj_ratio >= 0 && proj_ratio <= 1 && sq_distance <= collect_radius * collect_radius;
+        }
+
+        // Квадрат расстояния до точки
+        double sq_distance;
+        // Доля пройденного отрезка
+        double proj_ratio;
+    };
+
+    // Движемся из точки a в точку b и пытаемся подобрать точку c.
+    // Отрезок ab должен иметь ненулевую длину
+    CollectionResult TryCollectPoint(Point2D a, Point2D b, Point2D c) noexcept;
+
+    struct Item
+    {
+        Point2D position;
+        double width;
+    };
+
+    // Собиратель, переместившийся за тик из start_pos в end_pos
+    struct Gatherer
+    {
+        Point2D start_pos;
+        Point2D end_pos;
+        double width;
+    };
+
+    class ItemGathererProvider
+    {
+    protected:
+        ~ItemGathererProvider() = default;
+
+    public:
+        virtual size_t ItemsCount() const = 0;
+        virtual Item GetItem(size_t idx) const = 0;
+        virtual size_t GatherersCount() const = 0;
+        virtual Gatherer GetGatherer(size_t idx) const = 0;
+    };
+
+    struct GatheringEvent
+    {
+        size_t item_id;
+        size_t gatherer_id;
+        double sq_distance;
+        // Момент события в долях тика
+        double time;
+    };
+
+    // Находит все случаи, когда собиратель прошёл на расстоянии захвата от предмета.
+    // Широкая фаза: отрезки перемещений раскладываются по ячейкам равномерной сетки, и предмет
+    // проверяется только с собирателями своей ячейки. Узкая фаза: пересечение отрезка с кругом.
+    // События упорядочены по времени, затем по номеру собирателя и номеру предмета
+    std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
+}  // namespace collision_detector
@@ -0,0 +1,122 @@
+#include "compute_pool.h"
+
+#include <algorithm>
+#include <random>
+
+#include "metrics.h"
+
+namespace compute_pool
+{
+    namespace
+    {
+        // Пул и номер потока пула, выполняющего текущий поток
+        thread_local const Pool* current_pool = nullptr;
+        thread_local unsigned current_index = 0;
+    }  // namespace
+
+    Pool::Pool(unsigned threads)
+    {
+        workers_.reserve(std::max(1u, threads));
+        for (unsigned i = 0; i < std::max(1u, threads); ++i)
+        {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+    }
+
+    void Pool::Submit(Task task)
+    {
+        const std::size_t index = current_pool == this ? current_index
+                                                       : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+        {
+            Worker& worker = *workers_[index];
+            std::lock_guard lock{ worker.mutex };
+            worker.tasks.push_back(std::move(task));
+        }
+        metrics::CountOffloadQueued();
+        pending_.fetch_add(1);
+        {
+            // Поток, который проверил pending_ до увеличения, уже ждёт под блокировкой и получит уведомление
+            std::lock_guard lock{ sleep_mutex_ };
+        }
+        wake_.notify_one();
+    }
+
+    void Pool::Run(unsigned index)
+    {
+        current_pool = this;
+        current_index = index % GetThreads();
+        for (;;)
+        {
+            bool stolen = false;
+            Task task = Pop(current_index);
+            if (!task)
+            {
+                task = Steal(current_index);
+                stolen = static_cast<bool>(task);
+            }
+            if (task)
+            {
+                pending_.fetch_sub(1);
+                metrics::CountOffloadStarted(stolen);
+                task();
+                continue;
+            }
+            std::unique_lock lock{ sleep_mutex_ };
+            wake_.wait(lock, [this]
+            {
+                return stopped_ || pending_.load() != 0;
+            });
+            if (stopped_)
+            {
+                break;
+            }
+        }
+        current_pool = nullptr;
+    }
+
+    void Pool::Stop()
+    {
+        {
+            std::lock_guard lock{ sleep_mutex_ };
+            stopped_ = true;
+        }
+        wake_.notify_all();
+    }
+
+    Task Pool::Pop(unsigned index)
+    {
+        Worker& worker = *workers_[index];
+        std::lock_guard lock{ worker.mutex };
+        if (worker.tasks.empty())
+        {
+            return {};
+        }
+        Task task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        return task;
+    }
+
+    Task Pool::Steal(unsigned index)
+    {
+        const std::size_t count = workers_.size();
+        thread_local std::minstd_rand random{ std::random_device{}() };
+        const std::size_t start = random() % count;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const std::size_t victim = (start + i) % count;
+            if (victim == index)
+            {
+                continue;
+            }
+            Worker& worker = *workers_[victim];
+            std::lock_guard lock{ worker.mutex };
+            if (!worker.tasks.empty())
+            {
+                Task task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+                return task;
+            }
+        }
+        return {};
+    }
+}  // namespace compute_pool
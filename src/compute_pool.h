@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace compute_pool
+{
+    // Задача пула. В отличие от std::function, может владеть некопируемыми объектами, например запросом
+    class Task
+    {
+    public:
+        Task() = default;
+
+        template <typename Fn, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fn>, Task>>>
+        Task(Fn&& fn)
+            : impl_{ std::make_unique<Impl<std::decay_t<Fn>>>(std::forward<Fn>(fn)) }
+        {}
+
+        explicit operator bool() const noexcept
+        {
+            return impl_ != nullptr;
+        }
+
+        void operator()()
+        {
+            impl_->Run();
+        }
+
+    private:
+        struct Base
+        {
+            virtual ~Base() = default;
+            virtual void Run() = 0;
+        };
+
+        template <typename Fn>
+        struct Impl : Base
+        {
+            explicit Impl(Fn&& fn)
+                : fn{ std::move(fn) }
+            {}
+
+            explicit Impl(const Fn& fn)
+                : fn{ fn }
+            {}
+
+            void Run() override
+            {
+                fn();
+            }
+
+            Fn fn;
+        };
+
+        std::unique_ptr<Base> impl_;
+    };
+
+    // Пул потоков для вычислительной работы, которая иначе задерживала бы остальные соединения потока
+    // ввода-вывода. У каждого потока своя очередь, и задачи из неё берутся по порядку постановки: поток
+    // берёт самую старую задачу своей очереди, а поток с пустой очередью - самую старую задачу очереди
+    // случайно выбранного соседа, поэтому запрос не обгоняют поставленные после него. Задачи извне
+    // раскладываются по очередям по кругу, задачи из потока пула ставятся в его собственную очередь
+    class Pool
+    {
+    public:
+        explicit Pool(unsigned threads);
+
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        unsigned GetThreads() const noexcept
+        {
+            return static_cast<unsigned>(workers_.size());
+        }
+
+        void Submit(Task task);
+
+        // Выполняет задачи в потоке index (0 <= index < GetThreads()), пока не будет вызван Stop
+        void Run(unsigned index);
+
+        // Останавливает потоки пула. Задачи, которые ещё не начали выполняться, разрушаются вместе с пулом
+        void Stop();
+
+    private:
+        struct alignas(64) Worker
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::atomic<std::size_t> next_{ 0 };
+        // Поставленные и ещё не взятые задачи
+        std::atomic<std::size_t> pending_{ 0 };
+        std::mutex sleep_mutex_;
+        std::condition_variable wake_;
+        bool stopped_ = false;
+
+        Task Pop(unsigned index);
+        Task Steal(unsigned index);
+    };
+}  // namespace compute_pool
@@ -0,0 +1,221 @@
+#include "dog_movement.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MOVEMENT_X86_64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(MOVEMENT_X86_64) && (defined(__GNUC__) || defined(__clang__))
+#define MOVEMENT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MOVEMENT_TARGET_AVX2
+#endif
+
+using namespace std::literals;
+
+namespace movement
+{
+    size_t DogsState::Add(double pos_x, double pos_y, const RoadBounds& bounds)
+    {
+        const size_t index = Size();
+        x.push_back(pos_x);
+        y.push_back(pos_y);
+        vx.push_back(0.0);
+        vy.push_back(0.0);
+        min_x.push_back(bounds.min_x);
+        max_x.push_back(bounds.max_x);
+        min_y.push_back(bounds.min_y);
+        max_y.push_back(bounds.max_y);
+        return index;
+    }
+
+    void DogsState::SetBounds(size_t index, const RoadBounds& bounds) noexcept
+    {
+        min_x[index] = bounds.min_x;
+        max_x[index] = bounds.max_x;
+        min_y[index] = bounds.min_y;
+        max_y[index] = bounds.max_y;
+    }
+
+    void DogsState::SwapRemove(size_t index) noexcept
+    {
+        for (auto* v : { &x, &y, &vx, &vy, &min_x, &max_x, &min_y, &max_y })
+        {
+            (*v)[index] = v->back();
+            v->pop_back();
+        }
+    }
+
+    void DogsState::Reserve(size_t n)
+    {
+        for (auto* v : { &x, &y, &vx, &vy, &min_x, &max_x, &min_y, &max_y })
+        {
+            v->reserve(n);
+        }
+    }
+
+    namespace
+    {
+        // Эталонная реализация. Сравнения записаны так же, как их выполняют
+        // инструкции MAXPD/MINPD/CMPNEQPD, поэтому векторные ядра дают тот же результат,
+        // включая случаи с NaN и знаком нуля.
+        void MoveScalar(DogsState& s, double dt, size_t begin, size_t end) noexcept
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const double nx = s.x[i] + s.vx[i] * dt;
+                const double ny = s.y[i] + s.vy[i] * dt;
+
+                double cx = nx > s.min_x[i] ? nx : s.min_x[i];
+                cx = cx < s.max_x[i] ? cx : s.max_x[i];
+                double cy = ny > s.min_y[i] ? ny : s.min_y[i];
+                cy = cy < s.max_y[i] ? cy : s.max_y[i];
+
+                if (cx != nx || cy != ny)
+                {
+                    s.vx[i] = 0.0;
+                    s.vy[i] = 0.0;
+                }
+                s.x[i] = cx;
+                s.y[i] = cy;
+            }
+        }
+
+#ifdef MOVEMENT_X86_64
+        void MoveSse2(DogsState& s, double dt) noexcept
+        {
+            const size_t n = s.Size();
+            const size_t simd_end = n - n % 2;
+            const __m128d vdt = _mm_set1_pd(dt);
+            for (size_t i = 0; i < simd_end; i += 2)
+            {
+                __m128d vx = _mm_loadu_pd(&s.vx[i]);
+                __m128d vy = _mm_loadu_pd(&s.vy[i]);
+                const __m128d nx = _mm_add_pd(_mm_loadu_pd(&s.x[i]), _mm_mul_pd(vx, vdt));
+                const __m128d ny = _mm_add_pd(_mm_loadu_pd(&s.y[i]), _mm_mul_pd(vy, vdt));
+
+                const __m128d cx = _mm_min_pd(_mm_max_pd(nx, _mm_loadu_pd(&s.min_x[i])), _mm_loadu_pd(&s.max_x[i]));
+                const __m128d cy = _mm_min_pd(_mm_max_pd(ny, _mm_loadu_pd(&s.min_y[i])), _mm_loadu_pd(&s.max_y[i]));
+
+                const __m128d stop = _mm_or_pd(_mm_cmpneq_pd(cx, nx), _mm_cmpneq_pd(cy, ny));
+                vx = _mm_andnot_pd(stop, vx);
+                vy = _mm_andnot_pd(stop, vy);
+
+                _mm_storeu_pd(&s.x[i], cx);
+                _mm_storeu_pd(&s.y[i], cy);
+                _mm_storeu_pd(&s.vx[i], vx);
+                _mm_storeu_pd(&s.vy[i], vy);
+            }
+            MoveScalar(s, dt, simd_end, n);
+        }
+
+        MOVEMENT_TARGET_AVX2 void MoveAvx2(DogsState& s, double dt) noexcept
+        {
+            const size_t n = s.Size();
+            const size_t simd_end = n - n % 4;
+            const __m256d vdt = _mm256_set1_pd(dt);
+            for (size_t i = 0; i < simd_end; i += 4)
+            {
+                __m256d vx = _mm256_loadu_pd(&s.vx[i]);
+                __m256d vy = _mm256_loadu_pd(&s.vy[i]);
+                // Умножение и сложение выполняются раздельно (без FMA), как в скалярном ядре
+                const __m256d nx = _mm256_add_pd(_mm256_loadu_pd(&s.x[i]), _mm256_mul_pd(vx, vdt));
+                const __m256d ny = _mm256_add_pd(_mm256_loadu_pd(&s.y[i]), _mm256_mul_pd(vy, vdt));
+
+                const __m256d cx = _mm256_min_pd(_mm256_max_pd(nx, _mm256_loadu_pd(&s.min_x[i])), _mm256_loadu_pd(&s.max_x[i]));
+                const __m256d cy = _mm256_min_pd(_mm256_max_pd(ny, _mm256_loadu_pd(&s.min_y[i])), _mm256_loadu_pd(&s.max_y[i]));
+
+                const __m256d stop = _mm256_or_pd(_mm256_cmp_pd(cx, nx, _CMP_NEQ_UQ), _mm256_cmp_pd(cy, ny, _CMP_NEQ_UQ));
+                vx = _mm256_andnot_pd(stop, vx);
+                vy = _mm256_andnot_pd(stop, vy);
+
+                _mm256_storeu_pd(&s.x[i], cx);
+                _mm256_storeu_pd(&s.y[i], cy);
+                _mm256_storeu_pd(&s.vx[i], vx);
+                _mm256_storeu_pd(&s.vy[i], vy);
+            }
+            MoveScalar(s, dt, simd_end, n);
+        }
+
+        bool CpuHasAvx2() noexcept
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+            __cpuid(info, 1);
+            const bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+            __cpuidex(info, 7, 0);
+            return os_saves_ymm && (info[1] & (1 << 5));
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+#endif
+    }  // namespace
+
+    std::string_view KernelName(Kernel kernel) noexcept
+    {
+        switch (kernel)
+        {
+        case Kernel::SSE2:
+            return "sse2"sv;
+        case Kernel::AVX2:
+            return "avx2"sv;
+        default:
+            return "scalar"sv;
+        }
+    }
+
+    bool IsKernelSupported(Kernel kernel) noexcept
+    {
+        switch (kernel)
+        {
+#ifdef MOVEMENT_X86_64
+        case Kernel::SSE2:
+            // SSE2 входит в базовый набор инструкций x86-64
+            return true;
+        case Kernel::AVX2:
+            return CpuHasAvx2();
+#endif
+        case Kernel::SCALAR:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    Kernel DetectKernel() noexcept
+    {
+        static const Kernel kernel = IsKernelSupported(Kernel::AVX2) ? Kernel::AVX2
+            : IsKernelSupported(Kernel::SSE2) ? Kernel::SSE2
+            : Kernel::SCALAR;
+        return kernel;
+    }
+
+    void MoveDogs(DogsState& state, double dt, Kernel kernel)
+    {
+        switch (kernel)
+        {
+#ifdef MOVEMENT_X86_64
+        case Kernel::SSE2:
+            return MoveSse2(state, dt);
+        case Kernel::AVX2:
+            return MoveAvx2(state, dt);
+#endif
+        default:
+            return MoveScalar(state, dt, 0, state.Size());
+        }
+    }
+
+    void MoveDogs(DogsState& state, double dt)
+    {
+        MoveDogs(state, dt, DetectKernel());
+    }
+}  // namespace movement
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace movement
+{
+    // Прямоугольник дороги, в пределах которого может перемещаться собака
+    struct RoadBounds
+    {
+        double min_x, max_x, min_y, max_y;
+    };
+
+    // Кинематическое состояние всех собак игрового сеанса в виде структуры массивов (SoA).
+    // Элемент i каждого массива относится к одной и той же собаке, что позволяет
+    // обновлять состояние векторными инструкциями.
+    struct DogsState
+    {
+        std::vector<double> x, y;
+        std::vector<double> vx, vy;
+        std::vector<double> min_x, max_x, min_y, max_y;
+
+        size_t Size() const noexcept
+        {
+            return x.size();
+        }
+
+        // Добавляет неподвижную собаку и возвращает её индекс
+        size_t Add(double pos_x, double pos_y, const RoadBounds& bounds);
+
+        void SetBounds(size_t index, const RoadBounds& bounds) noexcept;
+
+        // Удаляет собаку index, перенося на её место последнюю
+        void SwapRemove(size_t index) noexcept;
+
+        void Reserve(size_t n);
+    };
+
+    enum class Kernel
+    {
+        SCALAR, SSE2, AVX2
+    };
+
+    std::string_view KernelName(Kernel kernel) noexcept;
+
+    // Наилучшее ядро, поддерживаемое процессором. Определяется один раз при первом вызове
+    Kernel DetectKernel() noexcept;
+
+    bool IsKernelSupported(Kernel kernel) noexcept;
+
+    // Перемещает собак на время dt: позиция += скорость * dt, затем позиция ограничивается
+    // границами текущей дороги. Собака, упёршаяся в границу, останавливается.
+    // Результат всех ядер побитово совпадает с результатом скалярного ядра.
+    void MoveDogs(DogsState& state, double dt, Kernel kernel);
+
+    void MoveDogs(DogsState& state, double dt);
+}  // namespace movement
@@ -0,0 +1,416 @@
+// Нагрузочный тест: N ботов входят в игру через HTTP API запущенного сервера, отправляют команды
+// и опрашивают состояние с заданной частотой, после чего выводится пропускная способность,
+// задержки запросов и отставание игровых тиков.
+// Запуск: game_bots [--host 127.0.0.1] [--port 8080] [--bots 100] [--duration 10] ...
+#include "sdk.h"
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+namespace
+{
+    namespace net = boost::asio;
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    using tcp = net::ip::tcp;
+    using Clock = std::chrono::steady_clock;
+
+    struct Args
+    {
+        std::string host = "127.0.0.1";
+        std::string port = "8080";
+        std::string map_id = "map1";
+        size_t bots = 100;
+        double duration = 10.0;
+        // Частоты запросов одного бота, в секунду
+        double action_rate = 2.0;
+        double state_rate = 5.0;
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        // Период тика сервера в миллисекундах. Если задан, вычисляется отставание игрового времени
+        unsigned tick_period = 0;
+        std::uint64_t seed = 42;
+    };
+
+    std::optional<Args> ParseCommandLine(int argc, const char* const argv[])
+    {
+        namespace po = boost::program_options;
+
+        po::options_description desc{ "All options"s };
+        Args args;
+        desc.add_options()
+            ("help,h", "produce help message")
+            ("host", po::value(&args.host)->value_name("address"s), "set server address (127.0.0.1 by default)")
+            ("port", po::value(&args.port)->value_name("port"s), "set server port (8080 by default)")
+            ("map", po::value(&args.map_id)->value_name("id"s), "set map to join (map1 by default)")
+            ("bots", po::value(&args.bots)->value_name("count"s), "set number of simulated players")
+            ("duration", po::value(&args.duration)->value_name("seconds"s), "set test duration")
+            ("action-rate", po::value(&args.action_rate)->value_name("per-second"s),
+                "set movement actions per second of one bot")
+            ("state-rate", po::value(&args.state_rate)->value_name("per-second"s),
+                "set state polls per second of one bot")
+            ("threads", po::value(&args.threads)->value_name("count"s), "set number of client threads")
+            ("tick-period", po::value(&args.tick_period)->value_name("milliseconds"s),
+                "set server tick period to measure tick lag")
+            ("seed", po::value(&args.seed)->value_name("seed"s), "set seed of bot behaviour");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+        if (vm.contains("help"s))
+        {
+            std::cout << desc;
+            return std::nullopt;
+        }
+        if (args.bots == 0 || args.duration <= 0.0 || args.action_rate + args.state_rate <= 0.0)
+        {
+            throw std::runtime_error("Bots, duration and request rates must be positive"s);
+        }
+        return args;
+    }
+
+    enum class RequestKind
+    {
+        JOIN, ACTION, STATE
+    };
+
+    // Результаты одного бота. Заполняются только в strand бота и объединяются после остановки
+    struct BotStats
+    {
+        std::vector<double> join_us;
+        std::vector<double> action_us;
+        std::vector<double> state_us;
+        size_t errors = 0;
+        // Моменты получения ответов о состоянии и версии состояния в них
+        std::vector<std::pair<Clock::time_point, std::uint64_t>> versions;
+    };
+
+    // Извлекает поле version из ответа о состоянии, не разбирая весь документ
+    std::optional<std::uint64_t> FindVersion(std::string_view body)
+    {
+        constexpr std::string_view KEY = "\"version\":"sv;
+        const size_t pos = body.find(KEY);
+        if (pos == std::string_view::npos)
+        {
+            return std::nullopt;
+        }
+        std::uint64_t version = 0;
+        const char* begin = body.data() + pos + KEY.size();
+        auto [ptr, ec] = std::from_chars(begin, body.data() + body.size(), version);
+        if (ec != std::errc{})
+        {
+            return std::nullopt;
+        }
+        return version;
+    }
+
+    // Бот держит одно соединение keep-alive и отправляет запросы по расписанию с экспоненциальными
+    // интервалами. Расписание не сдвигается, если ответ запаздывает: задержка отсчитывается
+    // от запланированного момента отправки, поэтому медленный сервер не прячет очередь запросов
+    class Bot : public std::enable_shared_from_this<Bot>
+    {
+    public:
+        Bot(net::io_context& ioc, const Args& args, const tcp::resolver::results_type& endpoints,
+            Clock::time_point deadline, std::uint64_t seed)
+            : stream_{ net::make_strand(ioc) }
+            , timer_{ stream_.get_executor() }
+            , args_{ args }
+            , endpoints_{ endpoints }
+            , deadline_{ deadline }
+            , random_{ seed }
+            , interval_{ args.action_rate + args.state_rate }
+        {}
+
+        void Start()
+        {
+            stream_.async_connect(endpoints_, [self = shared_from_this()](beast::error_code ec, const tcp::endpoint&)
+            {
+                if (ec)
+                {
+                    ++self->stats_.errors;
+                    return;
+                }
+                self->Send(RequestKind::JOIN, http::verb::post, "/api/v1/game/join"sv,
+                    boost::json::serialize(boost::json::object{ { "userName", "bot" }, { "mapId", self->args_.map_id } }));
+            });
+        }
+
+        const BotStats& GetStats() const noexcept
+        {
+            return stats_;
+        }
+
+    private:
+        beast::tcp_stream stream_;
+        net::steady_timer timer_;
+        const Args& args_;
+        const tcp::resolver::results_type& endpoints_;
+        Clock::time_point deadline_;
+        std::mt19937_64 random_;
+        std::exponential_distribution<double> interval_;
+
+        std::string authorization_;
+        http::request<http::string_body> request_;
+        http::response<http::string_body> response_;
+        beast::flat_buffer buffer_;
+        RequestKind kind_ = RequestKind::JOIN;
+        Clock::time_point scheduled_;
+        BotStats stats_;
+
+        void Send(RequestKind kind, http::verb method, std::string_view target, std::string body)
+        {
+            if (kind == RequestKind::JOIN)
+            {
+                scheduled_ = Clock::now();
+            }
+            kind_ = kind;
+            request_ = {};
+            request_.method(method);
+            request_.target(target);
+            request_.version(11);
+            request_.set(http::field::host, args_.host);
+            request_.keep_alive(true);
+            if (!authorization_.empty())
+            {
+                request_.set(http::field::authorization, authorization_);
+            }
+            if (method == http::verb::post)
+            {
+                request_.set(http::field::content_type, "application/json"sv);
+                request_.body() = std::move(body);
+            }
+            request_.prepare_payload();
+
+            http::async_write(stream_, request_, [self = shared_from_this()](beast::error_code ec, size_t)
+            {
+                if (ec)
+                {
+                    ++self->stats_.errors;
+                    return;
+                }
+                self->response_ = {};
+                http::async_read(self->stream_, self->buffer_, self->response_,
+                    [self](beast::error_code ec, size_t)
+                    {
+                        self->OnResponse(ec);
+                    });
+            });
+        }
+
+        void OnResponse(beast::error_code ec)
+        {
+            if (ec)
+            {
+                ++stats_.errors;
+                return;
+            }
+            const Clock::time_point now = Clock::now();
+            const double latency_us = std::chrono::duration<double, std::micro>(now - scheduled_).count();
+            if (response_.result() != http::status::ok)
+            {
+                ++stats_.errors;
+            }
+
+            switch (kind_)
+            {
+            case RequestKind::JOIN:
+                stats_.join_us.push_back(latency_us);
+                try
+                {
+                    authorization_ = "Bearer "s
+                        + std::string{ boost::json::parse(response_.body()).at("authToken").as_string() };
+                }
+                catch (const std::exception&)
+                {
+                    ++stats_.errors;
+                    return;
+                }
+                scheduled_ = now;
+                break;
+            case RequestKind::ACTION:
+                stats_.action_us.push_back(latency_us);
+                break;
+            case RequestKind::STATE:
+                stats_.state_us.push_back(latency_us);
+                if (auto version = FindVersion(response_.body()))
+                {
+                    stats_.versions.emplace_back(now, *version);
+                }
+                break;
+            }
+            ScheduleNext();
+        }
+
+        void ScheduleNext()
+        {
+            scheduled_ += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval_(random_)));
+            if (scheduled_ >= deadline_)
+            {
+                beast::error_code ec;
+                stream_.socket().shutdown(tcp::socket::shutdown_both, ec);
+                return;
+            }
+            timer_.expires_at(scheduled_);
+            timer_.async_wait([self = shared_from_this()](beast::error_code ec)
+            {
+                if (!ec)
+                {
+                    self->SendNext();
+                }
+            });
+        }
+
+        void SendNext()
+        {
+            const double total = args_.action_rate + args_.state_rate;
+            if (std::uniform_real_distribution<double>{ 0.0, total }(random_) < args_.action_rate)
+            {
+                constexpr std::string_view MOVES[] = { "U"sv, "D"sv, "L"sv, "R"sv, ""sv };
+                const auto move = MOVES[std::uniform_int_distribution<size_t>{ 0, std::size(MOVES) - 1 }(random_)];
+                Send(RequestKind::ACTION, http::verb::post, "/api/v1/game/player/action"sv,
+                    boost::json::serialize(boost::json::object{ { "move", move } }));
+            }
+            else
+            {
+                Send(RequestKind::STATE, http::verb::get, "/api/v1/game/state"sv, {});
+            }
+        }
+    };
+
+    void PrintLatencies(std::string_view name, std::vector<double>& values)
+    {
+        std::sort(values.begin(), values.end());
+        auto percentile = [&](double p)
+        {
+            return values.empty() ? 0.0 : values[static_cast<size_t>(p * (values.size() - 1))];
+        };
+        std::cout << name << ": count="sv << values.size()
+            << " p50_us="sv << percentile(0.5)
+            << " p99_us="sv << percentile(0.99)
+            << " p999_us="sv << percentile(0.999)
+            << " max_us="sv << percentile(1.0) << std::endl;
+    }
+}  // namespace
+
+int main(int argc, const char* argv[])
+{
+    std::optional<Args> args;
+    try
+    {
+        args = ParseCommandLine(argc, argv);
+        if (!args)
+        {
+            return EXIT_SUCCESS;
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        net::io_context ioc(static_cast<int>(args->threads));
+        const auto endpoints = tcp::resolver{ ioc }.resolve(args->host, args->port);
+
+        const Clock::time_point start = Clock::now();
+        const Clock::time_point deadline = start
+            + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(args->duration));
+        std::vector<std::shared_ptr<Bot>> bots;
+        bots.reserve(args->bots);
+        for (size_t i = 0; i < args->bots; ++i)
+        {
+            bots.push_back(std::make_shared<Bot>(ioc, *args, endpoints, deadline, args->seed + i));
+            bots.back()->Start();
+        }
+
+        std::vector<std::jthread> workers;
+        for (unsigned i = 1; i < args->threads; ++i)
+        {
+            workers.emplace_back([&ioc]
+            {
+                ioc.run();
+            });
+        }
+        ioc.run();
+        workers.clear();
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        BotStats total;
+        for (const auto& bot : bots)
+        {
+            const BotStats& stats = bot->GetStats();
+            total.join_us.insert(total.join_us.end(), stats.join_us.begin(), stats.join_us.end());
+            total.action_us.insert(total.action_us.end(), stats.action_us.begin(), stats.action_us.end());
+            total.state_us.insert(total.state_us.end(), stats.state_us.begin(), stats.state_us.end());
+            total.versions.insert(total.versions.end(), stats.versions.begin(), stats.versions.end());
+            total.errors += stats.errors;
+        }
+
+        const size_t requests = total.join_us.size() + total.action_us.size() + total.state_us.size();
+        std::cout << "bots="sv << args->bots
+            << " elapsed_s="sv << elapsed.count()
+            << " requests="sv << requests
+            << " errors="sv << total.errors
+            << " throughput_rps="sv << static_cast<double>(requests) / elapsed.count() << std::endl;
+        PrintLatencies("join"sv, total.join_us);
+        PrintLatencies("action"sv, total.action_us);
+        PrintLatencies("state"sv, total.state_us);
+
+        // Отставание тиков: насколько игровое время, видимое в ответах, отстаёт от настенного
+        // при заданном периоде тика. Отсчитывается от первого полученного ответа
+        std::sort(total.versions.begin(), total.versions.end());
+        if (total.versions.size() >= 2)
+        {
+            const auto& [first_time, first_version] = total.versions.front();
+            const auto& [last_time, last_version] = total.versions.back();
+            const std::chrono::duration<double> span = last_time - first_time;
+            std::cout << "ticks="sv << last_version - first_version
+                << " ticks_per_sec="sv << static_cast<double>(last_version - first_version) / span.count();
+            if (args->tick_period > 0)
+            {
+                double max_lag_ms = 0.0;
+                std::uint64_t max_version = first_version;
+                for (const auto& [time, version] : total.versions)
+                {
+                    // Ответ мог быть сформирован раньше уже полученного ответа с большей версией
+                    max_version = std::max(max_version, version);
+                    const double wall_ms = std::chrono::duration<double, std::milli>(time - first_time).count();
+                    const double game_ms = static_cast<double>(max_version - first_version) * args->tick_period;
+                    max_lag_ms = std::max(max_lag_ms, wall_ms - game_ms);
+                }
+                const double final_lag_ms = std::chrono::duration<double, std::milli>(span).count()
+                    - static_cast<double>(max_version - first_version) * args->tick_period;
+                std::cout << " tick_lag_max_ms="sv << max_lag_ms << " tick_lag_final_ms="sv << final_lag_ms;
+            }
+            std::cout << std::endl;
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+// Повторная симуляция записи игры без сервера: сверяет хеш состояния после каждого тика
+// с записанным и измеряет скорость симуляции.
+// Запуск: game_replay <файл-конфигурации> <файл-записи> [--no-verify] [количество-повторов]
+#include "application.h"
+#include "json_loader.h"
+#include "recording.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string_view>
+
+using namespace std::literals;
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: game_replay <game-config-json> <recording> [--no-verify] [repeats]"sv << std::endl;
+        return EXIT_FAILURE;
+    }
+    bool verify = true;
+    unsigned repeats = 1;
+    for (int i = 3; i < argc; ++i)
+    {
+        if (argv[i] == "--no-verify"sv)
+        {
+            verify = false;
+        }
+        else
+        {
+            repeats = std::max(1ul, std::strtoul(argv[i], nullptr, 10));
+        }
+    }
+
+    try
+    {
+        const serialization::Recording recording{ argv[2] };
+        if (serialization::HashConfigFile(argv[1]) != recording.GetHeader().config_hash)
+        {
+            std::cerr << "Warning: the recording was made with a different game config"sv << std::endl;
+        }
+
+        serialization::ReplayResult result;
+        std::chrono::duration<double> best{ std::numeric_limits<double>::infinity() };
+        for (unsigned i = 0; i < repeats; ++i)
+        {
+            model::Game game = json_loader::LoadGame(argv[1]);
+            game.SetRandomSeed(recording.GetHeader().seed);
+            app::Application application{ game };
+
+            const auto start = std::chrono::steady_clock::now();
+            result = recording.Replay(application, verify);
+            best = std::min<std::chrono::duration<double>>(best, std::chrono::steady_clock::now() - start);
+            if (result.mismatch_tick)
+            {
+                break;
+            }
+        }
+
+        std::cout << "ticks="sv << result.ticks
+            << " joins="sv << result.joins
+            << " moves="sv << result.moves
+            << " verify="sv << (verify ? "on"sv : "off"sv)
+            << " seconds="sv << best.count()
+            << " ticks_per_sec="sv << static_cast<double>(result.ticks) / best.count() << std::endl;
+        if (result.mismatch_tick)
+        {
+            std::cout << "State hash mismatch after tick "sv << *result.mismatch_tick << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,517 @@
+// Микробенчмарки горячих путей обработки запросов без сокетов: разбор цели запроса, выбор маршрута,
+// сериализация карт, поиск карты и полный цикл запрос-ответ в памяти. Карты синтетические, от 10 до 100 000 дорог.
+// Каждая строка вывода - результат одного бенчмарка в виде пар ключ=значение, пригодных для сравнения между коммитами.
+// allocs_per_op - количество вызовов operator new на операцию
+// Запуск: game_server_bench [подстрока-имени] [секунд-на-бенчмарк]
+#include "memory_pool.h"
+#include "rate_limit.h"
+#include "request_arena.h"
+#include "request_handler.h"
+#include "timer_wheel.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std::literals;
+
+namespace
+{
+    std::atomic<std::uint64_t> allocations{ 0 };
+}  // namespace
+
+// Подсчёт выделений памяти во всей программе. Стандартный operator delete освобождает память через free
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size != 0 ? size : 1))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc{};
+}
+
+namespace http_handler
+{
+    struct BenchAccess
+    {
+        static void ConversionNormalTypeTarget(RequestHandler& handler, std::string& target)
+        {
+            handler.ConversionNormalTypeTarget(target);
+        }
+
+        static bool IsSubPath(RequestHandler& handler, const fs::path& path, const fs::path& base)
+        {
+            return handler.IsSubPath(path, base);
+        }
+
+        static classes_response::TypeClassResponse ParseRequest(RequestHandler& handler, StringRequest&& req)
+        {
+            return handler.ParseRequest(std::move(req));
+        }
+    };
+}  // namespace http_handler
+
+namespace
+{
+    namespace net = boost::asio;
+    namespace http = boost::beast::http;
+    namespace fs = std::filesystem;
+    using http_handler::BenchAccess;
+    using http_handler::StringRequest;
+
+    constexpr size_t SAMPLES = 5;
+    constexpr std::array ROAD_COUNTS{ size_t{ 10 }, size_t{ 100 }, size_t{ 1'000 }, size_t{ 10'000 }, size_t{ 100'000 } };
+
+    // Не даёт компилятору выбросить вычисление value
+    template <typename T>
+    void Consume(const T& value)
+    {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+
+    std::string MapId(size_t roads)
+    {
+        return "map"s + std::to_string(roads);
+    }
+
+    // Сетка чередующихся горизонтальных и вертикальных дорог со зданиями и офисами
+    model::Map MakeMap(size_t roads)
+    {
+        std::mt19937 rng{ static_cast<std::mt19937::result_type>(roads) };
+        std::uniform_int_distribution<model::Coord> length{ 5, 50 };
+        model::Map map{ model::Map::Id{ MapId(roads) }, "Map with "s + std::to_string(roads) + " roads"s };
+        const auto side = static_cast<model::Coord>(std::max<size_t>(1, static_cast<size_t>(std::sqrt(roads))));
+        for (size_t i = 0; i < roads; ++i)
+        {
+            const model::Point start{ static_cast<model::Coord>(i % side) * 60,
+                static_cast<model::Coord>(i / side) * 60 };
+            if (i % 2 == 0)
+            {
+                map.AddRoad({ model::Road::HORIZONTAL, start, start.x + length(rng) });
+            }
+            else
+            {
+                map.AddRoad({ model::Road::VERTICAL, start, start.y + length(rng) });
+            }
+            if (i % 10 == 0)
+            {
+                map.AddBuilding(model::Building{ { { start.x + 5, start.y + 5 }, { 20, 10 } } });
+            }
+            if (i % 100 == 0)
+            {
+                map.AddOffice({ model::Office::Id{ "o"s + std::to_string(i) }, start, { 1, 0 } });
+            }
+        }
+        map.AddLootType({ R"({"name":"key","file":"assets/key.obj","type":"obj","rotation":90,"color":"#338844","scale":0.03})"s, 10 });
+        return map;
+    }
+
+    model::Game MakeGame()
+    {
+        model::Game game;
+        for (const size_t roads : ROAD_COUNTS)
+        {
+            game.AddMap(MakeMap(roads));
+        }
+        return game;
+    }
+
+    // Каталог статических файлов, который удаляется при завершении бенчмарка
+    class StaticRoot
+    {
+    public:
+        StaticRoot()
+            : path_{ fs::temp_directory_path() / ("game_server_bench_"s + std::to_string(::getpid())) }
+        {
+            fs::create_directories(path_ / "css");
+            std::ofstream{ path_ / "index.html" } << "<html><body>game</body></html>"sv;
+            std::ofstream{ path_ / "css" / "style.css" } << "body { margin: 0; }"sv;
+        }
+
+        StaticRoot(const StaticRoot&) = delete;
+        StaticRoot& operator=(const StaticRoot&) = delete;
+
+        ~StaticRoot()
+        {
+            std::error_code ec;
+            fs::remove_all(path_, ec);
+        }
+
+        const fs::path& GetPath() const noexcept
+        {
+            return path_;
+        }
+
+    private:
+        fs::path path_;
+    };
+
+    StringRequest MakeRequest(http::verb method, std::string_view target, std::string_view token = {})
+    {
+        StringRequest req{ method, target, 11 };
+        if (!token.empty())
+        {
+            req.set(http::field::authorization, "Bearer "s + std::string{ token });
+        }
+        return req;
+    }
+
+    // Запрос, как его читает соединение: поля заголовка и тело размещаются в арене
+    http_server::HttpRequest MakeArenaRequest(request_arena::Arena* arena, http::verb method, std::string_view target,
+        std::string_view token = {})
+    {
+        const http_server::ArenaAllocator allocator{ arena };
+        http_server::HttpRequest req{ std::piecewise_construct, std::make_tuple(allocator), std::make_tuple(allocator) };
+        req.method(method);
+        req.target(target);
+        req.version(11);
+        if (!token.empty())
+        {
+            req.set(http::field::authorization, "Bearer "s + std::string{ token });
+        }
+        return req;
+    }
+
+    class Runner
+    {
+    public:
+        Runner(std::string_view filter, std::chrono::duration<double> min_time)
+            : filter_{ filter }
+            , min_time_{ min_time }
+        {}
+
+        // fn выполняет одну операцию и возвращает размер результата в байтах (0, если он не важен).
+        // Время партии подбирается так, чтобы каждый из SAMPLES замеров длился не меньше min_time / SAMPLES,
+        // в вывод попадают медиана и минимум времени операции по замерам
+        template <typename Fn>
+        void Run(std::string_view name, std::string_view params, Fn&& fn)
+        {
+            if (name.find(filter_) == std::string_view::npos)
+            {
+                return;
+            }
+            using Clock = std::chrono::steady_clock;
+            size_t bytes = 0;
+            const auto run_batch = [&](size_t batch)
+            {
+                const auto start = Clock::now();
+                for (size_t i = 0; i < batch; ++i)
+                {
+                    bytes = fn();
+                    Consume(bytes);
+                }
+                return std::chrono::duration<double>(Clock::now() - start);
+            };
+
+            const auto sample_time = min_time_ / SAMPLES;
+            size_t batch = 1;
+            for (auto elapsed = run_batch(batch); elapsed < sample_time; elapsed = run_batch(batch))
+            {
+                const double scale = elapsed.count() > 0.0 ? sample_time / elapsed * 1.2 : 10.0;
+                batch = std::max(batch + 1, static_cast<size_t>(static_cast<double>(batch) * std::min(scale, 10.0)));
+            }
+
+            std::array<double, SAMPLES> ns_per_op{};
+            const std::uint64_t allocations_before = allocations.load(std::memory_order_relaxed);
+            for (double& sample : ns_per_op)
+            {
+                sample = std::chrono::duration<double, std::nano>(run_batch(batch)).count() / static_cast<double>(batch);
+            }
+            const double allocs_per_op = static_cast<double>(allocations.load(std::memory_order_relaxed) - allocations_before)
+                / static_cast<double>(batch * SAMPLES);
+            std::sort(ns_per_op.begin(), ns_per_op.end());
+            std::cout << "bench="sv << name;
+            if (!params.empty())
+            {
+                std::cout << ' ' << params;
+            }
+            std::cout << " batch="sv << batch
+                << " ns_per_op_median="sv << ns_per_op[SAMPLES / 2]
+                << " ns_per_op_min="sv << ns_per_op.front()
+                << " allocs_per_op="sv << allocs_per_op
+                << " bytes="sv << bytes << std::endl;
+        }
+
+    private:
+        std::string_view filter_;
+        std::chrono::duration<double> min_time_;
+    };
+}  // namespace
+
+int main(int argc, const char* argv[])
+{
+    const std::string_view filter = argc > 1 ? argv[1] : ""sv;
+    const std::chrono::duration<double> min_time{ argc > 2 ? std::strtod(argv[2], nullptr) : 0.5 };
+
+    try
+    {
+        StaticRoot root;
+        model::Game game = MakeGame();
+        app::Application application{ game };
+        const records::RecordsStore records{ std::nullopt };
+        net::io_context ioc;
+        http_handler::RequestHandler handler{ application, game, records, root.GetPath(), net::make_strand(ioc), {} };
+        const auto joined = application.JoinGame("bench"s, model::Map::Id{ MapId(ROAD_COUNTS.front()) });
+        const std::string token = *joined->token;
+        Runner runner{ filter, min_time };
+
+        for (const std::string_view target : { "/api/v1/maps/map1000"sv, "/images/my%20photo+1.PNG"sv })
+        {
+            runner.Run("conversion_target"sv, "target="s + std::string{ target }, [&]
+            {
+                std::string value{ target };
+                BenchAccess::ConversionNormalTypeTarget(handler, value);
+                return value.size();
+            });
+        }
+
+        const fs::path style = root.GetPath() / "css" / "style.css";
+        const fs::path outside = root.GetPath() / ".." / "etc" / "passwd";
+        runner.Run("is_sub_path"sv, "path=inside"sv, [&]
+        {
+            return size_t{ BenchAccess::IsSubPath(handler, style, root.GetPath()) };
+        });
+        runner.Run("is_sub_path"sv, "path=outside"sv, [&]
+        {
+            return size_t{ BenchAccess::IsSubPath(handler, outside, root.GetPath()) };
+        });
+
+        const std::string map_target = "/api/v1/maps/"s + MapId(ROAD_COUNTS.back());
+        for (const std::string_view target : { "/api/v1/maps"sv, std::string_view{ map_target }, "/css/style.css"sv,
+            "/api/v1/game/players"sv })
+        {
+            runner.Run("parse_request"sv, "target="s + std::string{ target }, [&]
+            {
+                const auto result = BenchAccess::ParseRequest(handler, MakeRequest(http::verb::get, target, token));
+                return result.data.size();
+            });
+        }
+
+        for (const model::Map& map : game.GetMaps())
+        {
+            const std::string params = "roads="s + std::to_string(map.GetRoads().size());
+            runner.Run("json_map_id"sv, params, [&]
+            {
+                return boost::json::serialize(json_loader::MakeJsonResponseMapId(map)).size();
+            });
+        }
+        runner.Run("json_maps"sv, "maps="s + std::to_string(game.GetMaps().size()), [&]
+        {
+            return boost::json::serialize(json_loader::MakeJsonResponseMaps(game.GetMaps())).size();
+        });
+
+        const model::Map::Id existing{ MapId(ROAD_COUNTS.back()) };
+        const model::Map::Id missing{ "no-such-map"s };
+        runner.Run("find_map"sv, "hit=1"sv, [&]
+        {
+            return size_t{ game.FindMap(existing) != nullptr };
+        });
+        runner.Run("find_map"sv, "hit=0"sv, [&]
+        {
+            return size_t{ game.FindMap(missing) != nullptr };
+        });
+
+        // Полный цикл: обработчик получает запрос и передаёт готовый ответ в send.
+        // Запросы игрового API выполняются в api strand, поэтому после каждого запроса io_context опрашивается
+        size_t response_size = 0;
+        const auto send = [&response_size](auto&& response)
+        {
+            response_size = response.payload_size().value_or(0);
+            Consume(response);
+        };
+        const auto round_trip = [&](std::string_view target)
+        {
+            return [&, target]
+            {
+                handler(MakeRequest(http::verb::get, target, token), send);
+                if (target.starts_with(classes_response::RequestType::API_V1_GAME))
+                {
+                    ioc.restart();
+                    ioc.poll();
+                }
+                return response_size;
+            };
+        };
+        runner.Run("round_trip"sv, "target=/api/v1/maps"sv, round_trip("/api/v1/maps"sv));
+        std::vector<std::string> map_targets;
+        for (const size_t roads : ROAD_COUNTS)
+        {
+            map_targets.push_back("/api/v1/maps/"s + MapId(roads));
+        }
+        for (size_t i = 0; i < map_targets.size(); ++i)
+        {
+            runner.Run("round_trip"sv, "target=/api/v1/maps/{id} roads="s + std::to_string(ROAD_COUNTS[i]),
+                round_trip(map_targets[i]));
+        }
+        runner.Run("round_trip"sv, "target=/css/style.css"sv, round_trip("/css/style.css"sv));
+        runner.Run("round_trip"sv, "target=/api/v1/game/state"sv, round_trip("/api/v1/game/state"sv));
+        runner.Run("round_trip"sv, "target=/api/v1/game/players"sv, round_trip("/api/v1/game/players"sv));
+
+        // Тот же цикл с ареной запроса: арена возвращается к началу перед каждым запросом, как в соединении
+        request_arena::Arena* arena = request_arena::Arena::Create();
+        for (const std::string_view target : { "/api/v1/maps"sv, "/api/v1/game/state"sv })
+        {
+            runner.Run("round_trip"sv, "target="s + std::string{ target } + " arena=1"s, [&, target]
+            {
+                arena->Reset();
+                const request_arena::Scope arena_scope{ arena };
+                handler(MakeArenaRequest(arena, http::verb::get, target, token), send);
+                if (target.starts_with(classes_response::RequestType::API_V1_GAME))
+                {
+                    ioc.restart();
+                    ioc.poll();
+                }
+                return response_size;
+            });
+        }
+        arena->Release();
+
+        // Объекты соединения с пулами памяти потока и без них
+        for (const size_t capacity : { memory_pool::DEFAULT_CAPACITY, size_t{ 0 } })
+        {
+            memory_pool::SetCapacity(capacity);
+            const std::string params = "pool="s + (capacity != 0 ? "1"s : "0"s);
+            const auto session_handler = [](auto&&, auto&&) {};
+            runner.Run("session_create"sv, params, [&]
+            {
+                const auto session = http_server::MakeSession(net::ip::tcp::socket{ ioc }, session_handler,
+                    http_server::NoUpgrade{}, http_server::Settings{});
+                return sizeof(*session);
+            });
+            runner.Run("read_buffer"sv, params, [&]
+            {
+                http_server::ReadBuffer buffer;
+                buffer.reserve(memory_pool::BUFFER_BLOCK_SIZE);
+                buffer.commit(net::buffer_copy(buffer.prepare(16), net::buffer("GET / HTTP/1.1\r\n"sv)));
+                return buffer.size();
+            });
+            runner.Run("response_copy"sv, params, [&]
+            {
+                http::response<http::string_body> response{ http::status::ok, 11 };
+                const auto shared = http_server::MakeSharedResponse(std::move(response));
+                return size_t{ shared->result_int() };
+            });
+        }
+        memory_pool::SetCapacity(memory_pool::DEFAULT_CAPACITY);
+
+        // Сроки одного запроса keep-alive соединения (ожидание, чтение, запись), пока ждут ещё connections
+        // соединений: колесо таймеров (wheel=1) и таймеры Asio, которые beast::tcp_stream заводит на каждую операцию (wheel=0)
+        const http_server::Timeouts timeouts;
+        for (const size_t connections : { size_t{ 1 }, size_t{ 100'000 } })
+        {
+            const std::string params = "connections="s + std::to_string(connections);
+            timer_wheel::Wheel wheel{ {} };
+            std::vector<std::unique_ptr<timer_wheel::Deadline>> waiting;
+            for (size_t i = 0; i < connections; ++i)
+            {
+                waiting.push_back(std::make_unique<timer_wheel::Deadline>(&wheel, -1));
+                waiting.back()->Arm(timeouts.idle);
+            }
+            timer_wheel::Deadline deadline{ &wheel, -1 };
+            runner.Run("timeout_arm"sv, params + " wheel=1"s, [&]
+            {
+                deadline.Arm(timeouts.idle);
+                deadline.Arm(timeouts.read);
+                deadline.Disarm();
+                deadline.Arm(timeouts.write);
+                return size_t{ 0 };
+            });
+            waiting.clear();
+
+            net::io_context timer_ioc;
+            std::vector<std::unique_ptr<net::steady_timer>> pending;
+            for (size_t i = 0; i < connections; ++i)
+            {
+                pending.push_back(std::make_unique<net::steady_timer>(timer_ioc, timeouts.idle));
+                pending.back()->async_wait([](boost::system::error_code) {});
+            }
+            net::steady_timer timer{ timer_ioc };
+            runner.Run("timeout_arm"sv, params + " wheel=0"s, [&]
+            {
+                for (const auto timeout : { timeouts.idle, timeouts.read, timeouts.write })
+                {
+                    timer.expires_after(timeout);
+                    timer.async_wait([](boost::system::error_code) {});
+                    timer.cancel();
+                }
+                timer_ioc.restart();
+                timer_ioc.poll();
+                return size_t{ 0 };
+            });
+        }
+
+        // Проверка запроса ограничением частоты, включая чтение часов: один клиент, клиенты, разбросанные
+        // по таблице, и те же клиенты, пока ещё threads - 1 потоков проверяют запросы других клиентов той же таблицы.
+        // limited=1 - корзина клиента пуста, и проверка возвращает ответ 429
+        rate_limit::Settings limiter_settings;
+        limiter_settings.classify = &http_handler::RequestHandler::ClassifyPriority;
+        for (rate_limit::Rate& rate : limiter_settings.rates)
+        {
+            rate = { 1e9, 1e9 };
+        }
+        const unsigned hardware_threads = std::max(2u, std::thread::hardware_concurrency());
+        for (const auto& [clients, threads] : { std::pair{ size_t{ 1 }, 1u }, std::pair{ size_t{ 10'000 }, 1u },
+            std::pair{ size_t{ 10'000 }, hardware_threads } })
+        {
+            rate_limit::Limiter limiter{ limiter_settings };
+            std::mt19937_64 random{ 1 };
+            std::vector<std::uint64_t> keys(clients);
+            for (std::uint64_t& key : keys)
+            {
+                key = rate_limit::Limiter::ClientKey(net::ip::address_v4{ static_cast<std::uint32_t>(random()) });
+            }
+            std::atomic<bool> stop{ false };
+            std::vector<std::thread> load;
+            for (unsigned i = 1; i < threads; ++i)
+            {
+                load.emplace_back([&, i]
+                {
+                    for (size_t n = i; !stop.load(std::memory_order_relaxed); ++n)
+                    {
+                        Consume(limiter.Acquire(keys[n % keys.size()], "/api/v1/maps/map1"sv,
+                            rate_limit::Limiter::Clock::now()).size());
+                    }
+                });
+            }
+            size_t next = 0;
+            runner.Run("rate_limit"sv, "clients="s + std::to_string(clients) + " threads="s + std::to_string(threads)
+                + " limited=0"s, [&]
+            {
+                next = next + 1 == keys.size() ? 0 : next + 1;
+                return limiter.Acquire(keys[next], "/api/v1/maps/map1"sv, rate_limit::Limiter::Clock::now()).size();
+            });
+            stop = true;
+            for (std::thread& thread : load)
+            {
+                thread.join();
+            }
+        }
+        limiter_settings.rates.fill({ 1.0, 1.0 });
+        rate_limit::Limiter limited{ limiter_settings };
+        const std::uint64_t client = rate_limit::Limiter::ClientKey(net::ip::make_address("10.0.0.1"));
+        runner.Run("rate_limit"sv, "clients=1 threads=1 limited=1"sv, [&]
+        {
+            return limited.Acquire(client, "/api/v1/maps/map1"sv, rate_limit::Limiter::Clock::now()).size();
+        });
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+// Микробенчмарк поиска событий сбора трофеев: сетка против полного перебора.
+// Запуск: gather_bench [количество-собак] [количество-трофеев] [количество-повторов]
+#include "collision_detector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <tuple>
+
+using namespace std::literals;
+
+namespace
+{
+    constexpr double MAP_SIZE = 1000.0;
+    // Перемещение собаки со скоростью 3 за тик 50 мс
+    constexpr double STEP = 0.15;
+
+    class Provider : public collision_detector::ItemGathererProvider
+    {
+    public:
+        Provider(size_t gatherers, size_t items)
+        {
+            std::mt19937_64 rng{ 42 };
+            std::uniform_real_distribution<double> coord{ 0.0, MAP_SIZE };
+            std::uniform_int_distribution<int> direction{ 0, 3 };
+            items_.reserve(items);
+            for (size_t i = 0; i < items; ++i)
+            {
+                items_.push_back({ { coord(rng), coord(rng) }, 0.0 });
+            }
+            gatherers_.reserve(gatherers);
+            for (size_t i = 0; i < gatherers; ++i)
+            {
+                const collision_detector::Point2D start{ coord(rng), coord(rng) };
+                collision_detector::Point2D end = start;
+                switch (direction(rng))
+                {
+                case 0:
+                    end.x += STEP;
+                    break;
+                case 1:
+                    end.x -= STEP;
+                    break;
+                case 2:
+                    end.y += STEP;
+                    break;
+                default:
+                    end.y -= STEP;
+                }
+                gatherers_.push_back({ start, end, 0.3 });
+            }
+        }
+
+        size_t ItemsCount() const override
+        {
+            return items_.size();
+        }
+
+        collision_detector::Item GetItem(size_t idx) const override
+        {
+            return items_[idx];
+        }
+
+        size_t GatherersCount() const override
+        {
+            return gatherers_.size();
+        }
+
+        collision_detector::Gatherer GetGatherer(size_t idx) const override
+        {
+            return gatherers_[idx];
+        }
+
+    private:
+        std::vector<collision_detector::Item> items_;
+        std::vector<collision_detector::Gatherer> gatherers_;
+    };
+
+    // Эталон: каждая пара собака-трофей проверяется напрямую
+    std::vector<collision_detector::GatheringEvent> FindGatherEventsNaive(const Provider& provider)
+    {
+        std::vector<collision_detector::GatheringEvent> events;
+        for (size_t g = 0; g < provider.GatherersCount(); ++g)
+        {
+            const auto gatherer = provider.GetGatherer(g);
+            for (size_t i = 0; i < provider.ItemsCount(); ++i)
+            {
+                const auto item = provider.GetItem(i);
+                const auto result = collision_detector::TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
+                if (result.IsCollected(gatherer.width + item.width))
+                {
+                    events.push_back({ i, g, result.sq_distance, result.proj_ratio });
+                }
+            }
+        }
+        std::sort(events.begin(), events.end(), [](const auto& lhs, const auto& rhs)
+        {
+            return std::tie(lhs.time, lhs.gatherer_id, lhs.item_id) < std::tie(rhs.time, rhs.gatherer_id, rhs.item_id);
+        });
+        return events;
+    }
+
+    bool SameEvents(const std::vector<collision_detector::GatheringEvent>& lhs,
+        const std::vector<collision_detector::GatheringEvent>& rhs)
+    {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const auto& a, const auto& b)
+        {
+            return a.item_id == b.item_id && a.gatherer_id == b.gatherer_id && a.time == b.time;
+        });
+    }
+
+    template <typename Fn>
+    double MeasureMs(size_t repeats, const Fn& fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t r = 0; r < repeats; ++r)
+        {
+            fn();
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(repeats);
+    }
+}  // namespace
+
+int main(int argc, const char* argv[])
+{
+    const size_t dogs = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000;
+    const size_t items = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10'000;
+    const size_t repeats = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10;
+
+    const Provider provider{ dogs, items };
+    std::vector<collision_detector::GatheringEvent> grid_events;
+    std::vector<collision_detector::GatheringEvent> naive_events;
+    const double grid_ms = MeasureMs(repeats, [&]
+    {
+        grid_events = collision_detector::FindGatherEvents(provider);
+    });
+    const double naive_ms = MeasureMs(repeats, [&]
+    {
+        naive_events = FindGatherEventsNaive(provider);
+    });
+
+    const bool match = SameEvents(grid_events, naive_events);
+    std::cout << "dogs="sv << dogs
+        << " items="sv << items
+        << " events="sv << grid_events.size()
+        << " grid_ms="sv << grid_ms
+        << " naive_ms="sv << naive_ms
+        << " match="sv << (match ? "yes"sv : "no"sv) << std::endl;
+    return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,32 +1,211 @@
 #include "http_server.h"
 
 #include <boost/asio/dispatch.hpp>
-#include <iostream>
+
+#include "logger.h"
 
 namespace http_server
 {
     void ReportError(beast::error_code ec, std::string_view what)
     {
-        std::cerr << what << ": "sv << ec.message() << std::endl;
+        logger::Error(ec, what);
     }
 
+    UpgradeRequest ToUpgradeRequest(const HttpRequest& request)
+    {
+        UpgradeRequest result{ request.method(), request.target(), request.version() };
+        for (const auto& field : request)
+        {
+            result.insert(field.name_string(), field.value());
+        }
+        result.body().assign(request.body());
+        return result;
+    }
 
+    std::uint64_t ClientKey(const tcp::socket& socket, const Settings& settings) noexcept
+    {
+        if (!settings.rate_limit)
+        {
+            return 0;
+        }
+        sys::error_code ec;
+        const tcp::endpoint endpoint = socket.remote_endpoint(ec);
+        return ec ? 0 : rate_limit::Limiter::ClientKey(endpoint.address());
+    }
+
+    namespace
+    {
+        HttpRequest MakeRequest(request_arena::Arena* arena)
+        {
+            return HttpRequest{ std::piecewise_construct, std::make_tuple(ArenaAllocator{ arena }),
+                std::make_tuple(ArenaAllocator{ arena }) };
+        }
+    }  // namespace
+
+    //------------------PhaseTimer----------------
+    PhaseTimer::PhaseTimer(beast::tcp_stream& stream, const Timeouts& timeouts) noexcept
+        : stream_{ stream }
+        , timeouts_{ timeouts }
+        , deadline_{ timer_wheel::Current(), stream.socket().native_handle() }
+    {}
+
+    void PhaseTimer::Start(metrics::Phase phase)
+    {
+        phase_ = phase;
+        std::chrono::milliseconds timeout = timeouts_.write;
+        if (phase == metrics::Phase::IDLE)
+        {
+            timeout = timeouts_.idle;
+        }
+        else if (phase == metrics::Phase::READ)
+        {
+            timeout = timeouts_.read;
+        }
+        if (deadline_.Bound())
+        {
+            return deadline_.Arm(timeout);
+        }
+        stream_.expires_after(timeout);
+    }
+
+    void PhaseTimer::Stop() noexcept
+    {
+        if (deadline_.Bound())
+        {
+            return deadline_.Disarm();
+        }
+        stream_.expires_never();
+    }
+
+    void PhaseTimer::Release() noexcept
+    {
+        deadline_.Cancel();
+        stream_.expires_never();
+    }
+
+    bool PhaseTimer::TimedOut(beast::error_code ec) const noexcept
+    {
+        // Колесо закрывает сокет, поэтому операция завершается не ошибкой timeout, а ошибкой закрытого соединения
+        if (ec == beast::error::timeout || deadline_.Expired())
+        {
+            metrics::CountTimeout(phase_);
+            return true;
+        }
+        return false;
+    }
+
+    //------------------Exchange----------------
+    void Exchange::RequestRead(std::size_t bytes_read)
+    {
+        const auto read_end = std::chrono::steady_clock::now();
+        metrics::CountRead(read_end - read_start_, bytes_read);
+        trace_ = tracing::SampleRequest();
+        if (trace_)
+        {
+            tracing::Record(trace_, "read", read_start_, read_end);
+        }
+    }
+
+    void Exchange::RequestStarted(const HttpRequest& request)
+    {
+        if (logger::IsEnabled(logger::Level::INFO))
+        {
+            // Память строки переиспользуется между запросами соединения
+            request_start_ = std::chrono::steady_clock::now();
+            request_method_ = http::to_string(request.method());
+            request_target_.assign(request.target());
+        }
+        metrics::CountRequestStarted();
+    }
+
+    void Exchange::WriteFinished(beast::error_code ec, std::size_t bytes_written)
+    {
+        metrics::CountRequestFinished();
+        if (ec)
+        {
+            return;
+        }
+        const auto write_end = std::chrono::steady_clock::now();
+        metrics::CountWrite(write_end - write_start_, bytes_written);
+        if (trace_)
+        {
+            tracing::Record(trace_, "write", write_start_, write_end);
+        }
+        if (logger::IsEnabled(logger::Level::INFO))
+        {
+            logger::Access(request_method_, request_target_, response_status_,
+                std::chrono::duration_cast<std::chrono::microseconds>(write_end - request_start_), bytes_written);
+        }
+    }
 
     //------------------SessionBase----------------
-    SessionBase::SessionBase(tcp::socket&& socket)
+    SessionBase::SessionBase(tcp::socket&& socket, const Settings& settings)
         : stream_(std::move(socket))
-    {}
+        , timer_(stream_, settings.timeouts)
+        , arena_(request_arena::Arena::Create())
+        , request_(MakeRequest(arena_))
+        , gate_(settings.admission)
+        , limiter_(settings.rate_limit)
+        , client_(ClientKey(stream_.socket(), settings))
+    {
+        // Один блок пула вмещает обычный запрос целиком
+        buffer_.reserve(memory_pool::BUFFER_BLOCK_SIZE);
+        metrics::CountSessionOpened();
+    }
 
-    void SessionBase::Read()
+    SessionBase::~SessionBase()
     {
         request_ = {};
-        stream_.expires_after(30s);
+        arena_->Release();
+        metrics::CountSessionClosed();
+    }
 
-        http::async_read(stream_, buffer_, request_,
-            beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
+    void SessionBase::Read()
+    {
+        // Предыдущий запрос и ответ на него уже освобождены, если обработчик их не задержал
+        arena_->Reset();
+        request_ = MakeRequest(arena_);
+
+        if (buffer_.size() != 0)
+        {
+            // Начало следующего запроса уже получено вместе с предыдущим
+            timer_.Start(metrics::Phase::READ);
+            exchange_.ReadStarted();
+            return ReadRequest();
+        }
+        timer_.Start(metrics::Phase::IDLE);
+        // Первые байты читаются отдельно, чтобы простой соединения между запросами
+        // не входил во время чтения запроса. Лишнего системного вызова это не добавляет:
+        // http::async_read начал бы с такого же чтения
+        stream_.async_read_some(buffer_.prepare(beast::read_size(buffer_, 65536)),
+            beast::bind_front_handler(&SessionBase::OnReadStart, GetSharedThis()));
     }
 
+    void SessionBase::OnReadStart(beast::error_code ec, std::size_t bytes_read)
+    {
+        if (ec && timer_.TimedOut(ec))
+        {
+            return ReportError(beast::error::timeout, "read"sv);
+        }
+        if (ec == net::error::eof)
+        {
+            return Close();
+        }
+        if (ec)
+        {
+            return ReportError(ec, "read"sv);
+        }
+        buffer_.commit(bytes_read);
+        timer_.Start(metrics::Phase::READ);
+        exchange_.ReadStarted();
+        ReadRequest();
+    }
 
+    void SessionBase::ReadRequest()
+    {
+        http::async_read(stream_, buffer_, request_,
+            beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
+    }
 
     void SessionBase::Run()
     {
@@ -34,8 +213,12 @@ namespace http_server
             beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
     }
 
-    void SessionBase::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read)
+    void SessionBase::OnRead(beast::error_code ec, std::size_t bytes_read)
     {
+        if (ec && timer_.TimedOut(ec))
+        {
+            return ReportError(beast::error::timeout, "read"sv);
+        }
         if (ec == http::error::end_of_stream)
         {
             return Close();
@@ -44,9 +227,38 @@ namespace http_server
         {
             return ReportError(ec, "read"sv);
         }
+        timer_.Stop();
+        exchange_.RequestRead(bytes_read);
+        if (beast::websocket::is_upgrade(request_))
+        {
+            return HandleUpgrade(std::move(request_));
+        }
+        if (limiter_)
+        {
+            if (const std::string_view limited = limiter_->Acquire(client_, request_.target(),
+                std::chrono::steady_clock::now()); !limited.empty())
+            {
+                return Reject(limited, false);
+            }
+        }
+        if (!gate_.Admit())
+        {
+            return Reject(gate_.Rejection(), true);
+        }
+        exchange_.RequestStarted(request_);
+        // Обработчик узнаёт о трассировке запроса через tracing::CurrentRequest,
+        // а ответы, созданные им в этом потоке, размещают поля заголовка в арене соединения
+        const tracing::RequestScope trace_scope{ exchange_.Trace() };
+        const request_arena::Scope arena_scope{ arena_ };
         HandleRequest(std::move(request_));
     }
 
+    beast::tcp_stream SessionBase::ReleaseStream()
+    {
+        timer_.Release();
+        return std::move(stream_);
+    }
+
     void SessionBase::Close()
     {
         beast::error_code ec;
@@ -54,10 +266,32 @@ namespace http_server
     }
 
     void SessionBase::OnWrite(bool close, beast::error_code ec, std::size_t bytes_written)
+    {
+        exchange_.WriteFinished(ec, bytes_written);
+        if (ec)
+        {
+            return ReportError(timer_.TimedOut(ec) ? beast::error_code{ beast::error::timeout } : ec, "write"sv);
+        }
+        if (close)
+        {
+            return Close();
+        }
+        Read();
+    }
+
+    void SessionBase::Reject(std::string_view response, bool close)
+    {
+        timer_.Start(metrics::Phase::WRITE);
+        // Ответ хранится в Controller или Limiter, которые живут дольше соединений
+        net::async_write(stream_, net::buffer(response.data(), response.size()),
+            beast::bind_front_handler(&SessionBase::OnReject, GetSharedThis(), close));
+    }
+
+    void SessionBase::OnReject(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written)
     {
         if (ec)
         {
-            return ReportError(ec, "write"sv);
+            return ReportError(timer_.TimedOut(ec) ? beast::error_code{ beast::error::timeout } : ec, "write"sv);
         }
         if (close)
         {
@@ -65,4 +299,164 @@ namespace http_server
         }
         Read();
     }
+
+    //------------------CoroutineSessionBase----------------
+    CoroutineSessionBase::CoroutineSessionBase(tcp::socket&& socket, const Settings& settings)
+        : stream_(std::move(socket))
+        , timer_(stream_, settings.timeouts)
+        , arena_(request_arena::Arena::Create())
+        , response_ready_(stream_.get_executor(), net::steady_timer::time_point::max())
+        , gate_(settings.admission)
+        , limiter_(settings.rate_limit)
+        , client_(ClientKey(stream_.socket(), settings))
+    {
+        buffer_.reserve(memory_pool::BUFFER_BLOCK_SIZE);
+        metrics::CountSessionOpened();
+    }
+
+    CoroutineSessionBase::~CoroutineSessionBase()
+    {
+        parser_.reset();
+        response_.Reset();
+        arena_->Release();
+        metrics::CountSessionClosed();
+    }
+
+    bool CoroutineSessionBase::StartRead()
+    {
+        // Парсер не переиспользуется между сообщениями, но создаётся на месте, без выделения памяти.
+        // Предыдущий запрос и ответ на него уже освобождены, если обработчик их не задержал
+        parser_.reset();
+        arena_->Reset();
+        parser_.emplace(std::piecewise_construct, std::make_tuple(ArenaAllocator{ arena_ }),
+            std::make_tuple(ArenaAllocator{ arena_ }));
+        if (buffer_.size() != 0)
+        {
+            // Начало следующего запроса уже получено вместе с предыдущим
+            timer_.Start(metrics::Phase::READ);
+            exchange_.ReadStarted();
+            return false;
+        }
+        timer_.Start(metrics::Phase::IDLE);
+        return true;
+    }
+
+    bool CoroutineSessionBase::OnReadStart(std::size_t bytes_read)
+    {
+        if (ec_ && timer_.TimedOut(ec_))
+        {
+            ReportError(beast::error::timeout, "read"sv);
+            return false;
+        }
+        if (ec_ == net::error::eof)
+        {
+            Close();
+            return false;
+        }
+        if (ec_)
+        {
+            ReportError(ec_, "read"sv);
+            return false;
+        }
+        buffer_.commit(bytes_read);
+        timer_.Start(metrics::Phase::READ);
+        exchange_.ReadStarted();
+        return true;
+    }
+
+    bool CoroutineSessionBase::OnRead(std::size_t bytes_read)
+    {
+        if (ec_ && timer_.TimedOut(ec_))
+        {
+            ReportError(beast::error::timeout, "read"sv);
+            return false;
+        }
+        if (ec_ == http::error::end_of_stream)
+        {
+            Close();
+            return false;
+        }
+        if (ec_)
+        {
+            ReportError(ec_, "read"sv);
+            return false;
+        }
+        timer_.Stop();
+        exchange_.RequestRead(bytes_read);
+        return true;
+    }
+
+    std::string_view CoroutineSessionBase::RateLimit()
+    {
+        if (!limiter_)
+        {
+            return {};
+        }
+        return limiter_->Acquire(client_, parser_->get().target(), std::chrono::steady_clock::now());
+    }
+
+    bool CoroutineSessionBase::Admit()
+    {
+        return gate_.Admit();
+    }
+
+    net::const_buffer CoroutineSessionBase::Rejection(std::string_view response)
+    {
+        timer_.Start(metrics::Phase::WRITE);
+        return net::buffer(response.data(), response.size());
+    }
+
+    bool CoroutineSessionBase::OnReject(bool close, [[maybe_unused]] std::size_t bytes_written)
+    {
+        if (ec_)
+        {
+            ReportError(timer_.TimedOut(ec_) ? beast::error_code{ beast::error::timeout } : ec_, "write"sv);
+            return false;
+        }
+        if (close)
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void CoroutineSessionBase::StartWrite()
+    {
+        has_response_ = false;
+        gate_.Complete();
+        exchange_.WriteStarted(response_.Status());
+        timer_.Start(metrics::Phase::WRITE);
+    }
+
+    bool CoroutineSessionBase::OnWrite(std::size_t bytes_written)
+    {
+        const bool close = response_.NeedEof();
+        // Тело ответа (например, открытый файл) освобождается сразу, не дожидаясь следующего запроса
+        response_.Reset();
+        exchange_.WriteFinished(ec_, bytes_written);
+        if (ec_)
+        {
+            ReportError(timer_.TimedOut(ec_) ? beast::error_code{ beast::error::timeout } : ec_, "write"sv);
+            return false;
+        }
+        if (close)
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void CoroutineSessionBase::Close()
+    {
+        beast::error_code ec;
+        stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+    }
+
+    beast::tcp_stream CoroutineSessionBase::ReleaseStream()
+    {
+        timer_.Release();
+        return std::move(stream_);
+    }
 }
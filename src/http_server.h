@@ -6,12 +6,32 @@
 // boost.beast будет использовать std::string_view вместо boost::string_view
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/redirect_error.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/use_awaitable.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <boost/beast/websocket/rfc6455.hpp>
 
+#include "admission.h"
+#include "memory_pool.h"
+#include "metrics.h"
+#include "rate_limit.h"
+#include "request_arena.h"
+#include "timer_wheel.h"
+#include "tracing.h"
+
+#include <chrono>
+#include <cstddef>
 #include <iostream>
+#include <new>
+#include <optional>
 #include <string_view>
 #include <memory>
 
@@ -25,8 +45,140 @@ namespace http_server
     namespace http = beast::http;
     namespace sys = boost::system;
 
+    // Записывает ошибку в журнал сервера. what должна быть строкой со статическим временем жизни
     void ReportError(beast::error_code ec, std::string_view what);
 
+    // Запросы соединения и поля заголовков ответов на них размещаются в арене соединения
+    using ArenaAllocator = request_arena::Allocator<char>;
+    using ArenaFields = http::basic_fields<ArenaAllocator>;
+    using HttpRequest = http::request<http::basic_string_body<char, std::char_traits<char>, ArenaAllocator>, ArenaFields>;
+
+    // Запрос, с которым соединение передаётся обработчику Upgrade. Соединение переживает арену сессии,
+    // поэтому запрос копируется в обычную память
+    using UpgradeRequest = http::request<http::string_body>;
+
+    UpgradeRequest ToUpgradeRequest(const HttpRequest& request);
+
+    // Буфер чтения соединения. Его память берётся из пула потока, если запросы соединения в неё помещаются
+    using ReadBuffer = beast::basic_flat_buffer<memory_pool::Allocator<char, metrics::Pool::BUFFER,
+        memory_pool::BUFFER_BLOCK_SIZE>>;
+
+    // Копирует ответ в память из пула потока, чтобы он пережил асинхронную запись
+    template <typename Body, typename Fields>
+    std::shared_ptr<http::response<Body, Fields>> MakeSharedResponse(http::response<Body, Fields>&& response)
+    {
+        using Response = http::response<Body, Fields>;
+        return std::allocate_shared<Response>(memory_pool::Allocator<Response, metrics::Pool::RESPONSE>{},
+            std::move(response));
+    }
+
+    // Обработчик запросов Upgrade по умолчанию: такие запросы обрабатываются как обычные HTTP-запросы
+    struct NoUpgrade
+    {};
+
+    // Способ обслуживания соединений
+    enum class SessionModel
+    {
+        // Цепочка обработчиков завершения, владеющих сессией через shared_ptr
+        CALLBACK,
+        // Одна сопрограмма на соединение, в кадре которой хранятся буферы и ответ
+        COROUTINE
+    };
+
+    // Таймауты фаз соединения
+    struct Timeouts
+    {
+        // Ожидание следующего запроса
+        std::chrono::milliseconds idle = 30s;
+        // Чтение запроса после получения его первых байтов
+        std::chrono::milliseconds read = 30s;
+        std::chrono::milliseconds write = 30s;
+    };
+
+    struct Settings
+    {
+        SessionModel model = SessionModel::CALLBACK;
+        Timeouts timeouts;
+        // Пределы соединений и запросов. nullptr - без пределов
+        admission::Controller* admission = nullptr;
+        // Ограничение частоты запросов с одного адреса. nullptr - без ограничения
+        rate_limit::Limiter* rate_limit = nullptr;
+    };
+
+    // Ключ клиента соединения для rate_limit::Limiter. Без ограничения частоты адрес не запрашивается
+    std::uint64_t ClientKey(const tcp::socket& socket, const Settings& settings) noexcept;
+
+    // Таймауты одного соединения. Срок фазы отслеживает колесо таймеров потока, создавшего соединение:
+    // назначение срока на каждый запрос не затрагивает очередь таймеров Asio. В потоке без колеса
+    // (например, в бенчмарках) срок отслеживает таймер beast::tcp_stream
+    class PhaseTimer
+    {
+    public:
+        PhaseTimer(beast::tcp_stream& stream, const Timeouts& timeouts) noexcept;
+
+        void Start(metrics::Phase phase);
+
+        // Обработка запроса не ограничена по времени
+        void Stop() noexcept;
+
+        // Колесо больше не обращается к сокету: соединение передаётся другому протоколу
+        void Release() noexcept;
+
+        // Операция завершилась ошибкой ec из-за истечения срока текущей фазы. Таймаут учитывается в метриках
+        bool TimedOut(beast::error_code ec) const noexcept;
+
+    private:
+        beast::tcp_stream& stream_;
+        Timeouts timeouts_;
+        timer_wheel::Deadline deadline_;
+        metrics::Phase phase_ = metrics::Phase::IDLE;
+    };
+
+    // Учёт одного обмена запрос-ответ соединения: метрики чтения и записи, трассировка и журнал доступа.
+    // Соединение обрабатывает запросы по одному, поэтому объект переиспользуется между запросами
+    class Exchange
+    {
+    public:
+        // Получены первые байты запроса
+        void ReadStarted() noexcept
+        {
+            read_start_ = std::chrono::steady_clock::now();
+        }
+
+        // Запрос прочитан и разобран. Решает, трассируется ли запрос
+        void RequestRead(std::size_t bytes_read);
+
+        // Запрос передан обработчику
+        void RequestStarted(const HttpRequest& request);
+
+        tracing::RequestId Trace() const noexcept
+        {
+            return trace_;
+        }
+
+        void WriteStarted(unsigned status) noexcept
+        {
+            response_status_ = status;
+            write_start_ = std::chrono::steady_clock::now();
+        }
+
+        // Запись ответа завершена. При ошибке учитывается только завершение запроса
+        void WriteFinished(beast::error_code ec, std::size_t bytes_written);
+
+    private:
+        // Начало чтения текущего запроса (получение его первых байтов) и записи ответа на него
+        std::chrono::steady_clock::time_point read_start_;
+        std::chrono::steady_clock::time_point write_start_;
+        // Текущий запрос, если он выбран для трассировки
+        tracing::RequestId trace_ = 0;
+
+        // Данные текущего запроса для журнала доступа
+        std::chrono::steady_clock::time_point request_start_;
+        std::string_view request_method_;
+        std::string request_target_;
+        unsigned response_status_ = 0;
+    };
+
     class SessionBase
     {
     public:
@@ -37,47 +189,74 @@ namespace http_server
         void Run();
 
     protected:
-        using HttpRequest = http::request<http::string_body>;
+        SessionBase(tcp::socket&& socket, const Settings& settings);
+        ~SessionBase();
 
-        explicit SessionBase(tcp::socket&& socket);
-        ~SessionBase() = default;
+        // Передаёт соединение другому протоколу. После вызова сессия больше не читает запросы
+        beast::tcp_stream ReleaseStream();
 
         template<typename Body, typename Fields>
         void Write(http::response<Body, Fields>&& response)
         {
-            auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
+            auto safe_response = MakeSharedResponse(std::move(response));
             auto self = GetSharedThis();
-            http::async_write(stream_, *safe_response,
-                [safe_response, self](beast::error_code ec, std::size_t bytes_written)
-                {
-                    self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                });
+            // Ответ может быть сформирован в другом потоке (например, в api strand),
+            // поэтому запись начинается в strand сессии
+            net::dispatch(stream_.get_executor(), [safe_response, self]
+            {
+                self->gate_.Complete();
+                self->exchange_.WriteStarted(safe_response->result_int());
+                self->timer_.Start(metrics::Phase::WRITE);
+                http::async_write(self->stream_, *safe_response,
+                    [safe_response, self](beast::error_code ec, std::size_t bytes_written) mutable
+                    {
+                        const bool close = safe_response->need_eof();
+                        // Ответ освобождается до чтения следующего запроса, чтобы арена вернулась к началу
+                        safe_response.reset();
+                        self->OnWrite(close, ec, bytes_written);
+                    });
+            });
         }
 
     private:
         beast::tcp_stream stream_;
-        beast::flat_buffer buffer_;
+        // Объявлен после потока: колесо перестаёт обращаться к сокету раньше, чем он закрывается
+        PhaseTimer timer_;
+        ReadBuffer buffer_;
+        request_arena::Arena* arena_;
         HttpRequest request_;
+        Exchange exchange_;
+        admission::Gate gate_;
+        rate_limit::Limiter* limiter_;
+        std::uint64_t client_;
 
         void Read();
+        void ReadRequest();
+        void OnReadStart(beast::error_code ec, std::size_t bytes_read);
         virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
         virtual void HandleRequest(HttpRequest&& request) = 0;
-        void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
+        virtual void HandleUpgrade(HttpRequest&& request) = 0;
+        void OnRead(beast::error_code ec, std::size_t bytes_read);
         void Close();
-        void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
+        void OnWrite(bool close, beast::error_code ec, std::size_t bytes_written);
+        // Отвечает заранее сформированным ответом (429 или 503). close - закрыть соединение после ответа
+        void Reject(std::string_view response, bool close);
+        void OnReject(bool close, beast::error_code ec, std::size_t bytes_written);
     };
 
-    template <typename RequestHandler>
-    class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>>
+    template <typename RequestHandler, typename UpgradeHandler = NoUpgrade>
+    class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler, UpgradeHandler>>
     {
     public:
-        template<typename Handler>
-        Session(tcp::socket&& socket, Handler&& request_handler)
-            : SessionBase(std::move(socket))
+        template<typename Handler, typename Upgrade>
+        Session(tcp::socket&& socket, Handler&& request_handler, Upgrade&& upgrade_handler, const Settings& settings)
+            : SessionBase(std::move(socket), settings)
             , request_handler_(std::forward<Handler>(request_handler))
+            , upgrade_handler_(std::forward<Upgrade>(upgrade_handler))
         {}
     private:
         RequestHandler request_handler_;
+        UpgradeHandler upgrade_handler_;
 
         std::shared_ptr<SessionBase> GetSharedThis() override
         {
@@ -91,16 +270,282 @@ namespace http_server
                 self->Write(std::move(response));
             });
         }
+
+        void HandleUpgrade(HttpRequest&& request) override
+        {
+            if constexpr (std::is_same_v<UpgradeHandler, NoUpgrade>)
+            {
+                metrics::CountRequestStarted();
+                HandleRequest(std::move(request));
+            }
+            else
+            {
+                upgrade_handler_(ReleaseStream(), ToUpgradeRequest(request));
+            }
+        }
     };
 
-    template <typename RequestHandler>
-    class Listener : public std::enable_shared_from_this<Listener<RequestHandler>>
+    // Ответ, ожидающий записи в соединение сопрограммы. Ответ вместе со своим сериализатором размещается
+    // во встроенном буфере, который переиспользуется между запросами; в кучу попадают только типы ответов,
+    // которые в буфер не помещаются
+    class PendingResponse
+    {
+    public:
+        PendingResponse() = default;
+
+        PendingResponse(const PendingResponse&) = delete;
+        PendingResponse& operator=(const PendingResponse&) = delete;
+
+        ~PendingResponse()
+        {
+            Reset();
+        }
+
+        template <typename Body, typename Fields>
+        void Emplace(http::response<Body, Fields>&& response)
+        {
+            using Entry = Serialized<Body, Fields>;
+            constexpr bool embedded = sizeof(Entry) <= STORAGE_SIZE && alignof(Entry) <= alignof(std::max_align_t);
+            Reset();
+            if constexpr (embedded)
+            {
+                entry_ = new (storage_) Entry{ std::move(response) };
+            }
+            else
+            {
+                entry_ = new Entry{ std::move(response) };
+            }
+            const auto& message = static_cast<Entry*>(entry_)->response;
+            status_ = message.result_int();
+            need_eof_ = message.need_eof();
+            write_ = [](void* entry, beast::tcp_stream& stream, beast::error_code& ec)
+            {
+                return http::async_write(stream, static_cast<Entry*>(entry)->serializer,
+                    net::redirect_error(net::use_awaitable, ec));
+            };
+            destroy_ = [](void* entry)
+            {
+                if constexpr (embedded)
+                {
+                    static_cast<Entry*>(entry)->~Entry();
+                }
+                else
+                {
+                    delete static_cast<Entry*>(entry);
+                }
+            };
+        }
+
+        unsigned Status() const noexcept
+        {
+            return status_;
+        }
+
+        bool NeedEof() const noexcept
+        {
+            return need_eof_;
+        }
+
+        net::awaitable<std::size_t> Write(beast::tcp_stream& stream, beast::error_code& ec)
+        {
+            return write_(entry_, stream, ec);
+        }
+
+        void Reset() noexcept
+        {
+            if (entry_)
+            {
+                destroy_(entry_);
+                entry_ = nullptr;
+            }
+        }
+
+    private:
+        static constexpr std::size_t STORAGE_SIZE = 1024;
+
+        template <typename Body, typename Fields>
+        struct Serialized
+        {
+            explicit Serialized(http::response<Body, Fields>&& message)
+                : response{ std::move(message) }
+            {}
+
+            http::response<Body, Fields> response;
+            http::serializer<false, Body, Fields> serializer{ response };
+        };
+
+        alignas(std::max_align_t) std::byte storage_[STORAGE_SIZE];
+        void* entry_ = nullptr;
+        unsigned status_ = 0;
+        bool need_eof_ = false;
+        net::awaitable<std::size_t> (*write_)(void* entry, beast::tcp_stream& stream, beast::error_code& ec) = nullptr;
+        void (*destroy_)(void* entry) = nullptr;
+    };
+
+    // Нешаблонная часть сессии-сопрограммы. Объект живёт в кадре сопрограммы соединения,
+    // поэтому буферы, парсер и место под ответ переиспользуются всеми запросами соединения
+    class CoroutineSessionBase
+    {
+    public:
+        CoroutineSessionBase(const CoroutineSessionBase&) = delete;
+        CoroutineSessionBase& operator=(const CoroutineSessionBase&) = delete;
+
+        // Передаёт сопрограмме ответ на текущий запрос
+        template <typename Body, typename Fields>
+        void Deliver(http::response<Body, Fields>&& response)
+        {
+            response_.Emplace(std::move(response));
+            // Ответ может быть сформирован в другом потоке (например, в api strand),
+            // а сопрограмма ждёт его в strand соединения
+            net::dispatch(stream_.get_executor(), [this]
+            {
+                has_response_ = true;
+                response_ready_.cancel();
+            });
+        }
+
+    protected:
+        CoroutineSessionBase(tcp::socket&& socket, const Settings& settings);
+        ~CoroutineSessionBase();
+
+        beast::tcp_stream stream_;
+        PhaseTimer timer_;
+        ReadBuffer buffer_;
+        request_arena::Arena* arena_;
+        std::optional<http::request_parser<HttpRequest::body_type, ArenaAllocator>> parser_;
+        PendingResponse response_;
+        // Будит сопрограмму, когда ответ сформирован после возврата из обработчика
+        net::steady_timer response_ready_;
+        bool has_response_ = false;
+        Exchange exchange_;
+        admission::Gate gate_;
+        rate_limit::Limiter* limiter_;
+        std::uint64_t client_;
+        beast::error_code ec_;
+
+        // Готовит чтение следующего запроса. Возвращает true, если его начало ещё не получено
+        bool StartRead();
+        // Возвращают false, если соединение больше не обслуживается
+        bool OnReadStart(std::size_t bytes_read);
+        bool OnRead(std::size_t bytes_read);
+        // Ответ 429, если клиент превысил ограничение частоты запросов, иначе пустая строка
+        std::string_view RateLimit();
+        // Запрос допущен к обработке. Иначе сопрограмма отвечает gate_.Rejection() и закрывает соединение
+        bool Admit();
+        // Заранее сформированный ответ для записи вместо ответа обработчика
+        net::const_buffer Rejection(std::string_view response);
+        // Возвращает false, если соединение больше не обслуживается
+        bool OnReject(bool close, std::size_t bytes_written);
+        void StartWrite();
+        bool OnWrite(std::size_t bytes_written);
+        void Close();
+        beast::tcp_stream ReleaseStream();
+    };
+
+    template <typename RequestHandler, typename UpgradeHandler = NoUpgrade>
+    class CoroutineSession : public CoroutineSessionBase
+    {
+    public:
+        // Обслуживает соединение до его закрытия. Всё состояние соединения находится в кадре этой сопрограммы,
+        // память под кадры Asio берёт из кеша потока, поэтому запросы соединения обходятся почти без выделений памяти
+        static net::awaitable<void> Serve(tcp::socket socket, RequestHandler request_handler, UpgradeHandler upgrade_handler,
+            Settings settings)
+        {
+            CoroutineSession session{ std::move(socket), settings };
+            auto token = net::redirect_error(net::use_awaitable, session.ec_);
+            for (;;)
+            {
+                if (session.StartRead())
+                {
+                    const std::size_t bytes_read = co_await session.stream_.async_read_some(
+                        session.buffer_.prepare(beast::read_size(session.buffer_, 65536)), token);
+                    if (!session.OnReadStart(bytes_read))
+                    {
+                        co_return;
+                    }
+                }
+                const std::size_t bytes_read = co_await http::async_read(session.stream_, session.buffer_,
+                    *session.parser_, token);
+                if (!session.OnRead(bytes_read))
+                {
+                    co_return;
+                }
+                if constexpr (!std::is_same_v<UpgradeHandler, NoUpgrade>)
+                {
+                    if (beast::websocket::is_upgrade(session.parser_->get()))
+                    {
+                        upgrade_handler(session.ReleaseStream(), ToUpgradeRequest(session.parser_->get()));
+                        co_return;
+                    }
+                }
+                if (const std::string_view limited = session.RateLimit(); !limited.empty())
+                {
+                    const std::size_t bytes_written = co_await net::async_write(session.stream_,
+                        session.Rejection(limited), token);
+                    if (!session.OnReject(false, bytes_written))
+                    {
+                        co_return;
+                    }
+                    continue;
+                }
+                if (!session.Admit())
+                {
+                    const std::size_t bytes_written = co_await net::async_write(session.stream_,
+                        session.Rejection(session.gate_.Rejection()), token);
+                    session.OnReject(true, bytes_written);
+                    co_return;
+                }
+                session.exchange_.RequestStarted(session.parser_->get());
+                {
+                    // Обработчик узнаёт о трассировке запроса через tracing::CurrentRequest
+                    const tracing::RequestScope trace_scope{ session.exchange_.Trace() };
+                    const request_arena::Scope arena_scope{ session.arena_ };
+                    request_handler(session.parser_->release(), [&session](auto&& response)
+                    {
+                        session.Deliver(std::move(response));
+                    });
+                }
+                if (!session.has_response_)
+                {
+                    co_await session.response_ready_.async_wait(token);
+                }
+                session.StartWrite();
+                const std::size_t bytes_written = co_await session.response_.Write(session.stream_, session.ec_);
+                if (!session.OnWrite(bytes_written))
+                {
+                    co_return;
+                }
+            }
+        }
+
+    private:
+        CoroutineSession(tcp::socket&& socket, const Settings& settings)
+            : CoroutineSessionBase(std::move(socket), settings)
+        {}
+    };
+
+    // Создаёт сессию в пуле потока
+    template <typename RequestHandler, typename UpgradeHandler>
+    std::shared_ptr<Session<RequestHandler, UpgradeHandler>> MakeSession(tcp::socket&& socket,
+        const RequestHandler& request_handler, const UpgradeHandler& upgrade_handler, const Settings& settings)
+    {
+        using MySession = Session<RequestHandler, UpgradeHandler>;
+        return std::allocate_shared<MySession>(memory_pool::Allocator<MySession, metrics::Pool::SESSION>{},
+            std::move(socket), request_handler, upgrade_handler, settings);
+    }
+
+    template <typename RequestHandler, typename UpgradeHandler = NoUpgrade>
+    class Listener : public std::enable_shared_from_this<Listener<RequestHandler, UpgradeHandler>>
     {
     public:
-        Listener(net::io_context& io, const tcp::endpoint& endpoint, RequestHandler&& request_handler)
+        template <typename Handler, typename Upgrade>
+        Listener(net::io_context& io, const tcp::endpoint& endpoint, Handler&& request_handler, Upgrade&& upgrade_handler,
+            const Settings& settings)
             : ioc_(io)
             , acceptor_(net::make_strand(io))
-            , request_handler_(std::forward<RequestHandler>(request_handler))
+            , request_handler_(std::forward<Handler>(request_handler))
+            , upgrade_handler_(std::forward<Upgrade>(upgrade_handler))
+            , settings_(settings)
         {
             acceptor_.open(endpoint.protocol());
             acceptor_.set_option(net::socket_base::reuse_address(true));
@@ -117,9 +562,22 @@ namespace http_server
         net::io_context& ioc_;
         tcp::acceptor acceptor_;
         RequestHandler request_handler_;
+        UpgradeHandler upgrade_handler_;
+        Settings settings_;
 
         void DoAccept()
         {
+            // Сверх предела соединения ждут в очереди ядра, пока одно из открытых соединений не закроется
+            if (settings_.admission && !settings_.admission->AcceptOrPause([self = this->shared_from_this()]
+                {
+                    net::dispatch(self->acceptor_.get_executor(), [self]
+                    {
+                        self->DoAccept();
+                    });
+                }))
+            {
+                return;
+            }
             acceptor_.async_accept(
                 net::make_strand(ioc_),
                 beast::bind_front_handler(&Listener::OnAccept, this->shared_from_this())
@@ -130,6 +588,7 @@ namespace http_server
         {
             if (ec)
             {
+                metrics::CountAcceptError();
                 return ReportError(ec, "accept"sv);
             }
             AsyncRunSession(std::move(socket));
@@ -139,14 +598,33 @@ namespace http_server
 
         void AsyncRunSession(tcp::socket&& socket)
         {
-            std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
+            if (settings_.model == SessionModel::COROUTINE)
+            {
+                const auto executor = socket.get_executor();
+                net::co_spawn(executor, CoroutineSession<RequestHandler, UpgradeHandler>::Serve(std::move(socket),
+                    request_handler_, upgrade_handler_, settings_), net::detached);
+                return;
+            }
+            MakeSession(std::move(socket), request_handler_, upgrade_handler_, settings_)->Run();
         }
     };
 
     template <typename RequestHandler>
-    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler)
+    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler,
+        const Settings& settings = {})
     {
         using MyListener = Listener<std::decay_t<RequestHandler>>;
-        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler), NoUpgrade{}, settings)->Run();
+    }
+
+    // upgrade_handler(beast::tcp_stream&& stream, request&& req) получает соединение,
+    // приславшее запрос WebSocket Upgrade
+    template <typename RequestHandler, typename UpgradeHandler>
+    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler,
+        UpgradeHandler&& upgrade_handler, const Settings& settings = {})
+    {
+        using MyListener = Listener<std::decay_t<RequestHandler>, std::decay_t<UpgradeHandler>>;
+        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler),
+            std::forward<UpgradeHandler>(upgrade_handler), settings)->Run();
     }
 }  // namespace http_server
@@ -0,0 +1,40 @@
+#include "interest_grid.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace model
+{
+    void InterestGrid::Rebuild(const std::vector<double>& xs, const std::vector<double>& ys, double cell_size)
+    {
+        const size_t n = xs.size();
+        cell_size_ = cell_size;
+        // Корзин примерно вдвое больше, чем объектов, чтобы коллизии хеша были редкими
+        const size_t buckets = std::bit_ceil(std::max<size_t>(n * 2, 16));
+        bucket_mask_ = buckets - 1;
+
+        bucket_start_.assign(buckets + 1, 0);
+        point_buckets_.resize(n);
+        point_cells_.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            point_cells_[i] = GetCell(xs[i], ys[i]);
+            point_buckets_[i] = CellHasher{}(point_cells_[i]) & bucket_mask_;
+            ++bucket_start_[point_buckets_[i] + 1];
+        }
+        for (size_t b = 0; b < buckets; ++b)
+        {
+            bucket_start_[b + 1] += bucket_start_[b];
+        }
+
+        entries_.resize(n);
+        entry_cells_.resize(n);
+        fill_.assign(bucket_start_.begin(), bucket_start_.end() - 1);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const std::uint32_t pos = fill_[point_buckets_[i]]++;
+            entries_[pos] = static_cast<std::uint32_t>(i);
+            entry_cells_[pos] = point_cells_[i];
+        }
+    }
+}  // namespace model
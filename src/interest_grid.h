@@ -0,0 +1,79 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "dog_movement.h"
+
+namespace model
+{
+    // Равномерная пространственная хеш-сетка по позициям объектов игрового сеанса (собак или трофеев).
+    // Перестраивается целиком за O(n) сортировкой подсчётом: собаки одной корзины
+    // лежат в entries_ подряд, что делает обход ячейки последовательным чтением памяти
+    class InterestGrid
+    {
+    public:
+        struct Cell
+        {
+            std::int64_t x, y;
+
+            bool operator==(const Cell&) const = default;
+        };
+
+        struct CellHasher
+        {
+            size_t operator()(const Cell& cell) const noexcept
+            {
+                return static_cast<size_t>(cell.x * 0x9E3779B97F4A7C15ull ^ cell.y * 0xC2B2AE3D27D4EB4Full);
+            }
+        };
+
+        void Rebuild(const movement::DogsState& state, double cell_size)
+        {
+            Rebuild(state.x, state.y, cell_size);
+        }
+
+        // Перестраивает сетку по точкам (xs[i], ys[i]). Массивы должны быть одной длины
+        void Rebuild(const std::vector<double>& xs, const std::vector<double>& ys, double cell_size);
+
+        double GetCellSize() const noexcept
+        {
+            return cell_size_;
+        }
+
+        Cell GetCell(double x, double y) const noexcept
+        {
+            return { static_cast<std::int64_t>(std::floor(x / cell_size_)),
+                static_cast<std::int64_t>(std::floor(y / cell_size_)) };
+        }
+
+        // Вызывает fn(index) для каждого объекта в ячейке cell
+        template <typename Fn>
+        void ForEachInCell(Cell cell, Fn&& fn) const
+        {
+            if (bucket_start_.empty())
+            {
+                return;
+            }
+            const size_t bucket = CellHasher{}(cell) & bucket_mask_;
+            for (std::uint32_t i = bucket_start_[bucket]; i < bucket_start_[bucket + 1]; ++i)
+            {
+                if (entry_cells_[i] == cell)
+                {
+                    fn(static_cast<size_t>(entries_[i]));
+                }
+            }
+        }
+
+    private:
+        double cell_size_ = 1.0;
+        size_t bucket_mask_ = 0;
+        std::vector<std::uint32_t> bucket_start_;
+        std::vector<std::uint32_t> entries_;
+        std::vector<Cell> entry_cells_;
+        // Рабочие массивы перестроения, сохраняются между тиками, чтобы не выделять память заново
+        std::vector<Cell> point_cells_;
+        std::vector<size_t> point_buckets_;
+        std::vector<std::uint32_t> fill_;
+    };
+}  // namespace model
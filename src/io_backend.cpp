@@ -0,0 +1,154 @@
+#include "io_backend.h"
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace io_backend
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        // Устанавливается при переходе на epoll из-за недоступного io_uring, чтобы сборки не запускали друг друга по кругу
+        constexpr const char* FALLBACK_ENV = "GAME_SERVER_IO_URING_UNAVAILABLE";
+
+        std::string_view BinaryName(Backend backend) noexcept
+        {
+            return backend == Backend::IO_URING ? "game_server_uring"sv : "game_server"sv;
+        }
+
+        std::filesystem::path BinaryPath(Backend backend)
+        {
+            return std::filesystem::read_symlink("/proc/self/exe").parent_path() / BinaryName(backend);
+        }
+
+        // Проверяет, что рядом есть сборка с механизмом backend. При отказе записывает причину в reason
+        bool IsBuilt(Backend backend, std::string& reason)
+        {
+            if (backend == Compiled())
+            {
+                return true;
+            }
+            const std::filesystem::path binary = BinaryPath(backend);
+            if (::access(binary.c_str(), X_OK) != 0)
+            {
+                reason = binary.string() + ": "s + std::strerror(errno);
+                return false;
+            }
+            return true;
+        }
+
+        [[noreturn]] void Exec(Backend backend, const char* const argv[])
+        {
+            const std::filesystem::path binary = BinaryPath(backend);
+            ::execv(binary.c_str(), const_cast<char* const*>(argv));
+            throw std::runtime_error("Failed to start "s + binary.string() + ": "s + std::strerror(errno));
+        }
+
+        // Закрывает дескриптор кольца при выходе из области видимости
+        struct RingFd
+        {
+            int fd;
+
+            ~RingFd()
+            {
+                ::close(fd);
+            }
+        };
+    }  // namespace
+
+    Backend Compiled() noexcept
+    {
+#ifdef GAME_SERVER_IO_URING
+        return Backend::IO_URING;
+#else
+        return Backend::EPOLL;
+#endif
+    }
+
+    std::string_view Name(Backend backend) noexcept
+    {
+        return backend == Backend::IO_URING ? "io_uring"sv : "epoll"sv;
+    }
+
+    bool IsIoUringSupported(std::string& reason)
+    {
+        io_uring_params params{};
+        const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, 4, &params));
+        if (fd < 0)
+        {
+            // ENOSYS - ядро старше 5.1, EPERM - io_uring запрещён (sysctl kernel.io_uring_disabled, seccomp)
+            reason = "io_uring_setup: "s + std::strerror(errno);
+            return false;
+        }
+        const RingFd ring{ fd };
+
+        constexpr unsigned OPS_CAPACITY = 256;
+        std::vector<unsigned char> storage(sizeof(io_uring_probe) + OPS_CAPACITY * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, OPS_CAPACITY) < 0)
+        {
+            // Проба операций появилась в 5.6; более старые ядра не поддерживают всех нужных операций
+            reason = "IORING_REGISTER_PROBE: "s + std::strerror(errno);
+            return false;
+        }
+        const auto supports = [probe](unsigned op)
+        {
+            return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+        };
+        for (const auto& [op, name] : { std::pair{ IORING_OP_POLL_ADD, "POLL_ADD" }, std::pair{ IORING_OP_ACCEPT, "ACCEPT" },
+            std::pair{ IORING_OP_RECVMSG, "RECVMSG" }, std::pair{ IORING_OP_SENDMSG, "SENDMSG" },
+            std::pair{ IORING_OP_TIMEOUT, "TIMEOUT" }, std::pair{ IORING_OP_ASYNC_CANCEL, "ASYNC_CANCEL" } })
+        {
+            if (!supports(op))
+            {
+                reason = "operation IORING_OP_"s + name + " is not supported"s;
+                return false;
+            }
+        }
+        if ((params.features & IORING_FEAT_FAST_POLL) == 0)
+        {
+            // Без FAST_POLL каждая операция с сокетом выполняется рабочим потоком ядра, что медленнее epoll
+            reason = "IORING_FEAT_FAST_POLL is not supported"s;
+            return false;
+        }
+        return true;
+    }
+
+    void Select(Backend requested, bool strict, const char* const argv[])
+    {
+        const bool after_fallback = std::getenv(FALLBACK_ENV) != nullptr;
+        if (requested == Backend::IO_URING && !after_fallback)
+        {
+            std::string reason;
+            if (!IsIoUringSupported(reason) || !IsBuilt(Backend::IO_URING, reason))
+            {
+                if (strict)
+                {
+                    throw std::runtime_error("io_uring is unavailable: "s + reason);
+                }
+                std::cerr << "io_uring is unavailable ("sv << reason << "), falling back to epoll"sv << std::endl;
+                ::setenv(FALLBACK_ENV, reason.c_str(), 1);
+                requested = Backend::EPOLL;
+            }
+        }
+        else if (requested == Backend::IO_URING)
+        {
+            requested = Backend::EPOLL;
+        }
+        if (requested != Compiled())
+        {
+            Exec(requested, argv);
+        }
+    }
+}  // namespace io_backend
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace io_backend
+{
+    // Механизм асинхронного ввода-вывода задаётся при сборке: game_server использует epoll,
+    // game_server_uring (опция CMake GAME_SERVER_IO_URING) выполняет все операции с сокетами
+    // и таймерами через io_uring. Выбор во время запуска сводится к замене процесса нужной сборкой
+    enum class Backend
+    {
+        EPOLL, IO_URING
+    };
+
+    // Механизм текущей сборки
+    Backend Compiled() noexcept;
+
+    std::string_view Name(Backend backend) noexcept;
+
+    // Проверяет, что ядро разрешает io_uring и поддерживает операции, которые использует Asio.
+    // При отказе записывает причину в reason
+    bool IsIoUringSupported(std::string& reason);
+
+    // Если запрошен механизм, отличный от механизма сборки, или io_uring недоступен, заменяет процесс
+    // сборкой с нужным механизмом из того же каталога, передавая ей те же аргументы.
+    // io_uring недоступен, если его не поддерживает ядро или рядом нет game_server_uring: тогда выбирается
+    // epoll, а при strict выбрасывается исключение. Возвращает управление, если текущая сборка подходит.
+    // При невозможности замены выбрасывает исключение
+    void Select(Backend requested, bool strict, const char* const argv[]);
+}  // namespace io_backend
@@ -0,0 +1,372 @@
+#include "journal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+#include "binary_io.h"
+#include "logger.h"
+#include "state_serialization.h"
+
+namespace serialization
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        enum class EntryType : std::uint8_t
+        {
+            JOIN = 1,
+            MOVE = 2,
+            TICK = 3
+        };
+
+        // Код направления в записи MOVE, означающий остановку собаки
+        constexpr std::uint8_t STOP = 0xFF;
+        // Заголовок записи: длина тела и контрольная сумма тела
+        constexpr size_t HEADER_SIZE = 2 * sizeof(std::uint32_t);
+
+        std::filesystem::path SegmentPath(const std::filesystem::path& prefix, std::uint64_t first_sequence)
+        {
+            // Номер дополняется нулями, чтобы сегменты сортировались и по имени
+            char number[21];
+            std::snprintf(number, sizeof(number), "%020llu", static_cast<unsigned long long>(first_sequence));
+            std::filesystem::path path = prefix;
+            path += ".journal."s + number;
+            return path;
+        }
+
+        // Сегменты журнала с префиксом prefix, упорядоченные по номеру первой записи
+        std::vector<std::pair<std::uint64_t, std::filesystem::path>> ListSegments(const std::filesystem::path& prefix)
+        {
+            const std::filesystem::path dir = prefix.has_parent_path() ? prefix.parent_path() : std::filesystem::path{ "." };
+            const std::string name_prefix = prefix.filename().string() + ".journal.";
+            std::vector<std::pair<std::uint64_t, std::filesystem::path>> segments;
+            if (!std::filesystem::exists(dir))
+            {
+                return segments;
+            }
+            for (const auto& entry : std::filesystem::directory_iterator{ dir })
+            {
+                const std::string name = entry.path().filename().string();
+                if (!entry.is_regular_file() || !name.starts_with(name_prefix))
+                {
+                    continue;
+                }
+                const std::string_view number = std::string_view{ name }.substr(name_prefix.size());
+                std::uint64_t first_sequence = 0;
+                auto [ptr, ec] = std::from_chars(number.data(), number.data() + number.size(), first_sequence);
+                if (ec == std::errc{} && ptr == number.data() + number.size())
+                {
+                    segments.emplace_back(first_sequence, entry.path());
+                }
+            }
+            std::sort(segments.begin(), segments.end());
+            return segments;
+        }
+
+        std::uint32_t RecordChecksum(std::string_view body) noexcept
+        {
+            return static_cast<std::uint32_t>(Fnv1a(body));
+        }
+    }  // namespace
+
+    Journal::Journal(std::filesystem::path prefix, std::uint64_t last_sequence, const Settings& settings)
+        : prefix_{ std::move(prefix) }
+        , settings_{ settings }
+        , last_sequence_{ last_sequence }
+    {
+        OpenSegment(last_sequence_ + 1);
+        writer_ = std::thread{ [this]
+        {
+            Run();
+        } };
+    }
+
+    Journal::~Journal()
+    {
+        {
+            std::lock_guard lock{ mutex_ };
+            stop_ = true;
+        }
+        cv_.notify_all();
+        writer_.join();
+    }
+
+    void Journal::OnJoin(const app::Token& token, std::string_view user_name, const model::Map::Id& map_id)
+    {
+        record_.assign(HEADER_SIZE, '\0');
+        BinaryWriter writer{ record_ };
+        writer.Pod(++last_sequence_);
+        writer.Pod(EntryType::JOIN);
+        writer.String(*token);
+        writer.String(*map_id);
+        writer.String(user_name);
+        Append();
+    }
+
+    void Journal::OnMove(const app::Token& token, std::optional<model::Direction> direction)
+    {
+        record_.assign(HEADER_SIZE, '\0');
+        BinaryWriter writer{ record_ };
+        writer.Pod(++last_sequence_);
+        writer.Pod(EntryType::MOVE);
+        writer.String(*token);
+        writer.Pod(direction ? static_cast<std::uint8_t>(*direction) : STOP);
+        Append();
+    }
+
+    void Journal::OnTick(std::chrono::milliseconds delta)
+    {
+        record_.assign(HEADER_SIZE, '\0');
+        BinaryWriter writer{ record_ };
+        writer.Pod(++last_sequence_);
+        writer.Pod(EntryType::TICK);
+        writer.Pod(static_cast<std::int64_t>(delta.count()));
+        Append();
+    }
+
+    void Journal::Append()
+    {
+        const std::string_view body = std::string_view{ record_ }.substr(HEADER_SIZE);
+        const auto size = static_cast<std::uint32_t>(body.size());
+        const std::uint32_t checksum = RecordChecksum(body);
+        std::memcpy(record_.data(), &size, sizeof(size));
+        std::memcpy(record_.data() + sizeof(size), &checksum, sizeof(checksum));
+
+        {
+            std::lock_guard lock{ mutex_ };
+            buffer_.append(record_);
+        }
+        entries_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Journal::Rotate()
+    {
+        std::lock_guard lock{ mutex_ };
+        rotations_.push_back({ buffer_.size(), last_sequence_ + 1 });
+        return last_sequence_;
+    }
+
+    void Journal::RemoveSegmentsUpTo(std::uint64_t sequence)
+    {
+        {
+            std::lock_guard lock{ mutex_ };
+            remove_up_to_ = std::max(remove_up_to_, sequence);
+        }
+        cv_.notify_one();
+    }
+
+    Journal::Stats Journal::GetStats() const noexcept
+    {
+        return { entries_.load(std::memory_order_relaxed), commits_.load(std::memory_order_relaxed),
+            bytes_.load(std::memory_order_relaxed) };
+    }
+
+    void Journal::Run()
+    {
+        std::string data;
+        std::vector<Rotation> rotations;
+        std::unique_lock lock{ mutex_ };
+        while (true)
+        {
+            cv_.wait_for(lock, settings_.commit_interval, [this]
+            {
+                return stop_ || remove_up_to_ != 0;
+            });
+            const bool stop = stop_;
+            data.swap(buffer_);
+            rotations.swap(rotations_);
+            const std::uint64_t remove_up_to = std::exchange(remove_up_to_, 0);
+            lock.unlock();
+
+            try
+            {
+                size_t pos = 0;
+                for (const Rotation& rotation : rotations)
+                {
+                    Commit(std::string_view{ data }.substr(pos, rotation.offset - pos));
+                    CloseSegment();
+                    OpenSegment(rotation.first_sequence);
+                    pos = rotation.offset;
+                }
+                Commit(std::string_view{ data }.substr(pos));
+                if (remove_up_to != 0)
+                {
+                    RemoveSegments(remove_up_to);
+                }
+            }
+            catch (const std::exception& ex)
+            {
+                logger::Message(logger::Level::ERROR, "Failed to write action journal: "s + ex.what());
+            }
+            data.clear();
+            rotations.clear();
+
+            lock.lock();
+            if (stop && buffer_.empty() && rotations_.empty())
+            {
+                break;
+            }
+        }
+        CloseSegment();
+    }
+
+    void Journal::OpenSegment(std::uint64_t first_sequence)
+    {
+        segment_path_ = SegmentPath(prefix_, first_sequence);
+        fd_ = ::open(segment_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Failed to create " + segment_path_.string());
+        }
+        SyncParentDirectory(segment_path_);
+    }
+
+    void Journal::CloseSegment()
+    {
+        if (fd_ >= 0)
+        {
+            ::fdatasync(fd_);
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    void Journal::Commit(std::string_view data)
+    {
+        if (data.empty() || fd_ < 0)
+        {
+            return;
+        }
+        // Одна запись и одна синхронизация на все записи, накопленные за интервал
+        WriteAll(fd_, data, segment_path_);
+        if (settings_.sync == SyncPolicy::BATCH && ::fdatasync(fd_) != 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Failed to sync " + segment_path_.string());
+        }
+        commits_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(data.size(), std::memory_order_relaxed);
+    }
+
+    void Journal::RemoveSegments(std::uint64_t sequence)
+    {
+        // Сегмент, начатый не позже sequence, закрыт поворотом при снятии снимка с этим номером
+        // и не содержит более поздних записей
+        for (const auto& [first_sequence, path] : ListSegments(prefix_))
+        {
+            if (first_sequence <= sequence && path != segment_path_)
+            {
+                std::filesystem::remove(path);
+            }
+        }
+    }
+
+    std::uint64_t ReplayJournal(const std::filesystem::path& prefix, std::uint64_t after_sequence,
+        app::Application& application)
+    {
+        std::uint64_t last_sequence = after_sequence;
+        const auto segments = ListSegments(prefix);
+        for (size_t index = 0; index < segments.size(); ++index)
+        {
+            const std::filesystem::path& path = segments[index].second;
+            std::ifstream in(path, std::ios::binary);
+            if (!in)
+            {
+                throw std::runtime_error("Failed to open " + path.string());
+            }
+            const std::string data{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+            BinaryReader reader{ data };
+            // Недописанный хвост допустим только в последнем сегменте: его обрезают до последней
+            // целой записи, чтобы после перезапуска и новых записей журнал снова читался целиком.
+            // Повреждение в более раннем сегменте означает потерю записей, а не сбой при записи
+            auto torn_tail = [&](size_t offset, std::string_view problem)
+            {
+                if (index + 1 != segments.size())
+                {
+                    throw std::runtime_error("Action journal "s + path.string() + " has a "s
+                        + std::string{ problem } + " record before its last segment"s);
+                }
+                logger::Message(logger::Level::ERROR, "Action journal "s + path.string() + " has a "s
+                    + std::string{ problem } + " record, truncated to "s + std::to_string(offset) + " bytes"s);
+                std::filesystem::resize_file(path, offset);
+                return last_sequence;
+            };
+            while (!reader.AtEnd())
+            {
+                const size_t offset = data.size() - reader.Remaining();
+                if (reader.Remaining() < HEADER_SIZE)
+                {
+                    return torn_tail(offset, "truncated"sv);
+                }
+                const auto size = reader.Pod<std::uint32_t>();
+                const auto checksum = reader.Pod<std::uint32_t>();
+                if (reader.Remaining() < size)
+                {
+                    return torn_tail(offset, "truncated"sv);
+                }
+                const std::string_view body = reader.Take(size);
+                if (RecordChecksum(body) != checksum)
+                {
+                    return torn_tail(offset, "corrupted"sv);
+                }
+
+                BinaryReader entry{ body };
+                const auto sequence = entry.Pod<std::uint64_t>();
+                if (sequence <= last_sequence)
+                {
+                    continue;
+                }
+                if (sequence != last_sequence + 1)
+                {
+                    throw std::runtime_error("Action journal has no records between "s
+                        + std::to_string(last_sequence) + " and "s + std::to_string(sequence));
+                }
+
+                switch (entry.Pod<EntryType>())
+                {
+                case EntryType::JOIN:
+                {
+                    app::Token token{ entry.String() };
+                    const model::Map::Id map_id{ entry.String() };
+                    if (!application.JoinGame(entry.String(), map_id, std::move(token)))
+                    {
+                        throw std::runtime_error("Action journal refers to unknown map " + *map_id);
+                    }
+                    break;
+                }
+                case EntryType::MOVE:
+                {
+                    const app::Token token{ entry.String() };
+                    const auto direction = entry.Pod<std::uint8_t>();
+                    const app::Player* player = application.FindPlayer(token);
+                    if (!player || (direction != STOP && direction > static_cast<std::uint8_t>(model::Direction::EAST)))
+                    {
+                        throw std::runtime_error("Action journal has an invalid move record");
+                    }
+                    application.MovePlayer(*player, direction == STOP
+                        ? std::nullopt
+                        : std::optional{ static_cast<model::Direction>(direction) });
+                    break;
+                }
+                case EntryType::TICK:
+                    application.Tick(std::chrono::milliseconds{ entry.Pod<std::int64_t>() });
+                    break;
+                default:
+                    throw std::runtime_error("Action journal has a record of unknown type");
+                }
+                last_sequence = sequence;
+            }
+        }
+        return last_sequence;
+    }
+}  // namespace serialization
@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "application.h"
+
+namespace serialization
+{
+    // Журнал упреждающей записи принятых действий: входов игроков, команд и тиков.
+    // Записи кодируются в api strand и дописываются в общий буфер под мьютексом. Отдельный поток
+    // раз в commit_interval забирает накопленный буфер и записывает его одним вызовом write,
+    // после чего, в зависимости от политики, вызывает fdatasync (групповая фиксация).
+    // Журнал состоит из сегментов <prefix>.journal.<номер первой записи>. При сохранении снимка
+    // начинается новый сегмент, а сегменты, целиком учтённые в снимке, удаляются
+    class Journal : public app::ActionJournal
+    {
+    public:
+        enum class SyncPolicy
+        {
+            // Запись остаётся в кеше ОС: переживает падение процесса, но не сбой питания
+            NONE,
+            // fdatasync после каждой групповой записи
+            BATCH
+        };
+
+        struct Settings
+        {
+            std::chrono::milliseconds commit_interval{ 10 };
+            SyncPolicy sync = SyncPolicy::BATCH;
+        };
+
+        struct Stats
+        {
+            std::uint64_t entries = 0;
+            std::uint64_t commits = 0;
+            std::uint64_t bytes = 0;
+        };
+
+        // last_sequence - номер последней записи, уже применённой к состоянию игры
+        Journal(std::filesystem::path prefix, std::uint64_t last_sequence, const Settings& settings);
+
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        // Записывает на диск всё накопленное
+        ~Journal();
+
+        void OnJoin(const app::Token& token, std::string_view user_name, const model::Map::Id& map_id) override;
+
+        void OnMove(const app::Token& token, std::optional<model::Direction> direction) override;
+
+        void OnTick(std::chrono::milliseconds delta) override;
+
+        // Следующие записи попадут в новый сегмент. Возвращает номер последней записи
+        // предыдущих сегментов. Вызывается в api strand вместе со снятием снимка
+        std::uint64_t Rotate();
+
+        // Удаляет сегменты, все записи которых имеют номера не больше sequence.
+        // Вызывается после того, как снимок с этим номером надёжно сохранён
+        void RemoveSegmentsUpTo(std::uint64_t sequence);
+
+        Stats GetStats() const noexcept;
+
+    private:
+        struct Rotation
+        {
+            size_t offset;
+            std::uint64_t first_sequence;
+        };
+
+        std::filesystem::path prefix_;
+        Settings settings_;
+        // Изменяется только в api strand
+        std::uint64_t last_sequence_;
+        // Буфер кодирования очередной записи, переиспользуется между записями
+        std::string record_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::string buffer_;
+        std::vector<Rotation> rotations_;
+        std::uint64_t remove_up_to_ = 0;
+        bool stop_ = false;
+
+        // Принадлежат потоку записи
+        int fd_ = -1;
+        std::filesystem::path segment_path_;
+
+        std::atomic<std::uint64_t> entries_{ 0 };
+        std::atomic<std::uint64_t> commits_{ 0 };
+        std::atomic<std::uint64_t> bytes_{ 0 };
+
+        std::thread writer_;
+
+        // Дописывает закодированную в record_ запись в буфер потока записи
+        void Append();
+
+        void Run();
+
+        void OpenSegment(std::uint64_t first_sequence);
+
+        void CloseSegment();
+
+        void Commit(std::string_view data);
+
+        void RemoveSegments(std::uint64_t sequence);
+    };
+
+    // Применяет к application записи журнала с номерами больше after_sequence и возвращает
+    // номер последней применённой записи. Повреждённый хвост последнего сегмента (запись,
+    // не дописанная при сбое) отрезается; повреждение в более раннем сегменте — ошибка
+    std::uint64_t ReplayJournal(const std::filesystem::path& prefix, std::uint64_t after_sequence,
+        app::Application& application);
+}  // namespace serialization
@@ -0,0 +1,131 @@
+// Бенчмарк журнала действий: пропускная способность и задержка добавления записей.
+// Перед замером проверяет восстановление: сбой с недописанной записью, перезапуск,
+// новые записи и ещё один перезапуск должны воспроизвести журнал целиком.
+// Запуск: journal_bench [каталог] [количество-записей] [интервал-фиксации-мс]
+#include "journal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+namespace
+{
+    void RemoveSegments(const std::filesystem::path& dir, std::string_view name)
+    {
+        const std::string segment_prefix = std::string{ name } + ".journal.";
+        for (const auto& entry : std::filesystem::directory_iterator{ dir })
+        {
+            if (entry.path().filename().string().starts_with(segment_prefix))
+            {
+                std::filesystem::remove(entry.path());
+            }
+        }
+    }
+
+    // Число записей журнала prefix, которые воспроизводятся после перезапуска
+    std::uint64_t Replay(const std::filesystem::path& prefix)
+    {
+        model::Game game;
+        app::Application application{ game };
+        return serialization::ReplayJournal(prefix, 0, application);
+    }
+
+    void WriteTicks(const std::filesystem::path& prefix, std::uint64_t last_sequence, size_t count)
+    {
+        serialization::Journal journal{ prefix, last_sequence, { 1ms, serialization::Journal::SyncPolicy::NONE } };
+        for (size_t i = 0; i < count; ++i)
+        {
+            journal.OnTick(10ms);
+        }
+    }
+
+    bool CheckRecovery(const std::filesystem::path& dir)
+    {
+        constexpr size_t ticks = 100;
+        const std::filesystem::path prefix = dir / "journal_bench_recovery";
+        WriteTicks(prefix, 0, ticks);
+        // Сбой посреди записи: в сегменте остаётся только начало заголовка следующей записи
+        for (const auto& entry : std::filesystem::directory_iterator{ dir })
+        {
+            if (entry.path().filename().string().starts_with("journal_bench_recovery.journal."))
+            {
+                std::ofstream{ entry.path(), std::ios::binary | std::ios::app } << "\x10\x00\x00"sv;
+            }
+        }
+        const std::uint64_t first_replay = Replay(prefix);
+        WriteTicks(prefix, first_replay, ticks);
+        const std::uint64_t second_replay = Replay(prefix);
+        RemoveSegments(dir, "journal_bench_recovery"sv);
+        if (first_replay != ticks || second_replay != 2 * ticks)
+        {
+            std::cerr << "Recovery check failed: replayed "sv << first_replay << " and "sv << second_replay
+                << " records instead of "sv << ticks << " and "sv << 2 * ticks << std::endl;
+            return false;
+        }
+        return true;
+    }
+}  // namespace
+
+int main(int argc, const char* argv[])
+{
+    const std::filesystem::path dir = argc > 1 ? argv[1] : std::filesystem::temp_directory_path();
+    const size_t entries = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1'000'000;
+    const auto interval = std::chrono::milliseconds(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10);
+
+    if (!CheckRecovery(dir))
+    {
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path prefix = dir / "journal_bench";
+    const app::Token token{ "0123456789abcdef0123456789abcdef"s };
+    std::vector<double> latencies_ns;
+    latencies_ns.reserve(entries);
+
+    serialization::Journal::Stats stats;
+    std::chrono::duration<double> elapsed{};
+    {
+        serialization::Journal journal{ prefix, 0, { interval, serialization::Journal::SyncPolicy::BATCH } };
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < entries; ++i)
+        {
+            const auto before = std::chrono::steady_clock::now();
+            journal.OnMove(token, static_cast<model::Direction>(i % 4));
+            const std::chrono::duration<double, std::nano> latency = std::chrono::steady_clock::now() - before;
+            latencies_ns.push_back(latency.count());
+        }
+        // Ждём, пока поток записи зафиксирует хвост: объём записанного перестаёт расти
+        for (auto previous = journal.GetStats();; previous = stats)
+        {
+            std::this_thread::sleep_for(2 * interval);
+            stats = journal.GetStats();
+            if (stats.bytes == previous.bytes && stats.bytes != 0)
+            {
+                break;
+            }
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    RemoveSegments(dir, "journal_bench"sv);
+
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    auto percentile = [&](double p)
+    {
+        return latencies_ns.empty() ? 0.0 : latencies_ns[static_cast<size_t>(p * (latencies_ns.size() - 1))];
+    };
+    std::cout << "entries="sv << entries
+        << " committed_per_sec="sv << static_cast<double>(entries) / elapsed.count()
+        << " commits="sv << stats.commits
+        << " bytes="sv << stats.bytes
+        << " append_p50_ns="sv << percentile(0.5)
+        << " append_p99_ns="sv << percentile(0.99)
+        << " append_p999_ns="sv << percentile(0.999)
+        << " append_max_ns="sv << percentile(1.0) << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -67,7 +67,21 @@ namespace json_loader
         }
     }
 
-    model::Map CreateMap(const boost::json::value& value)
+    void AddLootTypes(model::Map& map, const boost::json::array& loot_types)
+    {
+        for (const auto& loot_type : loot_types)
+        {
+            model::LootType type;
+            type.description = boost::json::serialize(loot_type);
+            if (const auto* value = loot_type.as_object().if_contains("value"))
+            {
+                type.value = static_cast<int>(value->as_int64());
+            }
+            map.AddLootType(std::move(type));
+        }
+    }
+
+    model::Map CreateMap(const boost::json::value& value, double default_dog_speed, size_t default_bag_capacity)
     {
         auto id = boost::json::serialize(value.at("id"));
         CutString(id);
@@ -75,6 +89,26 @@ namespace json_loader
         CutString(name);
         util::Tagged<std::string, model::Map> id_tag{ id };
         model::Map map(id_tag, name);
+        if (const auto* speed = value.as_object().if_contains("dogSpeed"))
+        {
+            map.SetDogSpeed(speed->to_number<double>());
+        }
+        else
+        {
+            map.SetDogSpeed(default_dog_speed);
+        }
+        if (const auto* capacity = value.as_object().if_contains("bagCapacity"))
+        {
+            map.SetBagCapacity(static_cast<size_t>(capacity->as_int64()));
+        }
+        else
+        {
+            map.SetBagCapacity(default_bag_capacity);
+        }
+        if (const auto* loot_types = value.as_object().if_contains("lootTypes"))
+        {
+            AddLootTypes(map, loot_types->as_array());
+        }
         auto roads = value.at("roads").as_array();
         AddRoads(map, roads);
         auto buildings = value.at("buildings").as_array();
@@ -102,10 +136,34 @@ namespace json_loader
             }
 
             auto model_game = boost::json::parse(json_model_game);
+            if (const auto* speed = model_game.as_object().if_contains("defaultDogSpeed"))
+            {
+                game.SetDefaultDogSpeed(speed->to_number<double>());
+            }
+            size_t default_bag_capacity = 3;
+            if (const auto* capacity = model_game.as_object().if_contains("defaultBagCapacity"))
+            {
+                default_bag_capacity = static_cast<size_t>(capacity->as_int64());
+            }
+            if (const auto* retirement_time = model_game.as_object().if_contains("dogRetirementTime"))
+            {
+                // Время задаётся в секундах
+                game.SetDogRetirementTime(std::chrono::milliseconds{ static_cast<std::int64_t>(
+                    retirement_time->to_number<double>() * 1000.0) });
+            }
+            if (const auto* loot_config = model_game.as_object().if_contains("lootGeneratorConfig"))
+            {
+                // Период задаётся в секундах
+                model::LootGeneratorConfig config;
+                config.period = std::chrono::milliseconds{ static_cast<std::int64_t>(
+                    loot_config->at("period").to_number<double>() * 1000.0) };
+                config.probability = loot_config->at("probability").to_number<double>();
+                game.SetLootGeneratorConfig(config);
+            }
             auto maps = model_game.as_object().at("maps"s).as_array();
             for (const auto& map : maps)
             {
-                game.AddMap(CreateMap(map));
+                game.AddMap(CreateMap(map, game.GetDefaultDogSpeed(), default_bag_capacity));
             }
         }
 
@@ -159,6 +217,16 @@ namespace json_loader
         jv["roads"] = AddJsonArray(model.GetRoads());
         jv["buildings"] = AddJsonArray(model.GetBuildings());
         jv["offices"] = AddJsonArray(model.GetOffices());
+        if (!model.GetLootTypes().empty())
+        {
+            json::array loot_types;
+            loot_types.reserve(model.GetLootTypes().size());
+            for (const auto& loot_type : model.GetLootTypes())
+            {
+                loot_types.emplace_back(json::parse(loot_type.description));
+            }
+            jv["lootTypes"] = std::move(loot_types);
+        }
         return jv;
     }
 
@@ -175,4 +243,151 @@ namespace json_loader
         return jv;
     }
    
+    std::string_view DirectionToString(model::Direction direction) noexcept
+    {
+        switch (direction)
+        {
+        case model::Direction::NORTH:
+            return "U"sv;
+        case model::Direction::SOUTH:
+            return "D"sv;
+        case model::Direction::WEST:
+            return "L"sv;
+        case model::Direction::EAST:
+            return "R"sv;
+        }
+        return ""sv;
+    }
+
+    boost::json::object MakeJsonResponsePlayers(const model::GameSession& session)
+    {
+        json::object jv;
+        for (const auto& dog : session.GetDogs())
+        {
+            json::object player;
+            player["name"] = dog.GetName();
+            jv[std::to_string(*dog.GetId())] = std::move(player);
+        }
+        return jv;
+    }
+
+    namespace
+    {
+        json::object MakeJsonDogState(const model::GameSession& session, const model::Dog& dog)
+        {
+            const auto pos = session.GetDogPosition(dog);
+            const auto speed = session.GetDogVelocity(dog);
+            json::object jv;
+            jv["pos"] = json::array{ pos.x, pos.y };
+            jv["speed"] = json::array{ speed.x, speed.y };
+            jv["dir"] = DirectionToString(dog.GetDirection());
+            json::array bag;
+            bag.reserve(dog.GetBag().size());
+            for (const auto& object : dog.GetBag())
+            {
+                bag.emplace_back(json::object{ { "id", *object.id }, { "type", object.type } });
+            }
+            jv["bag"] = std::move(bag);
+            jv["score"] = dog.GetScore();
+            return jv;
+        }
+
+        json::object MakeJsonLostObjects(const model::GameSession& session, const std::vector<size_t>& loot)
+        {
+            json::object jv;
+            for (const size_t index : loot)
+            {
+                const auto object = session.GetLostObject(index);
+                json::object lost_object;
+                lost_object["type"] = object.type;
+                lost_object["pos"] = json::array{ object.position.x, object.position.y };
+                jv[std::to_string(*object.id)] = std::move(lost_object);
+            }
+            return jv;
+        }
+    }  // namespace
+
+    boost::json::object MakeJsonResponseState(const model::GameSession& session,
+        const std::optional<std::vector<model::Dog::Id>>& changes, bool with_loot)
+    {
+        std::vector<size_t> loot;
+        if (!changes || with_loot)
+        {
+            loot.resize(session.GetLootCount());
+            for (size_t i = 0; i < loot.size(); ++i)
+            {
+                loot[i] = i;
+            }
+        }
+        if (changes)
+        {
+            return MakeJsonResponseState(session, *changes, false, nullptr, with_loot ? &loot : nullptr);
+        }
+
+        json::object players;
+        for (const auto& dog : session.GetDogs())
+        {
+            players[std::to_string(*dog.GetId())] = MakeJsonDogState(session, dog);
+        }
+        json::object jv;
+        jv["version"] = session.GetVersion();
+        jv["full"] = true;
+        jv["players"] = std::move(players);
+        jv["lostObjects"] = MakeJsonLostObjects(session, loot);
+        return jv;
+    }
+
+    boost::json::object MakeJsonResponseState(const model::GameSession& session,
+        const std::vector<model::Dog::Id>& dogs, bool full, const std::vector<model::Dog::Id>* visible,
+        const std::vector<size_t>* loot)
+    {
+        json::object players;
+        for (const auto id : dogs)
+        {
+            if (const auto* dog = session.FindDog(id))
+            {
+                players[std::to_string(*id)] = MakeJsonDogState(session, *dog);
+            }
+            else if (!full)
+            {
+                // Собака покинула игру: клиент удаляет её из своего состояния
+                players[std::to_string(*id)] = nullptr;
+            }
+        }
+
+        json::object jv;
+        jv["version"] = session.GetVersion();
+        jv["full"] = full;
+        jv["players"] = std::move(players);
+        if (visible)
+        {
+            json::array ids;
+            ids.reserve(visible->size());
+            for (const auto id : *visible)
+            {
+                ids.emplace_back(*id);
+            }
+            jv["visible"] = std::move(ids);
+        }
+        if (loot)
+        {
+            jv["lostObjects"] = MakeJsonLostObjects(session, *loot);
+        }
+        return jv;
+    }
+
+    boost::json::array MakeJsonResponseRecords(const std::vector<app::PlayerRecord>& records)
+    {
+        json::array result;
+        result.reserve(records.size());
+        for (const app::PlayerRecord& record : records)
+        {
+            json::object jv;
+            jv["name"] = record.name;
+            jv["score"] = record.score;
+            jv["playTime"] = std::chrono::duration<double>(record.play_time).count();
+            result.emplace_back(std::move(jv));
+        }
+        return result;
+    }
 }  // namespace json_loader
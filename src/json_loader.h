@@ -1,8 +1,12 @@
 #pragma once
 
 #include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
 #include <boost/json.hpp>
 
+#include "application.h"
 #include "model.h"
 
 namespace json_loader
@@ -19,7 +23,9 @@ namespace json_loader
 
 	void AddOffices(model::Map& map, const boost::json::array& offices);
 
-	model::Map CreateMap(const boost::json::value& value);
+	void AddLootTypes(model::Map& map, const boost::json::array& loot_types);
+
+	model::Map CreateMap(const boost::json::value& value, double default_dog_speed, size_t default_bag_capacity);
 
     boost::json::object MakeJson(const model::Building& model);    
 
@@ -34,6 +40,27 @@ namespace json_loader
 
     boost::json::array MakeJsonResponseMaps(const std::vector<model::Map>& model);   
 
+    std::string_view DirectionToString(model::Direction direction) noexcept;
+
+    boost::json::object MakeJsonResponsePlayers(const model::GameSession& session);
+
+    // Состояние игрового сеанса. Если changes задан, в ответ попадают только перечисленные собаки,
+    // иначе отдаётся полный снимок. Трофеи на карте (lostObjects) передаются целиком
+    // в полном снимке и тогда, когда with_loot - набор трофеев изменился с версии клиента
+    boost::json::object MakeJsonResponseState(const model::GameSession& session,
+        const std::optional<std::vector<model::Dog::Id>>& changes, bool with_loot = false);
+
+    // Состояние собак dogs. full - ответ является полным снимком, иначе собаки dogs, покинувшие игру,
+    // передаются как null. Если задан visible,
+    // в ответ добавляется список собак в области интереса клиента, чтобы он мог забыть остальных.
+    // Если задан loot, в ответ попадают трофеи с этими индексами, заменяя известные клиенту
+    boost::json::object MakeJsonResponseState(const model::GameSession& session,
+        const std::vector<model::Dog::Id>& dogs, bool full, const std::vector<model::Dog::Id>* visible = nullptr,
+        const std::vector<size_t>* loot = nullptr);
+
+    // Страница таблицы рекордов: имя, очки и время игры в секундах
+    boost::json::array MakeJsonResponseRecords(const std::vector<app::PlayerRecord>& records);
+
 }  // namespace json_loader
 
 
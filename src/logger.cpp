@@ -0,0 +1,414 @@
+#include "logger.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace logger
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        constexpr size_t TEXT_CAPACITY = 192;
+
+        enum class Kind : std::uint8_t
+        {
+            MESSAGE, ERROR, ACCESS
+        };
+
+        // Запись кольцевого буфера. Поля, не относящиеся к виду записи, не заполняются
+        struct Record
+        {
+            std::int64_t time_us;
+            Level level;
+            Kind kind;
+            std::uint16_t text_size;
+            unsigned status;
+            std::int64_t duration_us;
+            std::uint64_t bytes;
+            std::string_view where;
+            int error_value;
+            const boost::system::error_category* error_category;
+            char text[TEXT_CAPACITY];
+
+            void SetText(std::string_view value) noexcept
+            {
+                text_size = static_cast<std::uint16_t>(std::min(value.size(), TEXT_CAPACITY));
+                value.copy(text, text_size);
+            }
+        };
+
+        // Кольцевой буфер с одним писателем (потоком-владельцем) и одним читателем (потоком вывода)
+        class Ring
+        {
+        public:
+            explicit Ring(size_t capacity)
+                : slots_(std::bit_ceil(std::max<size_t>(capacity, 2)))
+                , mask_{ slots_.size() - 1 }
+            {}
+
+            template <typename Fill>
+            void TryEmplace(Fill&& fill) noexcept
+            {
+                const size_t tail = tail_.load(std::memory_order_relaxed);
+                if (tail - head_.load(std::memory_order_acquire) == slots_.size())
+                {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                fill(slots_[tail & mask_]);
+                tail_.store(tail + 1, std::memory_order_release);
+            }
+
+            template <typename Consume>
+            void Drain(Consume&& consume)
+            {
+                size_t head = head_.load(std::memory_order_relaxed);
+                const size_t tail = tail_.load(std::memory_order_acquire);
+                for (; head != tail; ++head)
+                {
+                    consume(slots_[head & mask_]);
+                }
+                head_.store(head, std::memory_order_release);
+            }
+
+            std::uint64_t GetDropped() const noexcept
+            {
+                return dropped_.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::vector<Record> slots_;
+            size_t mask_;
+            // Индексы писателя и читателя в разных строках кеша
+            alignas(64) std::atomic<size_t> tail_{ 0 };
+            alignas(64) std::atomic<size_t> head_{ 0 };
+            std::atomic<std::uint64_t> dropped_{ 0 };
+        };
+
+        struct Registry
+        {
+            std::atomic<Level> level{ Level::INFO };
+            std::atomic<size_t> ring_capacity{ 4096 };
+            std::atomic<std::uint64_t> written{ 0 };
+            std::atomic<std::uint64_t> dropped{ 0 };
+
+            std::mutex mutex;
+            // Буферы завершившихся потоков остаются здесь, пока поток вывода их не опустошит
+            std::vector<std::shared_ptr<Ring>> rings;
+        };
+
+        Registry& GetRegistry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        Ring& LocalRing()
+        {
+            // Регистрация выполняется один раз за время жизни потока
+            thread_local const std::shared_ptr<Ring> ring = []
+            {
+                Registry& registry = GetRegistry();
+                auto ring = std::make_shared<Ring>(registry.ring_capacity.load(std::memory_order_relaxed));
+                std::lock_guard lock{ registry.mutex };
+                registry.rings.push_back(ring);
+                return ring;
+            }();
+            return *ring;
+        }
+
+        std::int64_t NowMicroseconds() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        std::string_view LevelName(Level level) noexcept
+        {
+            switch (level)
+            {
+            case Level::DEBUG:
+                return "debug"sv;
+            case Level::INFO:
+                return "info"sv;
+            case Level::WARNING:
+                return "warning"sv;
+            case Level::ERROR:
+                return "error"sv;
+            default:
+                return "off"sv;
+            }
+        }
+
+        void AppendEscaped(std::string& out, std::string_view value)
+        {
+            out += '"';
+            for (const char c : value)
+            {
+                switch (c)
+                {
+                case '"':
+                    out += "\\\""sv;
+                    break;
+                case '\\':
+                    out += "\\\\"sv;
+                    break;
+                case '\n':
+                    out += "\\n"sv;
+                    break;
+                case '\r':
+                    out += "\\r"sv;
+                    break;
+                case '\t':
+                    out += "\\t"sv;
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        char code[8];
+                        std::snprintf(code, sizeof(code), "\\u%04x", c);
+                        out += code;
+                    }
+                    else
+                    {
+                        out += c;
+                    }
+                }
+            }
+            out += '"';
+        }
+
+        void AppendTimestamp(std::string& out, std::int64_t time_us)
+        {
+            const std::time_t seconds = static_cast<std::time_t>(time_us / 1'000'000);
+            std::tm tm{};
+            ::gmtime_r(&seconds, &tm);
+            char buffer[40];
+            const size_t size = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+            out.append(buffer, size);
+            std::snprintf(buffer, sizeof(buffer), ".%06lldZ", static_cast<long long>(time_us % 1'000'000));
+            out += buffer;
+        }
+
+        void AppendRecord(std::string& out, const Record& record)
+        {
+            out += "{\"timestamp\":\""sv;
+            AppendTimestamp(out, record.time_us);
+            out += "\",\"level\":\""sv;
+            out += LevelName(record.level);
+            out += "\",\"message\":"sv;
+            const std::string_view text{ record.text, record.text_size };
+            switch (record.kind)
+            {
+            case Kind::MESSAGE:
+                AppendEscaped(out, text);
+                break;
+            case Kind::ERROR:
+                out += "\"error\",\"data\":{\"where\":"sv;
+                AppendEscaped(out, record.where);
+                out += ",\"code\":"sv;
+                out += std::to_string(record.error_value);
+                out += ",\"text\":"sv;
+                AppendEscaped(out, record.error_category->message(record.error_value));
+                out += '}';
+                break;
+            case Kind::ACCESS:
+                out += "\"request\",\"data\":{\"method\":"sv;
+                AppendEscaped(out, record.where);
+                out += ",\"target\":"sv;
+                AppendEscaped(out, text);
+                out += ",\"status\":"sv;
+                out += std::to_string(record.status);
+                out += ",\"duration_us\":"sv;
+                out += std::to_string(record.duration_us);
+                out += ",\"bytes\":"sv;
+                out += std::to_string(record.bytes);
+                out += '}';
+                break;
+            }
+            out += "}\n"sv;
+        }
+
+        void WriteAll(int fd, std::string_view data) noexcept
+        {
+            while (!data.empty())
+            {
+                const ssize_t written = ::write(fd, data.data(), data.size());
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return;
+                }
+                data.remove_prefix(static_cast<size_t>(written));
+            }
+        }
+    }  // namespace
+
+    std::optional<Level> ParseLevel(std::string_view name) noexcept
+    {
+        for (const Level level : { Level::DEBUG, Level::INFO, Level::WARNING, Level::ERROR, Level::OFF })
+        {
+            if (LevelName(level) == name)
+            {
+                return level;
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool IsEnabled(Level level) noexcept
+    {
+        return level >= GetRegistry().level.load(std::memory_order_relaxed);
+    }
+
+    void Message(Level level, std::string_view message)
+    {
+        if (!IsEnabled(level))
+        {
+            return;
+        }
+        LocalRing().TryEmplace([&](Record& record)
+        {
+            record.time_us = NowMicroseconds();
+            record.level = level;
+            record.kind = Kind::MESSAGE;
+            record.SetText(message);
+        });
+    }
+
+    void Error(const boost::system::error_code& ec, std::string_view where)
+    {
+        if (!IsEnabled(Level::ERROR))
+        {
+            return;
+        }
+        LocalRing().TryEmplace([&](Record& record)
+        {
+            record.time_us = NowMicroseconds();
+            record.level = Level::ERROR;
+            record.kind = Kind::ERROR;
+            record.text_size = 0;
+            record.where = where;
+            record.error_value = ec.value();
+            record.error_category = &ec.category();
+        });
+    }
+
+    void Access(std::string_view method, std::string_view target, unsigned status,
+        std::chrono::microseconds duration, std::uint64_t bytes)
+    {
+        if (!IsEnabled(Level::INFO))
+        {
+            return;
+        }
+        LocalRing().TryEmplace([&](Record& record)
+        {
+            record.time_us = NowMicroseconds();
+            record.level = Level::INFO;
+            record.kind = Kind::ACCESS;
+            record.where = method;
+            record.SetText(target);
+            record.status = status;
+            record.duration_us = duration.count();
+            record.bytes = bytes;
+        });
+    }
+
+    Stats GetStats() noexcept
+    {
+        const Registry& registry = GetRegistry();
+        return { registry.written.load(std::memory_order_relaxed), registry.dropped.load(std::memory_order_relaxed) };
+    }
+
+    LogWriter::LogWriter(const Settings& settings)
+        : settings_{ settings }
+    {
+        Registry& registry = GetRegistry();
+        registry.level.store(settings_.level, std::memory_order_relaxed);
+        registry.ring_capacity.store(settings_.ring_capacity, std::memory_order_relaxed);
+        thread_ = std::jthread{ [this](std::stop_token stop)
+        {
+            Run(std::move(stop));
+        } };
+    }
+
+    LogWriter::~LogWriter()
+    {
+        thread_.request_stop();
+        thread_.join();
+    }
+
+    void LogWriter::Run(std::stop_token stop)
+    {
+        Registry& registry = GetRegistry();
+        std::vector<std::shared_ptr<Ring>> rings;
+        std::vector<std::uint64_t> reported_drops;
+        std::string out;
+        std::mutex mutex;
+        std::condition_variable_any cv;
+        while (true)
+        {
+            const bool stopping = stop.stop_requested();
+            {
+                std::lock_guard lock{ registry.mutex };
+                rings = registry.rings;
+            }
+            reported_drops.resize(rings.size(), 0);
+
+            std::uint64_t written = 0;
+            std::uint64_t dropped = 0;
+            for (size_t i = 0; i < rings.size(); ++i)
+            {
+                rings[i]->Drain([&](const Record& record)
+                {
+                    AppendRecord(out, record);
+                    ++written;
+                });
+                const std::uint64_t ring_dropped = rings[i]->GetDropped();
+                dropped += ring_dropped - reported_drops[i];
+                reported_drops[i] = ring_dropped;
+            }
+            if (dropped != 0)
+            {
+                Record record{};
+                record.time_us = NowMicroseconds();
+                record.level = Level::WARNING;
+                record.kind = Kind::MESSAGE;
+                record.SetText("Log records dropped: "s + std::to_string(dropped));
+                AppendRecord(out, record);
+                registry.dropped.fetch_add(dropped, std::memory_order_relaxed);
+            }
+            if (!out.empty())
+            {
+                WriteAll(settings_.fd, out);
+                out.clear();
+                registry.written.fetch_add(written, std::memory_order_relaxed);
+            }
+
+            if (stopping)
+            {
+                return;
+            }
+            std::unique_lock lock{ mutex };
+            cv.wait_for(lock, stop, settings_.flush_interval, []
+            {
+                return false;
+            });
+        }
+    }
+}  // namespace logger
@@ -0,0 +1,72 @@
+#pragma once
+#include <boost/system/error_code.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <thread>
+
+namespace logger
+{
+    enum class Level : std::uint8_t
+    {
+        DEBUG, INFO, WARNING, ERROR, OFF
+    };
+
+    std::optional<Level> ParseLevel(std::string_view name) noexcept;
+
+    // Журнал сервера в формате JSON lines: {"timestamp":..., "level":..., "message":..., "data":{...}}.
+    // Каждый поток пишет записи фиксированного размера в собственный кольцевой буфер без блокировок,
+    // а один фоновый поток (LogWriter) периодически забирает их из всех буферов, форматирует и выводит
+    // одним вызовом write. Если буфер потока заполнен, запись отбрасывается и учитывается в счётчике,
+    // который поток вывода затем сообщает отдельной записью. Вызывающий поток никогда не ждёт
+    bool IsEnabled(Level level) noexcept;
+
+    // Текст длиннее внутреннего буфера записи усекается
+    void Message(Level level, std::string_view message);
+
+    // where должна указывать на строку со статическим временем жизни (обычно литерал):
+    // она читается потоком вывода позже
+    void Error(const boost::system::error_code& ec, std::string_view where);
+
+    // Запись журнала доступа. method - статическая строка, target копируется с усечением
+    void Access(std::string_view method, std::string_view target, unsigned status,
+        std::chrono::microseconds duration, std::uint64_t bytes);
+
+    struct Stats
+    {
+        std::uint64_t written = 0;
+        std::uint64_t dropped = 0;
+    };
+
+    Stats GetStats() noexcept;
+
+    // Поток вывода журнала. Записи, сделанные до его создания, накапливаются в буферах потоков
+    // (при переполнении новые записи отбрасываются), при уничтожении выводится всё накопленное
+    class LogWriter
+    {
+    public:
+        struct Settings
+        {
+            Level level = Level::INFO;
+            // Количество записей в буфере каждого потока. Округляется вверх до степени двойки
+            size_t ring_capacity = 4096;
+            std::chrono::milliseconds flush_interval{ 20 };
+            int fd = 1;
+        };
+
+        explicit LogWriter(const Settings& settings);
+
+        LogWriter(const LogWriter&) = delete;
+        LogWriter& operator=(const LogWriter&) = delete;
+
+        ~LogWriter();
+
+    private:
+        Settings settings_;
+        std::jthread thread_;
+
+        void Run(std::stop_token stop);
+    };
+}  // namespace logger
@@ -0,0 +1,75 @@
+#include "loop_monitor.h"
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/post.hpp>
+
+#include <string>
+
+#include "logger.h"
+#include "metrics.h"
+
+namespace app
+{
+    using namespace std::literals;
+
+    LoopMonitor::LoopMonitor(net::io_context& ioc, Strand api_strand, const Settings& settings)
+        : ioc_{ ioc }
+        , api_strand_{ api_strand }
+        , timer_strand_{ net::make_strand(ioc) }
+        , timer_{ timer_strand_ }
+        , settings_{ settings }
+    {}
+
+    void LoopMonitor::Start()
+    {
+        net::post(timer_strand_, [self = shared_from_this()]
+        {
+            self->timer_.expires_after(self->settings_.interval);
+            self->Schedule();
+        });
+    }
+
+    void LoopMonitor::Schedule()
+    {
+        timer_.async_wait(net::bind_executor(timer_strand_, [self = shared_from_this()](sys::error_code ec)
+        {
+            if (ec)
+            {
+                return;
+            }
+            self->SendProbes();
+            // Период отсчитывается от срабатывания по расписанию: опоздание таймера не сдвигает следующие пробы
+            self->timer_.expires_at(std::max(self->timer_.expiry() + self->settings_.interval, Clock::now()));
+            self->Schedule();
+        }));
+    }
+
+    void LoopMonitor::SendProbes()
+    {
+        const auto posted = Clock::now();
+        for (unsigned i = 0; i < settings_.probes; ++i)
+        {
+            net::post(ioc_, [self = shared_from_this(), posted]
+            {
+                self->OnProbe(false, posted);
+            });
+        }
+        net::post(api_strand_, [self = shared_from_this(), posted]
+        {
+            self->OnProbe(true, posted);
+        });
+    }
+
+    void LoopMonitor::OnProbe(bool api_strand, Clock::time_point posted) const
+    {
+        const auto lag = Clock::now() - posted;
+        metrics::CountLoopLag(api_strand ? metrics::Executor::API_STRAND : metrics::Executor::IO_CONTEXT, lag);
+        if (lag >= settings_.warn_threshold && logger::IsEnabled(logger::Level::WARNING))
+        {
+            logger::Message(logger::Level::WARNING, "Event loop lag "s
+                + std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(lag).count()) + " us in "s
+                + std::string{ metrics::ExecutorName(api_strand ? metrics::Executor::API_STRAND
+                                                                : metrics::Executor::IO_CONTEXT) });
+        }
+    }
+}  // namespace app
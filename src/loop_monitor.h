@@ -0,0 +1,54 @@
+#pragma once
+#include "sdk.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <chrono>
+#include <memory>
+
+namespace app
+{
+    namespace net = boost::asio;
+    namespace sys = boost::system;
+
+    // Следит за насыщением цикла событий: с заданным периодом отправляет пустые обработчики-пробы
+    // в io_context (по одной на рабочий поток, чтобы пробы попадали в разные потоки) и в api strand
+    // и измеряет, сколько они ждали запуска. Задержки учитываются в метриках по потокам,
+    // выполнившим пробу, а превышение порога записывается в журнал предупреждением
+    class LoopMonitor : public std::enable_shared_from_this<LoopMonitor>
+    {
+    public:
+        using Strand = net::strand<net::io_context::executor_type>;
+
+        struct Settings
+        {
+            std::chrono::milliseconds interval{ 100 };
+            // Задержка пробы, начиная с которой выводится предупреждение
+            std::chrono::milliseconds warn_threshold{ 50 };
+            // Количество проб io_context за период
+            unsigned probes = 1;
+        };
+
+        LoopMonitor(net::io_context& ioc, Strand api_strand, const Settings& settings);
+
+        void Start();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        net::io_context& ioc_;
+        Strand api_strand_;
+        // Таймер работает в собственном strand, чтобы его обработчик не ждал api strand
+        Strand timer_strand_;
+        net::steady_timer timer_;
+        Settings settings_;
+
+        void Schedule();
+
+        void SendProbes();
+
+        void OnProbe(bool api_strand, Clock::time_point posted) const;
+    };
+}  // namespace app
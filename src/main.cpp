@@ -1,11 +1,36 @@
 #include "sdk.h"
 //
+#include <boost/asio/executor_work_guard.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
 #include <thread>
 
+#include "admission.h"
+#include "application.h"
+#include "compute_pool.h"
+#include "io_backend.h"
 #include "json_loader.h"
+#include "journal.h"
+#include "logger.h"
+#include "loop_monitor.h"
+#include "memory_pool.h"
+#include "recording.h"
+#include "rate_limit.h"
+#include "records.h"
 #include "request_handler.h"
+#include "request_scheduler.h"
+#include "snapshot_saver.h"
+#include "state_serialization.h"
+#include "thread_topology.h"
+#include "ticker.h"
+#include "timer_wheel.h"
+#include "tracing.h"
 #include <boost/asio/signal_set.hpp>
 
 using namespace std::literals;
@@ -15,72 +40,655 @@ namespace fs = std::filesystem;
 
 namespace
 {
+    struct Args
+    {
+        std::string config_file;
+        std::string www_root;
+        // Период автоматического тика в миллисекундах. 0 - время продвигается запросами /api/v1/game/tick
+        unsigned tick_period = 0;
+        // Количество тиков, для которых хранится история изменений состояния
+        size_t state_history = 64;
+        // Максимальное количество неотправленных кадров на одно соединение WebSocket
+        size_t ws_queue_limit = 8;
+        // Радиус области интереса игрока. 0 - игрок получает состояние всех собак карты
+        double view_radius = 0.0;
+        // Зерно генераторов случайных чисел игровых сеансов
+        std::optional<std::uint64_t> random_seed;
+        // Файл сохранения состояния игры. Пустой - состояние не сохраняется
+        std::string state_file;
+        // Период автоматического сохранения в миллисекундах игрового времени. 0 - только при остановке
+        unsigned save_state_period = 0;
+        // Журнал действий между сохранениями состояния
+        bool journal = false;
+        unsigned journal_commit_interval = 10;
+        std::string journal_sync = "batch";
+        // Файл таблицы рекордов. Пустой - рекорды хранятся только в памяти
+        std::string records_file;
+        // Файл записи входных данных симуляции для game_replay
+        std::string record_file;
+        logger::Level log_level = logger::Level::INFO;
+        // Файл трассировки запросов. Пустой - трассировка выключена
+        std::string trace_file;
+        double trace_sample_rate = 0.01;
+        // Период проб цикла событий в миллисекундах. 0 - пробы не отправляются
+        unsigned loop_probe_interval = 100;
+        // Задержка пробы в миллисекундах, при которой в журнал выводится предупреждение
+        unsigned loop_lag_threshold = 50;
+        // Механизм ввода-вывода. По умолчанию - механизм, с которым собран сервер
+        io_backend::Backend io_backend = io_backend::Compiled();
+        // Недоступный io_uring - ошибка запуска, а не переход на epoll
+        bool io_backend_strict = false;
+        http_server::SessionModel session_model = http_server::SessionModel::CALLBACK;
+        // Наибольшее количество свободных блоков в каждом пуле памяти потока
+        size_t pool_capacity = memory_pool::DEFAULT_CAPACITY;
+        // Таймауты фаз HTTP-соединения в миллисекундах
+        unsigned idle_timeout = 30'000;
+        unsigned read_timeout = 30'000;
+        unsigned write_timeout = 30'000;
+        // Потоки ввода-вывода. 0 - по числу процессоров
+        unsigned io_threads = 0;
+        // Потоки, в которых выполняется игровая симуляция. 0 - она выполняется в потоках ввода-вывода
+        unsigned compute_threads = 0;
+        // Процессоры, за которыми закрепляются потоки групп. Пустой список - потоки размещает ОС
+        std::vector<unsigned> io_cpus;
+        std::vector<unsigned> compute_cpus;
+        // Потоки пула, в котором строятся тяжёлые ответы. 0 - они строятся в потоках ввода-вывода
+        unsigned offload_threads = 0;
+        std::vector<unsigned> offload_cpus;
+        bool priority_scheduling = false;
+        // Пределы открытых соединений и обрабатываемых запросов. 0 - без предела
+        size_t max_connections = 0;
+        size_t max_in_flight = 0;
+        // Допустимая задержка запросов в очередях в миллисекундах. 0 - предел запросов не подстраивается
+        unsigned target_delay = 0;
+        unsigned retry_after = 1;
+        // Ограничения частоты запросов с одного адреса по классам
+        std::array<rate_limit::Rate, rate_limit::CLASS_COUNT> rates{};
+        size_t rate_limit_table = 65536;
+    };
+
+    [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[])
+    {
+        namespace po = boost::program_options;
+
+        po::options_description desc{ "All options"s };
+        Args args;
+        std::string log_level;
+        std::string backend;
+        std::string session_model;
+        std::string io_cpus;
+        std::string compute_cpus;
+        std::string offload_cpus;
+        std::string rates;
+        desc.add_options()
+            ("help,h", "produce help message")
+            ("config-file,c", po::value(&args.config_file)->value_name("file"s), "set config file path")
+            ("www-root,w", po::value(&args.www_root)->value_name("dir"s), "set static files root")
+            ("tick-period,t", po::value(&args.tick_period)->value_name("milliseconds"s), "set tick period")
+            ("state-history", po::value(&args.state_history)->value_name("ticks"s),
+                "set number of ticks kept for delta state responses")
+            ("ws-queue-limit", po::value(&args.ws_queue_limit)->value_name("frames"s),
+                "set max number of unsent state frames per WebSocket client")
+            ("view-radius", po::value(&args.view_radius)->value_name("distance"s),
+                "set radius around player's dog for state updates (0 - whole map)")
+            ("random-seed", po::value<std::uint64_t>()->value_name("seed"s),
+                "set seed for loot generation (random by default)")
+            ("state-file", po::value(&args.state_file)->value_name("file"s),
+                "set file to save game state to and restore it from on startup")
+            ("save-state-period", po::value(&args.save_state_period)->value_name("milliseconds"s),
+                "set period of automatic game state saving")
+            ("journal", po::bool_switch(&args.journal),
+                "write accepted actions to a journal next to the state file and replay it on startup")
+            ("journal-commit-interval", po::value(&args.journal_commit_interval)->value_name("milliseconds"s),
+                "set interval of journal group commits (10 by default)")
+            ("journal-sync", po::value(&args.journal_sync)->value_name("none|batch"s),
+                "set journal sync policy: fdatasync every group commit (batch, default) or leave it to the OS (none)")
+            ("records-file", po::value(&args.records_file)->value_name("file"s),
+                "set file to append records of retired players to (records are kept in memory only by default)")
+            ("record", po::value(&args.record_file)->value_name("file"s),
+                "record simulation inputs and per-tick state hashes for game_replay")
+            ("log-level", po::value(&log_level)->value_name("debug|info|warning|error|off"s),
+                "set minimum level of server log records written to stdout (info by default)")
+            ("trace-file", po::value(&args.trace_file)->value_name("file"s),
+                "enable request tracing and write Chrome trace JSON to the file on SIGUSR1 and on shutdown")
+            ("trace-sample-rate", po::value(&args.trace_sample_rate)->value_name("fraction"s),
+                "set fraction of traced requests (0.01 by default)")
+            ("loop-probe-interval", po::value(&args.loop_probe_interval)->value_name("milliseconds"s),
+                "set period of event loop lag probes (100 by default, 0 disables probes)")
+            ("loop-lag-threshold", po::value(&args.loop_lag_threshold)->value_name("milliseconds"s),
+                "set probe lag that is logged as a warning (50 by default)")
+            ("io-backend", po::value(&backend)->value_name("epoll|io_uring"s),
+                "run with the given I/O backend, restarting as the game_server or game_server_uring binary "
+                "from the same directory if needed (io_uring falls back to epoll when the kernel does not support it "
+                "or game_server_uring is not built)")
+            ("io-backend-strict", po::bool_switch(&args.io_backend_strict),
+                "fail to start instead of falling back to epoll when io_uring is unavailable")
+            ("session-model", po::value(&session_model)->value_name("callback|coroutine"s),
+                "serve connections with completion handler chains (by default) or with one coroutine per connection")
+            ("pool-capacity", po::value(&args.pool_capacity)->value_name("blocks"s),
+                "set free blocks kept per thread for sessions, read buffers and responses (256 by default, 0 disables pools)")
+            ("idle-timeout", po::value(&args.idle_timeout)->value_name("milliseconds"s),
+                "set how long a keep-alive connection may wait for the next request (30000 by default)")
+            ("read-timeout", po::value(&args.read_timeout)->value_name("milliseconds"s),
+                "set how long reading a request may take after its first bytes arrive (30000 by default)")
+            ("write-timeout", po::value(&args.write_timeout)->value_name("milliseconds"s),
+                "set how long writing a response may take (30000 by default)")
+            ("io-threads", po::value(&args.io_threads)->value_name("n"s),
+                "set number of threads serving connections (number of CPUs by default)")
+            ("compute-threads", po::value(&args.compute_threads)->value_name("n"s),
+                "run game simulation and game API requests on n separate threads (0 by default - on I/O threads)")
+            ("io-cpus", po::value(&io_cpus)->value_name("list"s),
+                "pin I/O threads to CPUs from the list, e.g. 0-7,16-23 (not pinned by default)")
+            ("compute-cpus", po::value(&compute_cpus)->value_name("list"s),
+                "pin compute threads to CPUs from the list (not pinned by default)")
+            ("offload-threads", po::value(&args.offload_threads)->value_name("n"s),
+                "build heavy responses (map descriptions) on a work-stealing pool of n threads "
+                "(0 by default - on I/O threads)")
+            ("offload-cpus", po::value(&offload_cpus)->value_name("list"s),
+                "pin offload pool threads to CPUs from the list (not pinned by default)")
+            ("priority-scheduling", po::bool_switch(&args.priority_scheduling),
+                "handle requests through per-class priority queues: game API first, then map metadata, "
+                "then static files (FIFO by default)")
+            ("max-connections", po::value(&args.max_connections)->value_name("n"s),
+                "stop accepting connections while n connections are open (unlimited by default)")
+            ("max-in-flight", po::value(&args.max_in_flight)->value_name("n"s),
+                "answer 503 to requests above n requests being handled (unlimited by default)")
+            ("target-delay", po::value(&args.target_delay)->value_name("milliseconds"s),
+                "adapt the limit of requests in flight between 10% and 100% of --max-in-flight "
+                "to keep queueing delay below the target (fixed limit by default)")
+            ("retry-after", po::value(&args.retry_after)->value_name("seconds"s),
+                "set Retry-After of 503 responses (1 by default)")
+            ("rate-limit", po::value(&rates)->value_name("class=rate[:burst],..."s),
+                "limit requests per second from one IP address by request class (game, metadata, static), "
+                "e.g. game=50,metadata=5:20,static=100 (unlimited by default)")
+            ("rate-limit-table", po::value(&args.rate_limit_table)->value_name("entries"s),
+                "set number of client buckets kept for rate limiting (65536 by default)");
+
+        po::positional_options_description positional;
+        positional.add("config-file", 1).add("www-root", 1);
 
-    // Запускает функцию fn на n потоках, включая текущий
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+        po::notify(vm);
+
+        if (vm.contains("help"s))
+        {
+            std::cout << desc;
+            return std::nullopt;
+        }
+        if (!vm.contains("config-file"s))
+        {
+            throw std::runtime_error("Config file path is not specified"s);
+        }
+        if (!vm.contains("www-root"s))
+        {
+            throw std::runtime_error("Static files root is not specified"s);
+        }
+        if (args.journal && args.state_file.empty())
+        {
+            throw std::runtime_error("Journal requires --state-file"s);
+        }
+        if (!args.record_file.empty() && !args.state_file.empty())
+        {
+            throw std::runtime_error("Recording must start from an empty game and cannot be used with --state-file"s);
+        }
+        if (args.journal_sync != "none"sv && args.journal_sync != "batch"sv)
+        {
+            throw std::runtime_error("Unknown journal sync policy "s + args.journal_sync);
+        }
+        if (!log_level.empty())
+        {
+            const auto level = logger::ParseLevel(log_level);
+            if (!level)
+            {
+                throw std::runtime_error("Unknown log level "s + log_level);
+            }
+            args.log_level = *level;
+        }
+        if (!(args.trace_sample_rate > 0.0 && args.trace_sample_rate <= 1.0))
+        {
+            throw std::runtime_error("Trace sample rate must be in (0, 1]"s);
+        }
+        if (!backend.empty())
+        {
+            if (backend == io_backend::Name(io_backend::Backend::EPOLL))
+            {
+                args.io_backend = io_backend::Backend::EPOLL;
+            }
+            else if (backend == io_backend::Name(io_backend::Backend::IO_URING))
+            {
+                args.io_backend = io_backend::Backend::IO_URING;
+            }
+            else
+            {
+                throw std::runtime_error("Unknown I/O backend "s + backend);
+            }
+        }
+        if (session_model == "coroutine"sv)
+        {
+            args.session_model = http_server::SessionModel::COROUTINE;
+        }
+        else if (!session_model.empty() && session_model != "callback"sv)
+        {
+            throw std::runtime_error("Unknown session model "s + session_model);
+        }
+        if (!io_cpus.empty())
+        {
+            args.io_cpus = thread_topology::ParseCpuList(io_cpus);
+        }
+        if (!compute_cpus.empty())
+        {
+            if (args.compute_threads == 0)
+            {
+                throw std::runtime_error("--compute-cpus requires --compute-threads"s);
+            }
+            args.compute_cpus = thread_topology::ParseCpuList(compute_cpus);
+        }
+        if (!offload_cpus.empty())
+        {
+            if (args.offload_threads == 0)
+            {
+                throw std::runtime_error("--offload-cpus requires --offload-threads"s);
+            }
+            args.offload_cpus = thread_topology::ParseCpuList(offload_cpus);
+        }
+        if (!rates.empty())
+        {
+            args.rates = rate_limit::ParseRates(rates);
+        }
+        if (args.target_delay != 0 && args.max_in_flight == 0)
+        {
+            throw std::runtime_error("--target-delay requires --max-in-flight"s);
+        }
+        if (vm.contains("random-seed"s))
+        {
+            args.random_seed = vm["random-seed"s].as<std::uint64_t>();
+        }
+        return args;
+    }
+
+    // Группы рабочих потоков
+    constexpr size_t IO_GROUP = 0;
+    constexpr size_t COMPUTE_GROUP = 1;
+    constexpr size_t OFFLOAD_GROUP = 2;
+
+    // Запускает потоки групп: поток index группы group выполняет fn(group, index), текущий поток становится
+    // потоком 0 первой группы. Потоки закрепляются за процессорами своих групп
     template <typename Fn>
-    void RunWorkers(unsigned n, const Fn& fn)
+    void RunWorkers(const std::vector<thread_topology::Group>& groups, const Fn& fn)
     {
-        n = std::max(1u, n);
+        const auto run = [&groups, &fn](size_t group, unsigned index)
+        {
+            if (const auto cpu = thread_topology::CpuOf(groups[group], index))
+            {
+                if (const std::string error = thread_topology::PinCurrentThread(*cpu); !error.empty())
+                {
+                    logger::Message(logger::Level::WARNING, groups[group].name + " thread "s + std::to_string(index)
+                        + ": "s + error);
+                }
+            }
+            fn(group, index);
+        };
         std::vector<std::jthread> workers;
-        workers.reserve(n - 1);
-        // Запускаем n-1 рабочих потоков, выполняющих функцию fn
-        while (--n)
+        for (size_t group = 0; group < groups.size(); ++group)
         {
-            workers.emplace_back(fn);
+            for (unsigned index = group == 0 ? 1 : 0; index < groups[group].threads; ++index)
+            {
+                workers.emplace_back(run, group, index);
+            }
         }
-        fn();
+        run(0, 0);
     }
+
+    // Выгружает трассировку запросов в файл по сигналу SIGUSR1. Выгрузка выполняется в отдельном потоке,
+    // чтобы не задерживать обработку запросов; сигнал, пришедший во время выгрузки, игнорируется
+    class TraceExporter
+    {
+    public:
+        TraceExporter(net::io_context& ioc, fs::path path)
+            : signals_{ ioc, SIGUSR1 }
+            , path_{ std::move(path) }
+        {
+            Wait();
+        }
+
+        TraceExporter(const TraceExporter&) = delete;
+        TraceExporter& operator=(const TraceExporter&) = delete;
+
+        // Выгружает трассировку в вызывающем потоке, дождавшись завершения фоновой выгрузки
+        void ExportNow()
+        {
+            if (thread_.joinable())
+            {
+                thread_.join();
+            }
+            Export();
+        }
+
+    private:
+        net::signal_set signals_;
+        fs::path path_;
+        std::atomic<bool> busy_{ false };
+        std::jthread thread_;
+
+        void Wait()
+        {
+            signals_.async_wait([this](const sys::error_code& ec, [[maybe_unused]] int signal_number)
+            {
+                if (ec)
+                {
+                    return;
+                }
+                if (!busy_.exchange(true))
+                {
+                    if (thread_.joinable())
+                    {
+                        thread_.join();
+                    }
+                    thread_ = std::jthread{ [this]
+                    {
+                        Export();
+                        busy_.store(false);
+                    } };
+                }
+                Wait();
+            });
+        }
+
+        void Export()
+        {
+            try
+            {
+                const size_t count = tracing::Flush(path_);
+                logger::Message(logger::Level::INFO, "Trace with "s + std::to_string(count) + " spans written to "s
+                    + path_.string());
+            }
+            catch (const std::exception& ex)
+            {
+                logger::Message(logger::Level::ERROR, "Failed to write trace: "s + ex.what());
+            }
+        }
+    };
 }  // namespace
 
 int main(int argc, const char* argv[])
 {
-    if (argc != 3) 
+    std::optional<Args> args;
+    try
+    {
+        args = ParseCommandLine(argc, argv);
+        if (!args)
+        {
+            return EXIT_SUCCESS;
+        }
+    }
+    catch (const std::exception& ex)
     {
-        std::cerr << "Usage: game_server <game-config-json>"sv << std::endl;
+        std::cerr << ex.what() << std::endl;
+        std::cerr << "Usage: game_server <game-config-json> <www-root> [options]"sv << std::endl;
         return EXIT_FAILURE;
     }
     try
     {
+        // Процесс заменяется другой сборкой до того, как займёт порт и откроет файлы
+        io_backend::Select(args->io_backend, args->io_backend_strict, argv);
+
+        // Поток вывода журнала создаётся первым и завершается последним, выводя всё накопленное
+        logger::LogWriter log_writer{ { .level = args->log_level } };
+        logger::Message(logger::Level::INFO, "I/O backend: "s + std::string{ io_backend::Name(io_backend::Compiled()) });
+        memory_pool::SetCapacity(args->pool_capacity);
+
         // 1. Загружаем карту из файла и построить модель игры
-        model::Game game = json_loader::LoadGame(argv[1]);
-        const fs::path wwwroot = argv[2];
+        model::Game game = json_loader::LoadGame(args->config_file);
+        game.SetStateHistoryDepth(args->state_history);
+        game.SetViewRadius(args->view_radius);
+        game.SetRandomSeed(args->random_seed);
+        app::Application application{ game };
+        // Рекорды загружаются раньше состояния: при воспроизведении журнала уже записанные рекорды не дублируются
+        records::RecordsStore records{ args->records_file.empty() ? std::nullopt
+                                                                  : std::optional<fs::path>{ args->records_file } };
+        application.SetRecords(&records);
+        std::unique_ptr<serialization::Recorder> recorder;
+        if (!args->record_file.empty())
+        {
+            // Повторная симуляция возможна только с известным зерном генераторов
+            const std::uint64_t seed = args->random_seed.value_or(
+                std::uint64_t{ std::random_device{}() } << 32 | std::random_device{}());
+            game.SetRandomSeed(seed);
+            recorder = std::make_unique<serialization::Recorder>(args->record_file, application, seed,
+                serialization::HashConfigFile(args->config_file));
+            application.AddJournal(*recorder);
+        }
+        // Журнал объявлен раньше, чтобы пережить сохранение состояния при остановке
+        std::unique_ptr<serialization::Journal> journal;
+        std::unique_ptr<serialization::SnapshotSaver> saver;
+        if (!args->state_file.empty())
+        {
+            std::uint64_t journal_sequence = 0;
+            if (auto snapshot = serialization::LoadSnapshotFile(args->state_file))
+            {
+                application.Restore(*snapshot);
+                journal_sequence = snapshot->journal_sequence;
+            }
+            if (args->journal)
+            {
+                // Журнал воспроизводится до подключения слушателей и самого журнала
+                journal_sequence = serialization::ReplayJournal(args->state_file, journal_sequence, application);
+                serialization::Journal::Settings journal_settings;
+                journal_settings.commit_interval = std::chrono::milliseconds(args->journal_commit_interval);
+                journal_settings.sync = args->journal_sync == "none"sv
+                    ? serialization::Journal::SyncPolicy::NONE
+                    : serialization::Journal::SyncPolicy::BATCH;
+                journal = std::make_unique<serialization::Journal>(args->state_file, journal_sequence, journal_settings);
+                application.AddJournal(*journal);
+            }
+            // Новые рекорды получают номера после записанных в файл, в том числе после снимка
+            application.ContinueRecordIds();
+            saver = std::make_unique<serialization::SnapshotSaver>(application, args->state_file,
+                std::chrono::milliseconds(args->save_state_period), journal.get(), &records);
+            application.AddListener(*saver);
+        }
+        const fs::path wwwroot = args->www_root;
         //model::Game game = json_loader::LoadGame("C:/Users/User/cppbackend/sprint1/problems/map_json/solution/data/config.json");
        // const fs::path wwwroot = "C:/Users/User/cppbackend/sprint2/problems/static_content/solution/static";
         // 2. Инициализируем io_context
-        const unsigned num_threads = std::thread::hardware_concurrency();
-        net::io_context ioc(num_threads - 1);
+        const unsigned io_threads = args->io_threads != 0 ? args->io_threads
+                                                          : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<thread_topology::Group> topology(3);
+        topology[IO_GROUP] = { "io"s, io_threads, args->io_cpus };
+        topology[COMPUTE_GROUP] = { "compute"s, args->compute_threads, args->compute_cpus };
+        topology[OFFLOAD_GROUP] = { "offload"s, args->offload_threads, args->offload_cpus };
+        for (const std::string& line : thread_topology::Describe(topology))
+        {
+            logger::Message(logger::Level::INFO, "Threads "s + line);
+        }
+        for (const std::string& warning : thread_topology::Check(topology))
+        {
+            logger::Message(logger::Level::WARNING, "Thread layout: "s + warning);
+        }
+
+        // Колесо таймеров каждого потока ввода-вывода следит за сроками созданных им соединений.
+        // Колёса объявлены раньше io_context, потому что соединения разрушаются вместе с ним
+        std::vector<std::unique_ptr<timer_wheel::Wheel>> wheels;
+        for (unsigned i = 0; i < io_threads; ++i)
+        {
+            wheels.push_back(std::make_unique<timer_wheel::Wheel>(timer_wheel::Wheel::Settings{}));
+        }
+        // Сессии сообщают о закрытии соединений и при разрушении io_context, поэтому контроллер объявлен раньше него
+        std::optional<admission::Controller> admission;
+        if (args->max_connections != 0 || args->max_in_flight != 0)
+        {
+            admission::Limits limits;
+            limits.max_connections = args->max_connections;
+            limits.max_in_flight = args->max_in_flight;
+            limits.target_delay = std::chrono::milliseconds(args->target_delay);
+            limits.retry_after = std::chrono::seconds(args->retry_after);
+            admission.emplace(limits);
+        }
+        std::optional<rate_limit::Limiter> limiter;
+        if (std::any_of(args->rates.begin(), args->rates.end(), [](const rate_limit::Rate& rate)
+            {
+                return rate.per_second > 0.0;
+            }))
+        {
+            rate_limit::Settings limiter_settings;
+            limiter_settings.rates = args->rates;
+            limiter_settings.classify = &http_handler::RequestHandler::ClassifyPriority;
+            limiter_settings.capacity = args->rate_limit_table;
+            limiter.emplace(limiter_settings);
+        }
+        net::io_context ioc(static_cast<int>(io_threads));
+        // С вычислительными потоками игровая симуляция выполняется в отдельном io_context и не занимает потоки
+        // ввода-вывода. Он объявлен после ioc: обработчики в его очереди владеют сессиями, которые должны
+        // разрушиться раньше ioc
+        std::optional<net::io_context> compute_ioc;
+        std::optional<net::executor_work_guard<net::io_context::executor_type>> compute_work;
+        if (args->compute_threads != 0)
+        {
+            compute_ioc.emplace(static_cast<int>(args->compute_threads));
+            compute_work.emplace(compute_ioc->get_executor());
+        }
+        // Задачи пула владеют сессиями, поэтому он тоже разрушается раньше ioc
+        std::optional<compute_pool::Pool> offload;
+        if (args->offload_threads != 0)
+        {
+            offload.emplace(args->offload_threads);
+        }
+        std::optional<request_scheduler::Scheduler> scheduler;
+        if (args->priority_scheduling)
+        {
+            scheduler.emplace(ioc);
+        }
+
+        std::unique_ptr<TraceExporter> trace_exporter;
+        if (!args->trace_file.empty())
+        {
+            tracing::Enable(args->trace_sample_rate);
+            trace_exporter = std::make_unique<TraceExporter>(ioc, args->trace_file);
+        }
 
         // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
         net::signal_set signals(ioc, SIGINT, SIGTERM);
-        signals.async_wait([&ioc](const sys::error_code& ec, [[maybe_unused]] int signal_number)
+        signals.async_wait([&ioc, &compute_ioc, &offload](const sys::error_code& ec, [[maybe_unused]] int signal_number)
             {
                 if (!ec)
                 {
                     ioc.stop();
+                    if (compute_ioc)
+                    {
+                        compute_ioc->stop();
+                    }
+                    if (offload)
+                    {
+                        offload->Stop();
+                    }
                 }
             });
 
-        // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
-        http_handler::RequestHandler handler{game, wwwroot};
+        // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры.
+        // Игровое состояние изменяется только в api_strand: запросами игрового API и тиками
+        auto api_strand = net::make_strand(compute_ioc ? *compute_ioc : ioc);
+        http_handler::RequestHandler::Settings settings;
+        settings.manual_tick = args->tick_period == 0;
+        settings.ws_queue_limit = args->ws_queue_limit;
+        settings.offload = offload ? &*offload : nullptr;
+        settings.scheduler = scheduler ? &*scheduler : nullptr;
+        settings.admission = admission ? &*admission : nullptr;
+        http_handler::RequestHandler handler{ application, game, records, wwwroot, api_strand, settings };
+        if (!settings.manual_tick)
+        {
+            auto ticker = std::make_shared<app::Ticker>(api_strand, std::chrono::milliseconds(args->tick_period),
+                [&application](std::chrono::milliseconds delta)
+                {
+                    application.Tick(delta);
+                });
+            ticker->Start();
+        }
+
+        if (args->loop_probe_interval != 0)
+        {
+            app::LoopMonitor::Settings monitor_settings;
+            monitor_settings.interval = std::chrono::milliseconds(args->loop_probe_interval);
+            monitor_settings.warn_threshold = std::chrono::milliseconds(args->loop_lag_threshold);
+            monitor_settings.probes = io_threads;
+            std::make_shared<app::LoopMonitor>(ioc, api_strand, monitor_settings)->Start();
+        }
+
+        for (const auto& wheel : wheels)
+        {
+            // Колёса продвигаются в собственных strand, независимо от того, в каком потоке выполняются соединения
+            std::make_shared<app::Ticker>(net::make_strand(ioc), wheel->GetTick(),
+                [wheel = wheel.get()](std::chrono::milliseconds)
+                {
+                    wheel->Advance(timer_wheel::Wheel::Clock::now());
+                })->Start();
+        }
+
+        if (limiter)
+        {
+            // Записи клиентов, корзины которых успели наполниться, освобождают место для новых клиентов
+            std::make_shared<app::Ticker>(net::make_strand(ioc), 1s, [&limiter](std::chrono::milliseconds)
+                {
+                    limiter->Evict(rate_limit::Limiter::Clock::now());
+                })->Start();
+        }
 
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         const auto address = net::ip::make_address("0.0.0.0");
         constexpr unsigned short port = 8080;
         
+        http_server::Settings server_settings;
+        server_settings.model = args->session_model;
+        server_settings.timeouts.idle = std::chrono::milliseconds(args->idle_timeout);
+        server_settings.timeouts.read = std::chrono::milliseconds(args->read_timeout);
+        server_settings.timeouts.write = std::chrono::milliseconds(args->write_timeout);
+        server_settings.admission = admission ? &*admission : nullptr;
+        server_settings.rate_limit = limiter ? &*limiter : nullptr;
         http_server::ServeHttp(ioc, {address, port}, [&handler](auto&& req, auto&& send) 
         {
             handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
-        });
+        },
+        [&handler](auto&& stream, auto&& req)
+        {
+            handler.Upgrade(std::forward<decltype(stream)>(stream), std::forward<decltype(req)>(req));
+        }, server_settings);
         
 
-        // Эта надпись сообщает тестам о том, что сервер запущен и готов обрабатывать запросы
-        std::cout << "Server has started..."sv << std::endl;
+        // Эта запись сообщает тестам о том, что сервер запущен и готов обрабатывать запросы.
+        // Она выводится через журнал, чтобы поток вывода оставался последовательностью записей JSON
+        logger::Message(logger::Level::INFO, "Server has started..."sv);
 
         // 6. Запускаем обработку асинхронных операций
-        RunWorkers(std::max(1u, num_threads), [&ioc]
+        RunWorkers(topology, [&ioc, &compute_ioc, &offload, &wheels](size_t group, unsigned index)
+            {
+            if (group == COMPUTE_GROUP)
             {
+                compute_ioc->run();
+                return;
+            }
+            if (group == OFFLOAD_GROUP)
+            {
+                offload->Run(index);
+                return;
+            }
+            const timer_wheel::Scope wheel_scope{ wheels[index].get() };
             ioc.run();
         });
+
+        // Все рабочие потоки завершились, игровое состояние больше не изменяется
+        if (admission)
+        {
+            // Приёмник соединений, ожидающий закрытия соединения, закрывается раньше io_context
+            admission->Stop();
+        }
+        if (saver)
+        {
+            saver->SaveNow();
+        }
+        if (trace_exporter)
+        {
+            trace_exporter->ExportNow();
+        }
     } catch (const std::exception& ex)
     {
         std::cerr << ex.what() << std::endl;
@@ -0,0 +1,58 @@
+#include "memory_pool.h"
+
+#include <utility>
+
+namespace memory_pool
+{
+    namespace
+    {
+        std::atomic<std::size_t> capacity{ DEFAULT_CAPACITY };
+    }  // namespace
+
+    void SetCapacity(std::size_t value) noexcept
+    {
+        capacity.store(value, std::memory_order_relaxed);
+    }
+
+    std::size_t GetCapacity() noexcept
+    {
+        return capacity.load(std::memory_order_relaxed);
+    }
+
+    FreeList::~FreeList()
+    {
+        while (head_)
+        {
+            ::operator delete(std::exchange(head_, head_->next));
+        }
+        size_ = 0;
+        closed_ = true;
+    }
+
+    void* FreeList::Allocate()
+    {
+        if (head_)
+        {
+            metrics::CountPoolAllocation(pool_, true);
+            --size_;
+            return std::exchange(head_, head_->next);
+        }
+        metrics::CountPoolAllocation(pool_, false);
+        return ::operator new(block_size_);
+    }
+
+    void FreeList::Deallocate(void* block) noexcept
+    {
+        if (closed_)
+        {
+            return ::operator delete(block);
+        }
+        if (size_ >= GetCapacity())
+        {
+            metrics::CountPoolOverflow(pool_);
+            return ::operator delete(block);
+        }
+        head_ = new (block) Node{ head_ };
+        ++size_;
+    }
+}  // namespace memory_pool
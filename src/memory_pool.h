@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+#include "metrics.h"
+
+namespace memory_pool
+{
+    // Наибольшее количество свободных блоков в одном списке потока по умолчанию
+    constexpr std::size_t DEFAULT_CAPACITY = 256;
+
+    // Размер блока пула буферов чтения. Буферы большего размера выделяются в куче
+    constexpr std::size_t BUFFER_BLOCK_SIZE = 4096;
+
+    // Наибольшее количество свободных блоков в одном списке. 0 - пулы выключены, память сразу возвращается в кучу.
+    // Действует и на уже созданные списки: лишние блоки освобождаются по мере их возврата
+    void SetCapacity(std::size_t capacity) noexcept;
+
+    std::size_t GetCapacity() noexcept;
+
+    // Список свободных блоков одного размера, принадлежащий одному потоку. Блок может быть освобождён
+    // в другом потоке, чем выделен: тогда он попадает в список освободившего потока.
+    // Размер списка ограничен, поэтому после всплеска соединений лишняя память возвращается в кучу
+    class FreeList
+    {
+    public:
+        FreeList(std::size_t block_size, metrics::Pool pool) noexcept
+            : block_size_{ block_size }
+            , pool_{ pool }
+        {}
+
+        FreeList(const FreeList&) = delete;
+        FreeList& operator=(const FreeList&) = delete;
+
+        ~FreeList();
+
+        void* Allocate();
+
+        void Deallocate(void* block) noexcept;
+
+    private:
+        struct Node
+        {
+            Node* next;
+        };
+
+        std::size_t block_size_;
+        metrics::Pool pool_;
+        Node* head_ = nullptr;
+        std::size_t size_ = 0;
+        // Список потока уже разрушен: блоки, освобождаемые при завершении потока, возвращаются в кучу
+        bool closed_ = false;
+    };
+
+    // Список потока для блоков BlockSize байт пула Pool
+    template <metrics::Pool Pool, std::size_t BlockSize>
+    FreeList& LocalFreeList()
+    {
+        thread_local FreeList list{ BlockSize, Pool };
+        return list;
+    }
+
+    // Аллокатор, выделяющий объекты по одному из списков свободных блоков потока. Блок вмещает
+    // MaxBytes байт (по умолчанию - один объект T); большие запросы, например рост буфера, идут в кучу.
+    // Подходит для std::allocate_shared (объект и счётчик ссылок - один блок) и буферов Beast
+    template <typename T, metrics::Pool Pool, std::size_t MaxBytes = 0>
+    class Allocator
+    {
+    public:
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = Allocator<U, Pool, MaxBytes>;
+        };
+
+        Allocator() noexcept = default;
+
+        template <typename U>
+        Allocator(const Allocator<U, Pool, MaxBytes>&) noexcept
+        {}
+
+        T* allocate(std::size_t n)
+        {
+            if (n * sizeof(T) <= BLOCK_SIZE)
+            {
+                return static_cast<T*>(LocalFreeList<Pool, BLOCK_SIZE>().Allocate());
+            }
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* pointer, std::size_t n) noexcept
+        {
+            if (n * sizeof(T) <= BLOCK_SIZE)
+            {
+                return LocalFreeList<Pool, BLOCK_SIZE>().Deallocate(pointer);
+            }
+            ::operator delete(pointer);
+        }
+
+        template <typename U>
+        bool operator==(const Allocator<U, Pool, MaxBytes>&) const noexcept
+        {
+            return true;
+        }
+
+    private:
+        // Свободный блок хранит указатель на следующий
+        static constexpr std::size_t BLOCK_SIZE = std::max(MaxBytes != 0 ? MaxBytes : sizeof(T), sizeof(void*));
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "Pool blocks have the default new alignment");
+    };
+}  // namespace memory_pool
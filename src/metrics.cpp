@@ -0,0 +1,786 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "logger.h"
+
+namespace metrics
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        constexpr size_t ROUTE_COUNT = static_cast<size_t>(Route::COUNT);
+        constexpr size_t EXECUTOR_COUNT = static_cast<size_t>(Executor::COUNT);
+        constexpr size_t POOL_COUNT = static_cast<size_t>(Pool::COUNT);
+        constexpr size_t PHASE_COUNT = static_cast<size_t>(Phase::COUNT);
+        constexpr size_t PRIORITY_COUNT = static_cast<size_t>(Priority::COUNT);
+
+        // Учитываются коды статуса 100..599
+        constexpr unsigned MIN_STATUS = 100;
+        constexpr size_t STATUS_COUNT = 500;
+
+        constexpr unsigned SUB_BITS = 3;
+        constexpr size_t SUB_BUCKETS = size_t{ 1 } << SUB_BITS;
+        // Значения от 2^40 нс (около 18 минут) попадают в последнюю корзину
+        constexpr unsigned MAX_BITS = 40;
+        constexpr size_t BUCKET_COUNT = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+        // В Prometheus выводятся корзины с границами 2^10..2^35 нс (около 1 мкс..34 с):
+        // они совпадают с границами внутренних корзин, поэтому счётчики точные
+        constexpr unsigned EXPORT_MIN_BITS = 10;
+        constexpr unsigned EXPORT_MAX_BITS = 35;
+
+        constexpr std::array QUANTILES{ 0.5, 0.9, 0.99, 0.999 };
+
+        size_t BucketIndex(std::uint64_t value) noexcept
+        {
+            if (value < SUB_BUCKETS)
+            {
+                return static_cast<size_t>(value);
+            }
+            const unsigned bits = static_cast<unsigned>(std::bit_width(value)) - 1;
+            if (bits >= MAX_BITS)
+            {
+                return BUCKET_COUNT - 1;
+            }
+            return (bits - SUB_BITS + 1) * SUB_BUCKETS + ((value >> (bits - SUB_BITS)) & (SUB_BUCKETS - 1));
+        }
+
+        // Границы [lower, upper) значений корзины в наносекундах
+        std::pair<std::uint64_t, std::uint64_t> BucketBounds(size_t index) noexcept
+        {
+            if (index < SUB_BUCKETS)
+            {
+                return { index, index + 1 };
+            }
+            const unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS) - 1;
+            const std::uint64_t sub = index % SUB_BUCKETS;
+            return { (SUB_BUCKETS + sub) << shift, (SUB_BUCKETS + sub + 1) << shift };
+        }
+
+        // Счётчик с единственным писателем: увеличение не требует атомарного чтения-изменения-записи
+        class Counter
+        {
+        public:
+            void Add(std::uint64_t value) noexcept
+            {
+                value_.store(value_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+
+            std::uint64_t Load() const noexcept
+            {
+                return value_.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::atomic<std::uint64_t> value_{ 0 };
+        };
+
+        template <typename Cell>
+        struct Histogram
+        {
+            std::array<Cell, BUCKET_COUNT> buckets{};
+            Cell count{};
+            Cell sum_ns{};
+        };
+
+        // Блок метрик. Cell - Counter в блоках потоков и std::uint64_t в сумме по потокам
+        template <typename Cell>
+        struct Block
+        {
+            std::array<std::array<Cell, STATUS_COUNT>, ROUTE_COUNT> requests{};
+            std::array<Histogram<Cell>, ROUTE_COUNT> handle{};
+            Histogram<Cell> read{};
+            Histogram<Cell> write{};
+            Cell bytes_received{};
+            Cell bytes_sent{};
+            Cell sessions_opened{};
+            Cell sessions_closed{};
+            Cell accept_errors{};
+            Cell requests_started{};
+            Cell requests_finished{};
+            Cell strand_queued{};
+            Cell strand_started{};
+            Cell offload_queued{};
+            Cell offload_local{};
+            Cell offload_stolen{};
+            Cell shed{};
+            Cell accept_pauses{};
+            std::array<Cell, PRIORITY_COUNT> rate_limited{};
+            Cell rate_limit_misses{};
+            std::array<Cell, PRIORITY_COUNT> scheduled{};
+            std::array<Histogram<Cell>, PRIORITY_COUNT> schedule_wait{};
+            std::array<Histogram<Cell>, EXECUTOR_COUNT> loop_lag{};
+            std::array<Cell, POOL_COUNT> pool_hits{};
+            std::array<Cell, POOL_COUNT> pool_misses{};
+            std::array<Cell, POOL_COUNT> pool_overflows{};
+            std::array<Cell, PHASE_COUNT> timeouts{};
+        };
+
+        using ThreadBlock = Block<Counter>;
+        using Totals = Block<std::uint64_t>;
+
+        void Observe(Histogram<Counter>& histogram, std::chrono::nanoseconds duration) noexcept
+        {
+            const auto value = static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0));
+            histogram.buckets[BucketIndex(value)].Add(1);
+            histogram.count.Add(1);
+            histogram.sum_ns.Add(value);
+        }
+
+        void Merge(std::uint64_t& total, const Counter& counter) noexcept
+        {
+            total += counter.Load();
+        }
+
+        void Merge(Histogram<std::uint64_t>& total, const Histogram<Counter>& histogram) noexcept
+        {
+            for (size_t i = 0; i < BUCKET_COUNT; ++i)
+            {
+                Merge(total.buckets[i], histogram.buckets[i]);
+            }
+            Merge(total.count, histogram.count);
+            Merge(total.sum_ns, histogram.sum_ns);
+        }
+
+        void Merge(Totals& total, const ThreadBlock& block) noexcept
+        {
+            for (size_t route = 0; route < ROUTE_COUNT; ++route)
+            {
+                for (size_t status = 0; status < STATUS_COUNT; ++status)
+                {
+                    Merge(total.requests[route][status], block.requests[route][status]);
+                }
+                Merge(total.handle[route], block.handle[route]);
+            }
+            Merge(total.read, block.read);
+            Merge(total.write, block.write);
+            Merge(total.bytes_received, block.bytes_received);
+            Merge(total.bytes_sent, block.bytes_sent);
+            Merge(total.sessions_opened, block.sessions_opened);
+            Merge(total.sessions_closed, block.sessions_closed);
+            Merge(total.accept_errors, block.accept_errors);
+            Merge(total.requests_started, block.requests_started);
+            Merge(total.requests_finished, block.requests_finished);
+            Merge(total.strand_queued, block.strand_queued);
+            Merge(total.strand_started, block.strand_started);
+            Merge(total.offload_queued, block.offload_queued);
+            Merge(total.offload_local, block.offload_local);
+            Merge(total.offload_stolen, block.offload_stolen);
+            Merge(total.shed, block.shed);
+            Merge(total.accept_pauses, block.accept_pauses);
+            Merge(total.rate_limit_misses, block.rate_limit_misses);
+            for (size_t priority = 0; priority < PRIORITY_COUNT; ++priority)
+            {
+                Merge(total.scheduled[priority], block.scheduled[priority]);
+                Merge(total.rate_limited[priority], block.rate_limited[priority]);
+                Merge(total.schedule_wait[priority], block.schedule_wait[priority]);
+            }
+            for (size_t executor = 0; executor < EXECUTOR_COUNT; ++executor)
+            {
+                Merge(total.loop_lag[executor], block.loop_lag[executor]);
+            }
+            for (size_t pool = 0; pool < POOL_COUNT; ++pool)
+            {
+                Merge(total.pool_hits[pool], block.pool_hits[pool]);
+                Merge(total.pool_misses[pool], block.pool_misses[pool]);
+                Merge(total.pool_overflows[pool], block.pool_overflows[pool]);
+            }
+            for (size_t phase = 0; phase < PHASE_COUNT; ++phase)
+            {
+                Merge(total.timeouts[phase], block.timeouts[phase]);
+            }
+        }
+
+        struct Registry
+        {
+            std::mutex mutex;
+            // Блоки завершившихся потоков остаются здесь: их значения входят в суммы
+            std::vector<std::shared_ptr<ThreadBlock>> blocks;
+        };
+
+        // Предел задаёт один объект admission::Controller, поэтому он хранится вне блоков потоков
+        std::atomic<std::size_t> in_flight_limit{ 0 };
+
+        Registry& GetRegistry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        ThreadBlock& LocalBlock()
+        {
+            // Регистрация выполняется один раз за время жизни потока
+            thread_local const std::shared_ptr<ThreadBlock> block = []
+            {
+                auto block = std::make_shared<ThreadBlock>();
+                Registry& registry = GetRegistry();
+                std::lock_guard lock{ registry.mutex };
+                registry.blocks.push_back(block);
+                return block;
+            }();
+            return *block;
+        }
+
+        class Writer
+        {
+        public:
+            void Family(std::string_view name, std::string_view type, std::string_view help)
+            {
+                out_ += "# HELP "sv;
+                out_ += name;
+                out_ += ' ';
+                out_ += help;
+                out_ += "\n# TYPE "sv;
+                out_ += name;
+                out_ += ' ';
+                out_ += type;
+                out_ += '\n';
+            }
+
+            // labels - уже сформированный список меток без фигурных скобок
+            void Sample(std::string_view name, std::string_view labels, std::uint64_t value)
+            {
+                Begin(name, labels);
+                out_ += std::to_string(value);
+                out_ += '\n';
+            }
+
+            void Sample(std::string_view name, std::string_view labels, double value)
+            {
+                Begin(name, labels);
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+                out_ += buffer;
+                out_ += '\n';
+            }
+
+            void HistogramSamples(std::string_view name, std::string_view labels, const Histogram<std::uint64_t>& histogram)
+            {
+                const std::string bucket_name = std::string{ name } + "_bucket"s;
+                std::string bucket_labels{ labels };
+                if (!bucket_labels.empty())
+                {
+                    bucket_labels += ',';
+                }
+                const size_t prefix_size = bucket_labels.size();
+
+                std::uint64_t cumulative = 0;
+                size_t index = 0;
+                for (unsigned bits = EXPORT_MIN_BITS; bits <= EXPORT_MAX_BITS; ++bits)
+                {
+                    const std::uint64_t bound = std::uint64_t{ 1 } << bits;
+                    for (; index < BUCKET_COUNT && BucketBounds(index).second <= bound; ++index)
+                    {
+                        cumulative += histogram.buckets[index];
+                    }
+                    bucket_labels.resize(prefix_size);
+                    bucket_labels += "le=\""sv;
+                    AppendSeconds(bucket_labels, static_cast<double>(bound));
+                    bucket_labels += '"';
+                    Sample(bucket_name, bucket_labels, cumulative);
+                }
+                bucket_labels.resize(prefix_size);
+                bucket_labels += "le=\"+Inf\""sv;
+                Sample(bucket_name, bucket_labels, histogram.count);
+                Sample(std::string{ name } + "_sum"s, labels, static_cast<double>(histogram.sum_ns) / 1e9);
+                Sample(std::string{ name } + "_count"s, labels, histogram.count);
+            }
+
+            // Квантили по внутренним корзинам: середина корзины, в которую попадает квантиль
+            void QuantileSamples(std::string_view name, std::string_view labels, const Histogram<std::uint64_t>& histogram)
+            {
+                std::string quantile_labels{ labels };
+                if (!quantile_labels.empty())
+                {
+                    quantile_labels += ',';
+                }
+                const size_t prefix_size = quantile_labels.size();
+                for (const double quantile : QUANTILES)
+                {
+                    const auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(histogram.count - 1)) + 1;
+                    std::uint64_t cumulative = 0;
+                    size_t index = 0;
+                    while (index + 1 < BUCKET_COUNT && cumulative + histogram.buckets[index] < rank)
+                    {
+                        cumulative += histogram.buckets[index++];
+                    }
+                    const auto [lower, upper] = BucketBounds(index);
+                    quantile_labels.resize(prefix_size);
+                    quantile_labels += "quantile=\""sv;
+                    char buffer[16];
+                    std::snprintf(buffer, sizeof(buffer), "%g", quantile);
+                    quantile_labels += buffer;
+                    quantile_labels += '"';
+                    Sample(name, quantile_labels, static_cast<double>(lower + upper) / 2e9);
+                }
+            }
+
+            std::string Release()
+            {
+                return std::move(out_);
+            }
+
+        private:
+            std::string out_;
+
+            void Begin(std::string_view name, std::string_view labels)
+            {
+                out_ += name;
+                if (!labels.empty())
+                {
+                    out_ += '{';
+                    out_ += labels;
+                    out_ += '}';
+                }
+                out_ += ' ';
+            }
+
+            static void AppendSeconds(std::string& out, double nanoseconds)
+            {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%.12g", nanoseconds / 1e9);
+                out += buffer;
+            }
+        };
+
+        // Разность счётчиков начала и окончания. Блоки потоков читаются не одновременно,
+        // поэтому окончание может оказаться учтённым раньше начала
+        double Difference(std::uint64_t started, std::uint64_t finished) noexcept
+        {
+            return static_cast<double>(std::max<std::int64_t>(static_cast<std::int64_t>(started - finished), 0));
+        }
+
+        std::string Label(std::string_view name, std::string_view value)
+        {
+            std::string label{ name };
+            label += "=\""sv;
+            label += value;
+            label += '"';
+            return label;
+        }
+    }  // namespace
+
+    std::string_view RouteName(Route route) noexcept
+    {
+        switch (route)
+        {
+        case Route::MAPS:
+            return "maps"sv;
+        case Route::MAP:
+            return "map"sv;
+        case Route::JOIN:
+            return "join"sv;
+        case Route::PLAYERS:
+            return "players"sv;
+        case Route::STATE:
+            return "state"sv;
+        case Route::ACTION:
+            return "action"sv;
+        case Route::TICK:
+            return "tick"sv;
+        case Route::RECORDS:
+            return "records"sv;
+        case Route::METRICS:
+            return "metrics"sv;
+        case Route::STATIC:
+            return "static"sv;
+        default:
+            return "other"sv;
+        }
+    }
+
+    std::string_view ExecutorName(Executor executor) noexcept
+    {
+        return executor == Executor::API_STRAND ? "api_strand"sv : "io_context"sv;
+    }
+
+    std::string_view PoolName(Pool pool) noexcept
+    {
+        switch (pool)
+        {
+        case Pool::SESSION:
+            return "session"sv;
+        case Pool::BUFFER:
+            return "buffer"sv;
+        case Pool::RESPONSE:
+            return "response"sv;
+        default:
+            return "arena"sv;
+        }
+    }
+
+    std::string_view PhaseName(Phase phase) noexcept
+    {
+        switch (phase)
+        {
+        case Phase::IDLE:
+            return "idle"sv;
+        case Phase::READ:
+            return "read"sv;
+        default:
+            return "write"sv;
+        }
+    }
+
+    std::string_view PriorityName(Priority priority) noexcept
+    {
+        switch (priority)
+        {
+        case Priority::GAME:
+            return "game"sv;
+        case Priority::METADATA:
+            return "metadata"sv;
+        default:
+            return "static"sv;
+        }
+    }
+
+    void CountRequest(Route route, unsigned status, std::chrono::nanoseconds handle_duration) noexcept
+    {
+        ThreadBlock& block = LocalBlock();
+        const size_t route_index = std::min(static_cast<size_t>(route), ROUTE_COUNT - 1);
+        const size_t status_index = std::min<size_t>(std::max(status, MIN_STATUS) - MIN_STATUS, STATUS_COUNT - 1);
+        block.requests[route_index][status_index].Add(1);
+        Observe(block.handle[route_index], handle_duration);
+    }
+
+    void CountRead(std::chrono::nanoseconds duration, std::uint64_t bytes) noexcept
+    {
+        ThreadBlock& block = LocalBlock();
+        Observe(block.read, duration);
+        block.bytes_received.Add(bytes);
+    }
+
+    void CountWrite(std::chrono::nanoseconds duration, std::uint64_t bytes) noexcept
+    {
+        ThreadBlock& block = LocalBlock();
+        Observe(block.write, duration);
+        block.bytes_sent.Add(bytes);
+    }
+
+    void CountSessionOpened() noexcept
+    {
+        LocalBlock().sessions_opened.Add(1);
+    }
+
+    void CountSessionClosed() noexcept
+    {
+        LocalBlock().sessions_closed.Add(1);
+    }
+
+    void CountAcceptError() noexcept
+    {
+        LocalBlock().accept_errors.Add(1);
+    }
+
+    void CountRequestStarted() noexcept
+    {
+        LocalBlock().requests_started.Add(1);
+    }
+
+    void CountRequestFinished() noexcept
+    {
+        LocalBlock().requests_finished.Add(1);
+    }
+
+    void CountStrandQueued() noexcept
+    {
+        LocalBlock().strand_queued.Add(1);
+    }
+
+    void CountStrandStarted() noexcept
+    {
+        LocalBlock().strand_started.Add(1);
+    }
+
+    void CountOffloadQueued() noexcept
+    {
+        LocalBlock().offload_queued.Add(1);
+    }
+
+    void CountOffloadStarted(bool stolen) noexcept
+    {
+        ThreadBlock& block = LocalBlock();
+        (stolen ? block.offload_stolen : block.offload_local).Add(1);
+    }
+
+    void CountScheduled(Priority priority) noexcept
+    {
+        LocalBlock().scheduled[std::min(static_cast<size_t>(priority), PRIORITY_COUNT - 1)].Add(1);
+    }
+
+    void CountScheduleWait(Priority priority, std::chrono::nanoseconds wait) noexcept
+    {
+        Observe(LocalBlock().schedule_wait[std::min(static_cast<size_t>(priority), PRIORITY_COUNT - 1)], wait);
+    }
+
+    void CountShed() noexcept
+    {
+        LocalBlock().shed.Add(1);
+    }
+
+    void CountAcceptPaused() noexcept
+    {
+        LocalBlock().accept_pauses.Add(1);
+    }
+
+    void SetInFlightLimit(std::size_t limit) noexcept
+    {
+        in_flight_limit.store(limit, std::memory_order_relaxed);
+    }
+
+    void CountRateLimited(Priority priority) noexcept
+    {
+        LocalBlock().rate_limited[std::min(static_cast<size_t>(priority), PRIORITY_COUNT - 1)].Add(1);
+    }
+
+    void CountRateLimitMiss() noexcept
+    {
+        LocalBlock().rate_limit_misses.Add(1);
+    }
+
+    void CountLoopLag(Executor executor, std::chrono::nanoseconds lag) noexcept
+    {
+        Observe(LocalBlock().loop_lag[std::min(static_cast<size_t>(executor), EXECUTOR_COUNT - 1)], lag);
+    }
+
+    void CountPoolAllocation(Pool pool, bool hit) noexcept
+    {
+        ThreadBlock& block = LocalBlock();
+        const size_t index = std::min(static_cast<size_t>(pool), POOL_COUNT - 1);
+        (hit ? block.pool_hits : block.pool_misses)[index].Add(1);
+    }
+
+    void CountPoolOverflow(Pool pool) noexcept
+    {
+        LocalBlock().pool_overflows[std::min(static_cast<size_t>(pool), POOL_COUNT - 1)].Add(1);
+    }
+
+    void CountTimeout(Phase phase) noexcept
+    {
+        LocalBlock().timeouts[std::min(static_cast<size_t>(phase), PHASE_COUNT - 1)].Add(1);
+    }
+
+    std::string RenderPrometheus()
+    {
+        // Сумма занимает десятки килобайт и не размещается на стеке
+        const auto totals = std::make_unique<Totals>();
+        // Задержки проб выводятся отдельно по потокам, номер потока - позиция его блока
+        std::vector<std::array<Histogram<std::uint64_t>, EXECUTOR_COUNT>> thread_lags;
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard lock{ registry.mutex };
+            thread_lags.resize(registry.blocks.size());
+            for (size_t thread = 0; thread < registry.blocks.size(); ++thread)
+            {
+                const ThreadBlock& block = *registry.blocks[thread];
+                Merge(*totals, block);
+                for (size_t executor = 0; executor < EXECUTOR_COUNT; ++executor)
+                {
+                    Merge(thread_lags[thread][executor], block.loop_lag[executor]);
+                }
+            }
+        }
+
+        Writer writer;
+        writer.Family("game_http_requests_total"sv, "counter"sv, "HTTP requests by route and response status"sv);
+        for (size_t route = 0; route < ROUTE_COUNT; ++route)
+        {
+            const std::string route_label = Label("route"sv, RouteName(static_cast<Route>(route)));
+            for (size_t status = 0; status < STATUS_COUNT; ++status)
+            {
+                if (const std::uint64_t count = totals->requests[route][status]; count != 0)
+                {
+                    writer.Sample("game_http_requests_total"sv,
+                        route_label + ","s + Label("status"sv, std::to_string(MIN_STATUS + status)), count);
+                }
+            }
+        }
+
+        writer.Family("game_http_handle_seconds"sv, "histogram"sv,
+            "Time from request parsed to response ready, including wait for the game API strand"sv);
+        for (size_t route = 0; route < ROUTE_COUNT; ++route)
+        {
+            if (totals->handle[route].count != 0)
+            {
+                writer.HistogramSamples("game_http_handle_seconds"sv, Label("route"sv, RouteName(static_cast<Route>(route))),
+                    totals->handle[route]);
+            }
+        }
+        writer.Family("game_http_handle_quantile_seconds"sv, "gauge"sv,
+            "Quantiles of game_http_handle_seconds with 12.5% relative precision"sv);
+        for (size_t route = 0; route < ROUTE_COUNT; ++route)
+        {
+            if (totals->handle[route].count != 0)
+            {
+                writer.QuantileSamples("game_http_handle_quantile_seconds"sv,
+                    Label("route"sv, RouteName(static_cast<Route>(route))), totals->handle[route]);
+            }
+        }
+
+        const std::string read_label = Label("phase"sv, "read"sv);
+        const std::string write_label = Label("phase"sv, "write"sv);
+        writer.Family("game_http_phase_seconds"sv, "histogram"sv,
+            "Time to receive and parse a request (from its first bytes) and to send a response"sv);
+        writer.HistogramSamples("game_http_phase_seconds"sv, read_label, totals->read);
+        writer.HistogramSamples("game_http_phase_seconds"sv, write_label, totals->write);
+        writer.Family("game_http_phase_quantile_seconds"sv, "gauge"sv,
+            "Quantiles of game_http_phase_seconds with 12.5% relative precision"sv);
+        if (totals->read.count != 0)
+        {
+            writer.QuantileSamples("game_http_phase_quantile_seconds"sv, read_label, totals->read);
+        }
+        if (totals->write.count != 0)
+        {
+            writer.QuantileSamples("game_http_phase_quantile_seconds"sv, write_label, totals->write);
+        }
+
+        writer.Family("game_http_received_bytes_total"sv, "counter"sv, "Bytes of parsed HTTP requests"sv);
+        writer.Sample("game_http_received_bytes_total"sv, ""sv, totals->bytes_received);
+        writer.Family("game_http_sent_bytes_total"sv, "counter"sv, "Bytes of sent HTTP responses"sv);
+        writer.Sample("game_http_sent_bytes_total"sv, ""sv, totals->bytes_sent);
+        writer.Family("game_http_sessions_total"sv, "counter"sv, "Accepted HTTP connections"sv);
+        writer.Sample("game_http_sessions_total"sv, ""sv, totals->sessions_opened);
+        writer.Family("game_http_sessions_active"sv, "gauge"sv, "Open HTTP connections, not counting those upgraded to WebSocket"sv);
+        writer.Sample("game_http_sessions_active"sv, ""sv, Difference(totals->sessions_opened, totals->sessions_closed));
+        writer.Family("game_http_accept_errors_total"sv, "counter"sv, "Failed accepts of incoming connections"sv);
+        writer.Sample("game_http_accept_errors_total"sv, ""sv, totals->accept_errors);
+
+        writer.Family("game_http_requests_in_flight"sv, "gauge"sv, "HTTP requests read and not yet answered"sv);
+        writer.Sample("game_http_requests_in_flight"sv, ""sv, Difference(totals->requests_started, totals->requests_finished));
+        if (const std::size_t limit = in_flight_limit.load(std::memory_order_relaxed); limit != 0)
+        {
+            writer.Family("game_http_in_flight_limit"sv, "gauge"sv,
+                "Current limit of HTTP requests in flight, adapted to queueing delay"sv);
+            writer.Sample("game_http_in_flight_limit"sv, ""sv, static_cast<std::uint64_t>(limit));
+        }
+        writer.Family("game_http_shed_total"sv, "counter"sv,
+            "Requests answered with 503 because the limit of requests in flight was reached"sv);
+        writer.Sample("game_http_shed_total"sv, ""sv, totals->shed);
+        writer.Family("game_http_accept_pauses_total"sv, "counter"sv,
+            "Times accepting connections was paused because the connection limit was reached"sv);
+        writer.Sample("game_http_accept_pauses_total"sv, ""sv, totals->accept_pauses);
+        writer.Family("game_http_rate_limited_total"sv, "counter"sv,
+            "Requests answered with 429 because the client exceeded the rate limit of the request class"sv);
+        for (size_t priority = 0; priority < PRIORITY_COUNT; ++priority)
+        {
+            writer.Sample("game_http_rate_limited_total"sv, Label("class"sv, PriorityName(static_cast<Priority>(priority))),
+                totals->rate_limited[priority]);
+        }
+        writer.Family("game_rate_limit_table_misses_total"sv, "counter"sv,
+            "Requests let through unchecked because the rate limit table had no free entry near the client's slot"sv);
+        writer.Sample("game_rate_limit_table_misses_total"sv, ""sv, totals->rate_limit_misses);
+        writer.Family("game_api_strand_queued"sv, "gauge"sv, "Game API requests waiting for the api strand"sv);
+        writer.Sample("game_api_strand_queued"sv, ""sv, Difference(totals->strand_queued, totals->strand_started));
+        writer.Family("game_offload_queued"sv, "gauge"sv, "Tasks waiting in the compute pool"sv);
+        writer.Sample("game_offload_queued"sv, ""sv,
+            Difference(totals->offload_queued, totals->offload_local + totals->offload_stolen));
+        writer.Family("game_offload_tasks_total"sv, "counter"sv,
+            "Compute pool tasks started from the worker's own queue (local) or taken from another worker (stolen)"sv);
+        writer.Sample("game_offload_tasks_total"sv, Label("source"sv, "local"sv), totals->offload_local);
+        writer.Sample("game_offload_tasks_total"sv, Label("source"sv, "stolen"sv), totals->offload_stolen);
+
+        writer.Family("game_http_scheduled"sv, "gauge"sv, "Requests waiting in the queue of their priority class"sv);
+        for (size_t priority = 0; priority < PRIORITY_COUNT; ++priority)
+        {
+            writer.Sample("game_http_scheduled"sv, Label("class"sv, PriorityName(static_cast<Priority>(priority))),
+                Difference(totals->scheduled[priority], totals->schedule_wait[priority].count));
+        }
+        writer.Family("game_http_schedule_wait_seconds"sv, "histogram"sv,
+            "Time a request waits in the queue of its priority class before its handler runs"sv);
+        for (size_t priority = 0; priority < PRIORITY_COUNT; ++priority)
+        {
+            if (totals->schedule_wait[priority].count != 0)
+            {
+                writer.HistogramSamples("game_http_schedule_wait_seconds"sv,
+                    Label("class"sv, PriorityName(static_cast<Priority>(priority))), totals->schedule_wait[priority]);
+            }
+        }
+        writer.Family("game_http_schedule_wait_quantile_seconds"sv, "gauge"sv,
+            "Quantiles of game_http_schedule_wait_seconds with 12.5% relative precision"sv);
+        for (size_t priority = 0; priority < PRIORITY_COUNT; ++priority)
+        {
+            if (totals->schedule_wait[priority].count != 0)
+            {
+                writer.QuantileSamples("game_http_schedule_wait_quantile_seconds"sv,
+                    Label("class"sv, PriorityName(static_cast<Priority>(priority))), totals->schedule_wait[priority]);
+            }
+        }
+
+        writer.Family("game_loop_lag_seconds"sv, "histogram"sv,
+            "Delay between posting a probe handler to an executor and running it, by running thread"sv);
+        for (size_t thread = 0; thread < thread_lags.size(); ++thread)
+        {
+            for (size_t executor = 0; executor < EXECUTOR_COUNT; ++executor)
+            {
+                if (thread_lags[thread][executor].count != 0)
+                {
+                    writer.HistogramSamples("game_loop_lag_seconds"sv,
+                        Label("executor"sv, ExecutorName(static_cast<Executor>(executor))) + ","s
+                            + Label("thread"sv, std::to_string(thread)),
+                        thread_lags[thread][executor]);
+                }
+            }
+        }
+        writer.Family("game_loop_lag_quantile_seconds"sv, "gauge"sv,
+            "Quantiles of game_loop_lag_seconds over all threads with 12.5% relative precision"sv);
+        for (size_t executor = 0; executor < EXECUTOR_COUNT; ++executor)
+        {
+            if (totals->loop_lag[executor].count != 0)
+            {
+                writer.QuantileSamples("game_loop_lag_quantile_seconds"sv,
+                    Label("executor"sv, ExecutorName(static_cast<Executor>(executor))), totals->loop_lag[executor]);
+            }
+        }
+
+        writer.Family("game_pool_allocations_total"sv, "counter"sv,
+            "Allocations from per-thread memory pools, served from a free list (hit) or from the heap (miss)"sv);
+        for (size_t pool = 0; pool < POOL_COUNT; ++pool)
+        {
+            const std::string pool_label = Label("pool"sv, PoolName(static_cast<Pool>(pool)));
+            writer.Sample("game_pool_allocations_total"sv, pool_label + ","s + Label("result"sv, "hit"sv),
+                totals->pool_hits[pool]);
+            writer.Sample("game_pool_allocations_total"sv, pool_label + ","s + Label("result"sv, "miss"sv),
+                totals->pool_misses[pool]);
+        }
+        writer.Family("game_pool_hit_ratio"sv, "gauge"sv, "Share of pool allocations served from a free list"sv);
+        for (size_t pool = 0; pool < POOL_COUNT; ++pool)
+        {
+            if (const std::uint64_t total = totals->pool_hits[pool] + totals->pool_misses[pool]; total != 0)
+            {
+                writer.Sample("game_pool_hit_ratio"sv, Label("pool"sv, PoolName(static_cast<Pool>(pool))),
+                    static_cast<double>(totals->pool_hits[pool]) / static_cast<double>(total));
+            }
+        }
+        writer.Family("game_pool_overflows_total"sv, "counter"sv,
+            "Freed blocks returned to the heap because the free list of the thread was full"sv);
+        for (size_t pool = 0; pool < POOL_COUNT; ++pool)
+        {
+            writer.Sample("game_pool_overflows_total"sv, Label("pool"sv, PoolName(static_cast<Pool>(pool))),
+                totals->pool_overflows[pool]);
+        }
+        writer.Family("game_http_timeouts_total"sv, "counter"sv,
+            "Connections closed because a phase timeout expired"sv);
+        for (size_t phase = 0; phase < PHASE_COUNT; ++phase)
+        {
+            writer.Sample("game_http_timeouts_total"sv, Label("phase"sv, PhaseName(static_cast<Phase>(phase))),
+                totals->timeouts[phase]);
+        }
+
+        const logger::Stats log_stats = logger::GetStats();
+        writer.Family("game_log_records_written_total"sv, "counter"sv, "Server log records written"sv);
+        writer.Sample("game_log_records_written_total"sv, ""sv, log_stats.written);
+        writer.Family("game_log_records_dropped_total"sv, "counter"sv, "Server log records dropped on full buffers"sv);
+        writer.Sample("game_log_records_dropped_total"sv, ""sv, log_stats.dropped);
+        return writer.Release();
+    }
+}  // namespace metrics
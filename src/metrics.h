@@ -0,0 +1,133 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace metrics
+{
+    // Маршруты HTTP API, по которым ведётся статистика запросов
+    enum class Route : std::uint8_t
+    {
+        MAPS, MAP, JOIN, PLAYERS, STATE, ACTION, TICK, RECORDS, METRICS, STATIC, OTHER, COUNT
+    };
+
+    std::string_view RouteName(Route route) noexcept;
+
+    // Исполнители, задержка запуска обработчиков в которых измеряется пробами
+    enum class Executor : std::uint8_t
+    {
+        IO_CONTEXT, API_STRAND, COUNT
+    };
+
+    std::string_view ExecutorName(Executor executor) noexcept;
+
+    // Пулы памяти HTTP-сервера (см. memory_pool.h)
+    enum class Pool : std::uint8_t
+    {
+        SESSION, BUFFER, RESPONSE, ARENA, COUNT
+    };
+
+    std::string_view PoolName(Pool pool) noexcept;
+
+    // Фазы HTTP-соединения, для которых задаются таймауты
+    enum class Phase : std::uint8_t
+    {
+        // Ожидание следующего запроса
+        IDLE,
+        // Чтение запроса после получения его первых байтов
+        READ,
+        WRITE,
+        COUNT
+    };
+
+    std::string_view PhaseName(Phase phase) noexcept;
+
+    // Классы запросов в порядке убывания приоритета (см. request_scheduler.h)
+    enum class Priority : std::uint8_t
+    {
+        // Игровое API: действия игроков и состояние игры
+        GAME,
+        // Описания карт, рекорды, метрики
+        METADATA,
+        // Статические файлы
+        STATIC,
+        COUNT
+    };
+
+    std::string_view PriorityName(Priority priority) noexcept;
+
+    // Метрики HTTP-сервера. Каждый поток пишет в собственный блок счётчиков и гистограмм
+    // (атомарные переменные, которые изменяет только поток-владелец, с упорядочиванием relaxed),
+    // поэтому запись не использует блокировок и не разделяет строки кеша между потоками.
+    // Блоки суммируются только при чтении метрик.
+    // Гистограммы длительностей устроены как HDR: 8 поддиапазонов на каждую степень двойки наносекунд,
+    // относительная погрешность не превышает 12.5%
+
+    void CountRequest(Route route, unsigned status, std::chrono::nanoseconds handle_duration) noexcept;
+
+    // duration - время от получения первых байтов запроса до окончания его разбора
+    void CountRead(std::chrono::nanoseconds duration, std::uint64_t bytes) noexcept;
+
+    void CountWrite(std::chrono::nanoseconds duration, std::uint64_t bytes) noexcept;
+
+    void CountSessionOpened() noexcept;
+
+    void CountSessionClosed() noexcept;
+
+    void CountAcceptError() noexcept;
+
+    // Запрос прочитан и ещё не получил ответа
+    void CountRequestStarted() noexcept;
+
+    void CountRequestFinished() noexcept;
+
+    // Запрос передан в api strand и ещё не начал выполняться
+    void CountStrandQueued() noexcept;
+
+    void CountStrandStarted() noexcept;
+
+    // Задача поставлена в вычислительный пул (см. compute_pool.h) и ещё не начала выполняться
+    void CountOffloadQueued() noexcept;
+
+    // stolen - задачу взял поток, в очередь которого она не ставилась
+    void CountOffloadStarted(bool stolen) noexcept;
+
+    // Запрос поставлен в очередь своего класса и ещё не начал обрабатываться
+    void CountScheduled(Priority priority) noexcept;
+
+    // Запрос взят из очереди после ожидания wait
+    void CountScheduleWait(Priority priority, std::chrono::nanoseconds wait) noexcept;
+
+    // Задержка между отправкой пробы в executor и её запуском. Учитывается отдельно по потокам,
+    // выполнившим пробу
+    void CountLoopLag(Executor executor, std::chrono::nanoseconds lag) noexcept;
+
+    // Выделение блока из пула потока: hit - блок взят из списка свободных, иначе выделен в куче
+    void CountPoolAllocation(Pool pool, bool hit) noexcept;
+
+    // Освобождённый блок не поместился в заполненный список свободных и возвращён в кучу
+    void CountPoolOverflow(Pool pool) noexcept;
+
+    // Соединение закрыто по истечении таймаута фазы
+    void CountTimeout(Phase phase) noexcept;
+
+    // Запрос отклонён ответом 503: предел обрабатываемых запросов исчерпан (см. admission.h)
+    void CountShed() noexcept;
+
+    // Приём соединений приостановлен: предел открытых соединений исчерпан
+    void CountAcceptPaused() noexcept;
+
+    // Текущий предел обрабатываемых запросов, 0 - без предела
+    void SetInFlightLimit(std::size_t limit) noexcept;
+
+    // Запрос получил ответ 429: клиент превысил ограничение частоты запросов своего класса (см. rate_limit.h)
+    void CountRateLimited(Priority priority) noexcept;
+
+    // Для корзины клиента не нашлось места в таблице, запрос пропущен без проверки
+    void CountRateLimitMiss() noexcept;
+
+    // Все метрики в текстовом формате Prometheus
+    std::string RenderPrometheus();
+}  // namespace metrics
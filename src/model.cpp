@@ -1,11 +1,23 @@
 #include "model.h"
 
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 
+#include "collision_detector.h"
+
 namespace model
 {
     using namespace std::literals;
 
+    movement::RoadBounds Road::GetBounds() const noexcept
+    {
+        return {
+            std::min(start_.x, end_.x) - HALF_WIDTH, std::max(start_.x, end_.x) + HALF_WIDTH,
+            std::min(start_.y, end_.y) - HALF_WIDTH, std::max(start_.y, end_.y) + HALF_WIDTH
+        };
+    }
+
     void Map::AddOffice(Office office)
     {
         if (warehouse_id_to_index_.contains(office.GetId()))
@@ -27,6 +39,560 @@ namespace model
         }
     }
 
+    namespace
+    {
+        // Ширина захвата собаки, радиус базы и трофея
+        constexpr double DOG_GATHER_WIDTH = 0.3;
+        constexpr double OFFICE_WIDTH = 0.25;
+        constexpr double LOOT_WIDTH = 0.0;
+
+        // Собаки сеанса перемещаются из prev в текущую позицию. Предметы - сначала трофеи, затем базы
+        class GatherProvider : public collision_detector::ItemGathererProvider
+        {
+        public:
+            GatherProvider(const std::vector<double>& loot_x, const std::vector<double>& loot_y,
+                const Map::Offices& offices, const std::vector<double>& prev_x, const std::vector<double>& prev_y,
+                const movement::DogsState& state) noexcept
+                : loot_x_{ loot_x }
+                , loot_y_{ loot_y }
+                , offices_{ offices }
+                , prev_x_{ prev_x }
+                , prev_y_{ prev_y }
+                , state_{ state }
+            {}
+
+            size_t ItemsCount() const override
+            {
+                return loot_x_.size() + offices_.size();
+            }
+
+            collision_detector::Item GetItem(size_t idx) const override
+            {
+                if (idx < loot_x_.size())
+                {
+                    return { { loot_x_[idx], loot_y_[idx] }, LOOT_WIDTH };
+                }
+                const Point pos = offices_[idx - loot_x_.size()].GetPosition();
+                return { { static_cast<double>(pos.x), static_cast<double>(pos.y) }, OFFICE_WIDTH };
+            }
+
+            size_t GatherersCount() const override
+            {
+                return state_.Size();
+            }
+
+            collision_detector::Gatherer GetGatherer(size_t idx) const override
+            {
+                return { { prev_x_[idx], prev_y_[idx] }, { state_.x[idx], state_.y[idx] }, DOG_GATHER_WIDTH };
+            }
+
+        private:
+            const std::vector<double>& loot_x_;
+            const std::vector<double>& loot_y_;
+            const Map::Offices& offices_;
+            const std::vector<double>& prev_x_;
+            const std::vector<double>& prev_y_;
+            const movement::DogsState& state_;
+        };
+    }  // namespace
+
+    GameSession::GameSession(const Map& map, size_t history_depth, const LootGeneratorConfig& loot_config,
+        std::uint64_t seed)
+        : map_{ &map }
+        , history_(std::max<size_t>(history_depth, 1))
+        , random_{ seed }
+        , loot_generator_{ loot_config.period, loot_config.probability, [this]
+        {
+            return std::uniform_real_distribution<double>{ 0.0, 1.0 }(random_);
+        } }
+    {}
+
+    Dog& GameSession::AddDog(std::string name)
+    {
+        const auto& roads = map_->GetRoads();
+        const Point start = roads.empty() ? Point{ 0, 0 } : roads.front().GetStart();
+        const movement::RoadBounds bounds = roads.empty()
+            ? movement::RoadBounds{ 0.0, 0.0, 0.0, 0.0 }
+            : roads.front().GetBounds();
+
+        const Dog::Id id{ next_dog_id_ };
+        const size_t index = state_.Add(start.x, start.y, bounds);
+        Dog& dog = dogs_.emplace_back(id, std::move(name), index);
+        dog_id_to_index_.emplace(id, dogs_.size() - 1);
+        ++next_dog_id_;
+        MarkChanged(dog);
+        grid_dirty_ = true;
+        return dog;
+    }
+
+    Dog* GameSession::FindDog(Dog::Id id) noexcept
+    {
+        if (auto it = dog_id_to_index_.find(id); it != dog_id_to_index_.end())
+        {
+            return &dogs_[it->second];
+        }
+        return nullptr;
+    }
+
+    const Dog* GameSession::FindDog(Dog::Id id) const noexcept
+    {
+        if (auto it = dog_id_to_index_.find(id); it != dog_id_to_index_.end())
+        {
+            return &dogs_[it->second];
+        }
+        return nullptr;
+    }
+
+    void GameSession::SetDogDirection(Dog& dog, std::optional<Direction> direction) noexcept
+    {
+        const size_t i = dog.GetIndex();
+        MarkChanged(dog);
+        if (!direction)
+        {
+            state_.vx[i] = 0.0;
+            state_.vy[i] = 0.0;
+            return;
+        }
+        dog.SetDirection(*direction);
+
+        // Среди дорог, на которых стоит собака, выбираем ту, что идёт в нужном направлении
+        // и тянется в нём дальше всего. Если такой нет, собака остаётся в границах текущей дороги.
+        const bool horizontal = *direction == Direction::WEST || *direction == Direction::EAST;
+        const double x = state_.x[i];
+        const double y = state_.y[i];
+        const Road* best_road = nullptr;
+        double best_reach = 0.0;
+        for (const Road& road : map_->GetRoads())
+        {
+            if (road.IsHorizontal() != horizontal)
+            {
+                continue;
+            }
+            const movement::RoadBounds b = road.GetBounds();
+            if (x < b.min_x || x > b.max_x || y < b.min_y || y > b.max_y)
+            {
+                continue;
+            }
+            double reach = 0.0;
+            switch (*direction)
+            {
+            case Direction::NORTH:
+                reach = -b.min_y;
+                break;
+            case Direction::SOUTH:
+                reach = b.max_y;
+                break;
+            case Direction::WEST:
+                reach = -b.min_x;
+                break;
+            case Direction::EAST:
+                reach = b.max_x;
+                break;
+            }
+            if (!best_road || reach > best_reach)
+            {
+                best_road = &road;
+                best_reach = reach;
+            }
+        }
+        if (best_road)
+        {
+            state_.SetBounds(i, best_road->GetBounds());
+        }
+
+        const double speed = map_->GetDogSpeed();
+        switch (*direction)
+        {
+        case Direction::NORTH:
+            state_.vx[i] = 0.0;
+            state_.vy[i] = -speed;
+            break;
+        case Direction::SOUTH:
+            state_.vx[i] = 0.0;
+            state_.vy[i] = speed;
+            break;
+        case Direction::WEST:
+            state_.vx[i] = -speed;
+            state_.vy[i] = 0.0;
+            break;
+        case Direction::EAST:
+            state_.vx[i] = speed;
+            state_.vy[i] = 0.0;
+            break;
+        }
+    }
+
+    void GameSession::MarkChanged(const Dog& dog)
+    {
+        pending_changes_.push_back(dog.GetId());
+    }
+
+    void GameSession::Tick(double dt)
+    {
+        ++version_;
+        ChangeSet& changes = history_[version_ % history_.size()];
+        changes.version = version_;
+        changes.dogs.swap(pending_changes_);
+        pending_changes_.clear();
+
+        // За тик меняются только движущиеся собаки: остановившиеся в этом тике
+        // тоже попадают в набор, так как скорость проверяется до перемещения
+        for (const Dog& dog : dogs_)
+        {
+            const size_t i = dog.GetIndex();
+            if (state_.vx[i] != 0.0 || state_.vy[i] != 0.0)
+            {
+                changes.dogs.push_back(dog.GetId());
+            }
+        }
+
+        prev_x_.assign(state_.x.begin(), state_.x.end());
+        prev_y_.assign(state_.y.begin(), state_.y.end());
+        movement::MoveDogs(state_, dt);
+        grid_dirty_ = true;
+
+        // Рюкзак и очки меняются только у движущихся собак, которые уже попали в набор изменений
+        CollectLoot();
+        GenerateLoot(dt);
+        RetireIdleDogs(std::chrono::milliseconds{ static_cast<std::int64_t>(std::llround(dt * 1000.0)) }, changes.dogs);
+
+        std::sort(changes.dogs.begin(), changes.dogs.end());
+        changes.dogs.erase(std::unique(changes.dogs.begin(), changes.dogs.end()), changes.dogs.end());
+    }
+
+    void GameSession::RetireIdleDogs(std::chrono::milliseconds delta, std::vector<Dog::Id>& changes)
+    {
+        retired_.clear();
+        // Обход с конца: на место ушедшей собаки переносится последняя, уже обработанная
+        for (size_t i = dogs_.size(); i-- > 0;)
+        {
+            Dog& dog = dogs_[i];
+            dog.play_time_ += delta;
+            dog.idle_time_ = state_.vx[i] == 0.0 && state_.vy[i] == 0.0 ? dog.idle_time_ + delta
+                                                                        : std::chrono::milliseconds{};
+            if (retirement_time_ == std::chrono::milliseconds{} || dog.idle_time_ < retirement_time_)
+            {
+                continue;
+            }
+
+            changes.push_back(dog.GetId());
+            dog_id_to_index_.erase(dog.GetId());
+            retired_.push_back(std::move(dog));
+            if (i != dogs_.size() - 1)
+            {
+                dogs_[i] = std::move(dogs_.back());
+                dogs_[i].index_ = i;
+                dog_id_to_index_[dogs_[i].GetId()] = i;
+            }
+            dogs_.pop_back();
+            state_.SwapRemove(i);
+        }
+    }
+
+    void GameSession::CaptureSnapshot(GameSessionSnapshot& snapshot) const
+    {
+        snapshot.map_id = map_->GetId();
+        snapshot.version = version_;
+        snapshot.loot_version = loot_version_;
+        snapshot.next_dog_id = next_dog_id_;
+        snapshot.next_loot_id = next_loot_id_;
+        snapshot.dogs.assign(dogs_.begin(), dogs_.end());
+        snapshot.state = state_;
+        snapshot.loot.clear();
+        snapshot.loot.reserve(loot_ids_.size());
+        for (size_t i = 0; i < loot_ids_.size(); ++i)
+        {
+            snapshot.loot.push_back(GetLostObject(i));
+        }
+        snapshot.random = random_;
+        snapshot.time_without_loot = loot_generator_.GetTimeWithoutLoot();
+    }
+
+    void GameSession::Restore(const GameSessionSnapshot& snapshot)
+    {
+        if (snapshot.dogs.size() != snapshot.state.Size())
+        {
+            throw std::invalid_argument("Inconsistent session snapshot");
+        }
+        // Тип трофея - индекс в типах трофеев карты: по нему DeliverBag начисляет очки
+        const size_t loot_type_count = map_->GetLootTypes().size();
+        const auto is_unknown_type = [loot_type_count](const auto& object)
+        {
+            return object.type >= loot_type_count;
+        };
+        if (std::any_of(snapshot.loot.begin(), snapshot.loot.end(), is_unknown_type)
+            || std::any_of(snapshot.dogs.begin(), snapshot.dogs.end(), [&is_unknown_type](const Dog& dog)
+            {
+                return std::any_of(dog.GetBag().begin(), dog.GetBag().end(), is_unknown_type);
+            }))
+        {
+            throw std::invalid_argument("Snapshot refers to unknown loot type of map " + *map_->GetId());
+        }
+
+        version_ = snapshot.version;
+        history_start_ = snapshot.version;
+        for (ChangeSet& changes : history_)
+        {
+            changes = {};
+        }
+        pending_changes_.clear();
+        retired_.clear();
+
+        dogs_.assign(snapshot.dogs.begin(), snapshot.dogs.end());
+        dog_id_to_index_.clear();
+        for (size_t i = 0; i < dogs_.size(); ++i)
+        {
+            if (dogs_[i].GetIndex() != i)
+            {
+                throw std::invalid_argument("Inconsistent session snapshot");
+            }
+            dog_id_to_index_.emplace(dogs_[i].GetId(), i);
+        }
+        state_ = snapshot.state;
+        next_dog_id_ = snapshot.next_dog_id;
+
+        loot_ids_.clear();
+        loot_types_.clear();
+        loot_x_.clear();
+        loot_y_.clear();
+        for (const LostObject& object : snapshot.loot)
+        {
+            loot_ids_.push_back(object.id);
+            loot_types_.push_back(object.type);
+            loot_x_.push_back(object.position.x);
+            loot_y_.push_back(object.position.y);
+        }
+        next_loot_id_ = snapshot.next_loot_id;
+        loot_version_ = snapshot.loot_version;
+
+        random_ = snapshot.random;
+        loot_generator_.SetTimeWithoutLoot(snapshot.time_without_loot);
+        grid_dirty_ = true;
+        loot_grid_dirty_ = true;
+    }
+
+    void GameSession::CollectLoot()
+    {
+        const auto events = collision_detector::FindGatherEvents(
+            GatherProvider{ loot_x_, loot_y_, map_->GetOffices(), prev_x_, prev_y_, state_ });
+        if (events.empty())
+        {
+            return;
+        }
+
+        const size_t loot_count = loot_ids_.size();
+        const size_t bag_capacity = map_->GetBagCapacity();
+        std::vector<bool> collected(loot_count, false);
+        bool loot_changed = false;
+        for (const auto& event : events)
+        {
+            Dog& dog = dogs_[event.gatherer_id];
+            if (event.item_id >= loot_count)
+            {
+                dog.DeliverBag(map_->GetLootTypes());
+                continue;
+            }
+            if (collected[event.item_id] || dog.GetBag().size() >= bag_capacity)
+            {
+                continue;
+            }
+            dog.PutToBag({ loot_ids_[event.item_id], loot_types_[event.item_id] });
+            collected[event.item_id] = true;
+            loot_changed = true;
+        }
+        if (!loot_changed)
+        {
+            return;
+        }
+
+        // Оставшиеся трофеи сохраняют порядок появления
+        size_t kept = 0;
+        for (size_t i = 0; i < loot_count; ++i)
+        {
+            if (collected[i])
+            {
+                continue;
+            }
+            loot_ids_[kept] = loot_ids_[i];
+            loot_types_[kept] = loot_types_[i];
+            loot_x_[kept] = loot_x_[i];
+            loot_y_[kept] = loot_y_[i];
+            ++kept;
+        }
+        loot_ids_.erase(loot_ids_.begin() + kept, loot_ids_.end());
+        loot_types_.erase(loot_types_.begin() + kept, loot_types_.end());
+        loot_x_.erase(loot_x_.begin() + kept, loot_x_.end());
+        loot_y_.erase(loot_y_.begin() + kept, loot_y_.end());
+        loot_version_ = version_;
+        loot_grid_dirty_ = true;
+    }
+
+    void GameSession::GenerateLoot(double dt)
+    {
+        const auto& roads = map_->GetRoads();
+        const auto& loot_types = map_->GetLootTypes();
+        const auto time_delta = std::chrono::milliseconds{ static_cast<std::int64_t>(std::llround(dt * 1000.0)) };
+        const unsigned count = loot_generator_.Generate(time_delta,
+            static_cast<unsigned>(loot_ids_.size()), static_cast<unsigned>(dogs_.size()));
+        if (count == 0 || roads.empty() || loot_types.empty())
+        {
+            return;
+        }
+
+        std::uniform_int_distribution<size_t> road_dist{ 0, roads.size() - 1 };
+        std::uniform_int_distribution<size_t> type_dist{ 0, loot_types.size() - 1 };
+        std::uniform_real_distribution<double> along{ 0.0, 1.0 };
+        for (unsigned i = 0; i < count; ++i)
+        {
+            const Road& road = roads[road_dist(random_)];
+            const double t = along(random_);
+            const Point start = road.GetStart();
+            const Point end = road.GetEnd();
+            loot_ids_.push_back(LostObject::Id{ next_loot_id_++ });
+            loot_types_.push_back(type_dist(random_));
+            loot_x_.push_back(start.x + (end.x - start.x) * t);
+            loot_y_.push_back(start.y + (end.y - start.y) * t);
+        }
+        loot_version_ = version_;
+        loot_grid_dirty_ = true;
+    }
+
+    const InterestGrid& GameSession::GetInterestGrid() const
+    {
+        if (grid_dirty_)
+        {
+            grid_.Rebuild(state_, view_radius_ > 0.0 ? view_radius_ : 1.0);
+            grid_dirty_ = false;
+        }
+        return grid_;
+    }
+
+    const InterestGrid& GameSession::GetLootGrid() const
+    {
+        if (loot_grid_dirty_)
+        {
+            loot_grid_.Rebuild(loot_x_, loot_y_, view_radius_ > 0.0 ? view_radius_ : 1.0);
+            loot_grid_dirty_ = false;
+        }
+        return loot_grid_;
+    }
+
+    std::vector<Dog::Id> GameSession::FindDogsNear(Position center, double radius) const
+    {
+        const InterestGrid& grid = GetInterestGrid();
+        const InterestGrid::Cell center_cell = grid.GetCell(center.x, center.y);
+        const double radius2 = radius * radius;
+
+        std::vector<Dog::Id> result;
+        for (std::int64_t dy = -1; dy <= 1; ++dy)
+        {
+            for (std::int64_t dx = -1; dx <= 1; ++dx)
+            {
+                grid.ForEachInCell({ center_cell.x + dx, center_cell.y + dy }, [&](size_t index)
+                {
+                    const double ox = state_.x[index] - center.x;
+                    const double oy = state_.y[index] - center.y;
+                    if (ox * ox + oy * oy <= radius2)
+                    {
+                        result.push_back(dogs_[index].GetId());
+                    }
+                });
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    InterestGrid::Cell GameSession::GetInterestCell(const Dog& dog) const
+    {
+        return GetInterestGrid().GetCell(state_.x[dog.GetIndex()], state_.y[dog.GetIndex()]);
+    }
+
+    std::vector<Dog::Id> GameSession::FindDogsAroundCell(InterestGrid::Cell cell) const
+    {
+        const InterestGrid& grid = GetInterestGrid();
+        std::vector<Dog::Id> result;
+        for (std::int64_t dy = -1; dy <= 1; ++dy)
+        {
+            for (std::int64_t dx = -1; dx <= 1; ++dx)
+            {
+                grid.ForEachInCell({ cell.x + dx, cell.y + dy }, [&](size_t index)
+                {
+                    result.push_back(dogs_[index].GetId());
+                });
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    std::vector<size_t> GameSession::FindLootNear(Position center, double radius) const
+    {
+        const InterestGrid& grid = GetLootGrid();
+        const InterestGrid::Cell center_cell = grid.GetCell(center.x, center.y);
+        const double radius2 = radius * radius;
+
+        std::vector<size_t> result;
+        for (std::int64_t dy = -1; dy <= 1; ++dy)
+        {
+            for (std::int64_t dx = -1; dx <= 1; ++dx)
+            {
+                grid.ForEachInCell({ center_cell.x + dx, center_cell.y + dy }, [&](size_t index)
+                {
+                    const double ox = loot_x_[index] - center.x;
+                    const double oy = loot_y_[index] - center.y;
+                    if (ox * ox + oy * oy <= radius2)
+                    {
+                        result.push_back(index);
+                    }
+                });
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    std::vector<size_t> GameSession::FindLootAroundCell(InterestGrid::Cell cell) const
+    {
+        const InterestGrid& grid = GetLootGrid();
+        std::vector<size_t> result;
+        for (std::int64_t dy = -1; dy <= 1; ++dy)
+        {
+            for (std::int64_t dx = -1; dx <= 1; ++dx)
+            {
+                grid.ForEachInCell({ cell.x + dx, cell.y + dy }, [&](size_t index)
+                {
+                    result.push_back(index);
+                });
+            }
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    std::optional<std::vector<Dog::Id>> GameSession::GetChangesSince(Version since) const
+    {
+        if (since > version_ || since < history_start_)
+        {
+            return std::nullopt;
+        }
+        const Version stored = std::min<Version>(version_, history_.size());
+        if (version_ - since > stored)
+        {
+            return std::nullopt;
+        }
+
+        std::vector<Dog::Id> result;
+        for (Version v = since + 1; v <= version_; ++v)
+        {
+            const auto& dogs = history_[v % history_.size()].dogs;
+            result.insert(result.end(), dogs.begin(), dogs.end());
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
     void Game::AddMap(Map map)
     {
         const size_t index = maps_.size();
@@ -47,4 +613,41 @@ namespace model
             }
         }
     }
+
+    GameSession* Game::GetSession(const Map::Id& id)
+    {
+        if (auto it = map_id_to_session_.find(id); it != map_id_to_session_.end())
+        {
+            return &sessions_[it->second];
+        }
+        const Map* map = FindMap(id);
+        if (!map)
+        {
+            return nullptr;
+        }
+        // С заданным зерном сеансы получают разные, но воспроизводимые последовательности
+        const std::uint64_t seed = random_seed_ ? *random_seed_ + sessions_.size()
+                                                : std::uint64_t{ std::random_device{}() } << 32 | std::random_device{}();
+        GameSession& session = sessions_.emplace_back(*map, state_history_depth_, loot_config_, seed);
+        session.SetViewRadius(view_radius_);
+        session.SetRetirementTime(dog_retirement_time_);
+        try
+        {
+            map_id_to_session_.emplace(id, sessions_.size() - 1);
+        }
+        catch (...)
+        {
+            sessions_.pop_back();
+            throw;
+        }
+        return &sessions_.back();
+    }
+
+    void Game::Tick(double dt)
+    {
+        for (GameSession& session : sessions_)
+        {
+            session.Tick(dt);
+        }
+    }
 }  // namespace model
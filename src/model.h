@@ -1,8 +1,16 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <random>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "dog_movement.h"
+#include "interest_grid.h"
+#include "loot_generator.h"
 #include "tagged.h"
 
 namespace model
@@ -32,6 +40,22 @@ namespace model
         Dimension dx, dy;
     };
 
+    // Координаты и скорость собак вещественные, в отличие от координат объектов карты
+    struct Position
+    {
+        double x, y;
+    };
+
+    struct Velocity
+    {
+        double x, y;
+    };
+
+    enum class Direction
+    {
+        NORTH, SOUTH, WEST, EAST
+    };
+
     class Road
     {
         struct HorizontalTag
@@ -47,6 +71,8 @@ namespace model
     public:
         constexpr static HorizontalTag HORIZONTAL{};
         constexpr static VerticalTag VERTICAL{};
+        // Половина ширины дороги: собака может отклоняться от оси дороги на это расстояние
+        constexpr static double HALF_WIDTH = 0.4;
 
         Road(HorizontalTag, Point start, Coord end_x) noexcept
             : start_{ start }
@@ -78,6 +104,8 @@ namespace model
             return end_;
         }
 
+        movement::RoadBounds GetBounds() const noexcept;
+
     private:
         Point start_;
         Point end_;
@@ -131,6 +159,13 @@ namespace model
         Offset offset_;
     };
 
+    // Тип трофея. Описание для клиента хранится в исходном виде JSON и модели не интерпретируется
+    struct LootType
+    {
+        std::string description;
+        int value = 0;
+    };
+
     class Map
     {
     public:
@@ -138,6 +173,7 @@ namespace model
         using Roads = std::vector<Road>;
         using Buildings = std::vector<Building>;
         using Offices = std::vector<Office>;
+        using LootTypes = std::vector<LootType>;
 
         Map(Id id, std::string name) noexcept
             : id_(std::move(id))
@@ -181,6 +217,36 @@ namespace model
 
         void AddOffice(Office office);
 
+        double GetDogSpeed() const noexcept
+        {
+            return dog_speed_;
+        }
+
+        void SetDogSpeed(double speed) noexcept
+        {
+            dog_speed_ = speed;
+        }
+
+        const LootTypes& GetLootTypes() const noexcept
+        {
+            return loot_types_;
+        }
+
+        void AddLootType(LootType loot_type)
+        {
+            loot_types_.emplace_back(std::move(loot_type));
+        }
+
+        size_t GetBagCapacity() const noexcept
+        {
+            return bag_capacity_;
+        }
+
+        void SetBagCapacity(size_t capacity) noexcept
+        {
+            bag_capacity_ = capacity;
+        }
+
     private:
         using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
 
@@ -191,6 +257,334 @@ namespace model
 
         OfficeIdToIndex warehouse_id_to_index_;
         Offices offices_;
+
+        double dog_speed_ = 1.0;
+        LootTypes loot_types_;
+        size_t bag_capacity_ = 3;
+    };
+
+    // Трофей, лежащий на карте
+    struct LostObject
+    {
+        using Id = util::Tagged<std::uint32_t, LostObject>;
+
+        Id id;
+        size_t type;
+        Position position;
+    };
+
+    // Трофей в рюкзаке собаки
+    struct FoundObject
+    {
+        LostObject::Id id;
+        size_t type;
+    };
+
+    class Dog
+    {
+    public:
+        using Id = util::Tagged<std::uint32_t, Dog>;
+        using Bag = std::vector<FoundObject>;
+
+        Dog(Id id, std::string name, size_t index) noexcept
+            : id_{ id }
+            , name_{ std::move(name) }
+            , index_{ index }
+        {}
+
+        const Id& GetId() const noexcept
+        {
+            return id_;
+        }
+
+        const std::string& GetName() const noexcept
+        {
+            return name_;
+        }
+
+        Direction GetDirection() const noexcept
+        {
+            return direction_;
+        }
+
+        void SetDirection(Direction direction) noexcept
+        {
+            direction_ = direction;
+        }
+
+        // Индекс кинематического состояния собаки в movement::DogsState игрового сеанса
+        size_t GetIndex() const noexcept
+        {
+            return index_;
+        }
+
+        const Bag& GetBag() const noexcept
+        {
+            return bag_;
+        }
+
+        void PutToBag(FoundObject object)
+        {
+            bag_.push_back(object);
+        }
+
+        // Сдаёт содержимое рюкзака на базу, начисляя очки за каждый трофей
+        void DeliverBag(const Map::LootTypes& loot_types) noexcept
+        {
+            for (const FoundObject& object : bag_)
+            {
+                score_ += loot_types[object.type].value;
+            }
+            bag_.clear();
+        }
+
+        int GetScore() const noexcept
+        {
+            return score_;
+        }
+
+        void SetScore(int score) noexcept
+        {
+            score_ = score;
+        }
+
+        // Время с момента входа в игру
+        std::chrono::milliseconds GetPlayTime() const noexcept
+        {
+            return play_time_;
+        }
+
+        // Время, которое собака непрерывно стоит на месте
+        std::chrono::milliseconds GetIdleTime() const noexcept
+        {
+            return idle_time_;
+        }
+
+        void SetTimes(std::chrono::milliseconds play_time, std::chrono::milliseconds idle_time) noexcept
+        {
+            play_time_ = play_time;
+            idle_time_ = idle_time;
+        }
+
+    private:
+        friend class GameSession;
+
+        Id id_;
+        std::string name_;
+        size_t index_;
+        Direction direction_ = Direction::NORTH;
+        Bag bag_;
+        int score_ = 0;
+        std::chrono::milliseconds play_time_{};
+        std::chrono::milliseconds idle_time_{};
+    };
+
+    struct LootGeneratorConfig
+    {
+        std::chrono::milliseconds period{ 5000 };
+        double probability = 0.5;
+    };
+
+    // Копия состояния игрового сеанса на границе тика, достаточная для его восстановления.
+    // Собаки хранятся в порядке их индексов в кинематическом состоянии
+    struct GameSessionSnapshot
+    {
+        Map::Id map_id{ std::string{} };
+        std::uint64_t version = 0;
+        std::uint64_t loot_version = 0;
+        std::uint32_t next_dog_id = 0;
+        std::uint32_t next_loot_id = 0;
+        std::vector<Dog> dogs;
+        movement::DogsState state;
+        std::vector<LostObject> loot;
+        std::mt19937_64 random;
+        std::chrono::milliseconds time_without_loot{};
+    };
+
+    // Игровой сеанс на одной карте. Положения и скорости собак хранятся
+    // в виде структуры массивов и обновляются векторизованным ядром movement::MoveDogs
+    class GameSession
+    {
+    public:
+        using Dogs = std::deque<Dog>;
+        // Номер состояния сеанса. Увеличивается на единицу каждый тик
+        using Version = std::uint64_t;
+
+        GameSession(const Map& map, size_t history_depth, const LootGeneratorConfig& loot_config, std::uint64_t seed);
+
+        // Генератор трофеев обращается к генератору случайных чисел сеанса по указателю
+        GameSession(const GameSession&) = delete;
+        GameSession& operator=(const GameSession&) = delete;
+
+        const Map& GetMap() const noexcept
+        {
+            return *map_;
+        }
+
+        const Dogs& GetDogs() const noexcept
+        {
+            return dogs_;
+        }
+
+        Dog& AddDog(std::string name);
+
+        Dog* FindDog(Dog::Id id) noexcept;
+
+        const Dog* FindDog(Dog::Id id) const noexcept;
+
+        Position GetDogPosition(const Dog& dog) const noexcept
+        {
+            return { state_.x[dog.GetIndex()], state_.y[dog.GetIndex()] };
+        }
+
+        Velocity GetDogVelocity(const Dog& dog) const noexcept
+        {
+            return { state_.vx[dog.GetIndex()], state_.vy[dog.GetIndex()] };
+        }
+
+        // Задаёт направление движения собаки со скоростью карты. std::nullopt останавливает собаку
+        void SetDogDirection(Dog& dog, std::optional<Direction> direction) noexcept;
+
+        // Перемещает всех собак сеанса на время dt (в секундах), подбирает и сдаёт трофеи,
+        // создаёт новые, отправляет на покой долго стоявших собак и записывает набор
+        // изменившихся за тик собак в историю изменений
+        void Tick(double dt);
+
+        // Время бездействия, после которого собака покидает игру. 0 - собаки не покидают игру
+        void SetRetirementTime(std::chrono::milliseconds time) noexcept
+        {
+            retirement_time_ = time;
+        }
+
+        // Собаки, покинувшие игру в последнем тике. Их идентификаторы попадают в набор изменений тика
+        const std::vector<Dog>& GetRetiredDogs() const noexcept
+        {
+            return retired_;
+        }
+
+        size_t GetLootCount() const noexcept
+        {
+            return loot_ids_.size();
+        }
+
+        LostObject GetLostObject(size_t index) const noexcept
+        {
+            return { loot_ids_[index], loot_types_[index], { loot_x_[index], loot_y_[index] } };
+        }
+
+        // Копирует состояние сеанса в snapshot, переиспользуя уже выделенную в нём память
+        void CaptureSnapshot(GameSessionSnapshot& snapshot) const;
+
+        // Восстанавливает состояние сеанса. История изменений начинается заново:
+        // клиенты с более ранними версиями получат полный снимок. Снимок с типом трофея,
+        // которого нет на карте, отклоняется исключением
+        void Restore(const GameSessionSnapshot& snapshot);
+
+        // Версия, в которой последний раз изменился набор трофеев на карте
+        Version GetLootVersion() const noexcept
+        {
+            return loot_version_;
+        }
+
+        Version GetVersion() const noexcept
+        {
+            return version_;
+        }
+
+        // Возвращает упорядоченные по возрастанию идентификаторы собак, изменившихся
+        // в версиях (since, GetVersion()]. std::nullopt, если история уже не хранит
+        // все эти версии и клиенту нужен полный снимок
+        std::optional<std::vector<Dog::Id>> GetChangesSince(Version since) const;
+
+        // Радиус области интереса игрока. 0 - игрок видит всех собак карты
+        void SetViewRadius(double radius) noexcept
+        {
+            view_radius_ = radius;
+            grid_dirty_ = true;
+            loot_grid_dirty_ = true;
+        }
+
+        double GetViewRadius() const noexcept
+        {
+            return view_radius_;
+        }
+
+        // Упорядоченные по возрастанию идентификаторы собак, находящихся не дальше radius от center.
+        // radius не должен превышать радиус области интереса
+        std::vector<Dog::Id> FindDogsNear(Position center, double radius) const;
+
+        // Ячейка сетки интереса (со стороной, равной радиусу области интереса), в которой находится собака
+        InterestGrid::Cell GetInterestCell(const Dog& dog) const;
+
+        // Упорядоченные по возрастанию идентификаторы собак в ячейке cell и восьми соседних с ней.
+        // Этот квадрат покрывает круг радиуса обзора вокруг любой точки ячейки
+        std::vector<Dog::Id> FindDogsAroundCell(InterestGrid::Cell cell) const;
+
+        // Упорядоченные по возрастанию индексы трофеев не дальше radius от center
+        std::vector<size_t> FindLootNear(Position center, double radius) const;
+
+        // Упорядоченные по возрастанию индексы трофеев в ячейке cell и восьми соседних с ней
+        std::vector<size_t> FindLootAroundCell(InterestGrid::Cell cell) const;
+
+    private:
+        using DogIdToIndex = std::unordered_map<Dog::Id, size_t, util::TaggedHasher<Dog::Id>>;
+
+        struct ChangeSet
+        {
+            Version version = 0;
+            std::vector<Dog::Id> dogs;
+        };
+
+        const Map* map_;
+        Dogs dogs_;
+        DogIdToIndex dog_id_to_index_;
+        movement::DogsState state_;
+        std::uint32_t next_dog_id_ = 0;
+
+        Version version_ = 0;
+        // Версия, с которой ведётся история изменений (после восстановления из снимка)
+        Version history_start_ = 0;
+        // Кольцевой буфер наборов изменений последних тиков. Элемент версии v хранится
+        // по индексу v % history_.size()
+        std::vector<ChangeSet> history_;
+        // Собаки, изменённые между тиками (добавление, смена направления)
+        std::vector<Dog::Id> pending_changes_;
+
+        double view_radius_ = 0.0;
+        // Сетка перестраивается при первом запросе после изменения позиций собак
+        mutable InterestGrid grid_;
+        mutable bool grid_dirty_ = true;
+
+        // Трофеи на карте хранятся структурой массивов в порядке появления
+        std::vector<LostObject::Id> loot_ids_;
+        std::vector<size_t> loot_types_;
+        std::vector<double> loot_x_;
+        std::vector<double> loot_y_;
+        std::uint32_t next_loot_id_ = 0;
+        Version loot_version_ = 0;
+        mutable InterestGrid loot_grid_;
+        mutable bool loot_grid_dirty_ = true;
+
+        std::mt19937_64 random_;
+        loot_gen::LootGenerator loot_generator_;
+        // Позиции собак до перемещения в текущем тике
+        std::vector<double> prev_x_;
+        std::vector<double> prev_y_;
+
+        std::chrono::milliseconds retirement_time_{};
+        std::vector<Dog> retired_;
+
+        void MarkChanged(const Dog& dog);
+
+        void RetireIdleDogs(std::chrono::milliseconds delta, std::vector<Dog::Id>& changes);
+
+        void CollectLoot();
+
+        void GenerateLoot(double dt);
+
+        const InterestGrid& GetInterestGrid() const;
+
+        const InterestGrid& GetLootGrid() const;
     };
 
     class Game
@@ -205,6 +599,59 @@ namespace model
             return maps_;
         }
 
+        double GetDefaultDogSpeed() const noexcept
+        {
+            return default_dog_speed_;
+        }
+
+        void SetDefaultDogSpeed(double speed) noexcept
+        {
+            default_dog_speed_ = speed;
+        }
+
+        // Количество тиков, для которых игровые сеансы хранят наборы изменений
+        void SetStateHistoryDepth(size_t depth) noexcept
+        {
+            state_history_depth_ = depth;
+        }
+
+        void SetViewRadius(double radius) noexcept
+        {
+            view_radius_ = radius;
+        }
+
+        // Время бездействия, после которого собака покидает игру. 0 - собаки не покидают игру
+        void SetDogRetirementTime(std::chrono::milliseconds time) noexcept
+        {
+            dog_retirement_time_ = time;
+        }
+
+        const LootGeneratorConfig& GetLootGeneratorConfig() const noexcept
+        {
+            return loot_config_;
+        }
+
+        void SetLootGeneratorConfig(const LootGeneratorConfig& config) noexcept
+        {
+            loot_config_ = config;
+        }
+
+        // Зерно генераторов случайных чисел сеансов. Без него сеансы засеваются std::random_device
+        void SetRandomSeed(std::optional<std::uint64_t> seed) noexcept
+        {
+            random_seed_ = seed;
+        }
+
+        // Возвращает игровой сеанс карты, создавая его при первом обращении
+        GameSession* GetSession(const Map::Id& id);
+
+        const std::deque<GameSession>& GetSessions() const noexcept
+        {
+            return sessions_;
+        }
+
+        void Tick(double dt);
+
         const Map* FindMap(const Map::Id& id) const noexcept
         {
             if (auto it = map_id_to_index_.find(id); it != map_id_to_index_.end())
@@ -220,5 +667,15 @@ namespace model
 
         std::vector<Map> maps_;
         MapIdToIndex map_id_to_index_;
+        double default_dog_speed_ = 1.0;
+        size_t state_history_depth_ = 64;
+        double view_radius_ = 0.0;
+        std::chrono::milliseconds dog_retirement_time_{ 60'000 };
+        LootGeneratorConfig loot_config_;
+        std::optional<std::uint64_t> random_seed_;
+
+        // deque не перемещает элементы при добавлении, поэтому указатели на сеансы остаются валидными
+        std::deque<GameSession> sessions_;
+        MapIdToIndex map_id_to_session_;
     };
 }  // namespace model
@@ -0,0 +1,110 @@
+// Микробенчмарк ядра перемещения собак.
+// Запуск: movement_bench [количество-собак] [количество-тиков]
+#include "dog_movement.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+using namespace std::literals;
+
+namespace
+{
+    constexpr double TICK_SECONDS = 0.05;
+
+    movement::DogsState MakeDogs(size_t count)
+    {
+        std::mt19937_64 rng{ 42 };
+        std::uniform_real_distribution<double> coord{ 0.0, 1000.0 };
+        std::uniform_real_distribution<double> length{ 1.0, 50.0 };
+        std::uniform_int_distribution<int> direction{ 0, 3 };
+
+        movement::DogsState state;
+        state.Reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double x0 = coord(rng);
+            const double y0 = coord(rng);
+            const bool horizontal = i % 2 == 0;
+            const double x1 = horizontal ? x0 + length(rng) : x0;
+            const double y1 = horizontal ? y0 : y0 + length(rng);
+            const movement::RoadBounds bounds{ x0 - 0.4, x1 + 0.4, y0 - 0.4, y1 + 0.4 };
+
+            const size_t index = state.Add(x0, y0, bounds);
+            const double speed = 3.0;
+            switch (direction(rng))
+            {
+            case 0:
+                state.vx[index] = speed;
+                break;
+            case 1:
+                state.vx[index] = -speed;
+                break;
+            case 2:
+                state.vy[index] = speed;
+                break;
+            default:
+                state.vy[index] = -speed;
+            }
+        }
+        return state;
+    }
+
+    bool SameBits(const std::vector<double>& lhs, const std::vector<double>& rhs)
+    {
+        return lhs.size() == rhs.size()
+            && std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(double)) == 0;
+    }
+
+    bool SameState(const movement::DogsState& lhs, const movement::DogsState& rhs)
+    {
+        return SameBits(lhs.x, rhs.x) && SameBits(lhs.y, rhs.y)
+            && SameBits(lhs.vx, rhs.vx) && SameBits(lhs.vy, rhs.vy);
+    }
+}  // namespace
+
+int main(int argc, const char* argv[])
+{
+    const size_t dogs = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    const size_t ticks = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200;
+
+    const movement::DogsState initial = MakeDogs(dogs);
+
+    movement::DogsState reference = initial;
+    for (size_t t = 0; t < ticks; ++t)
+    {
+        movement::MoveDogs(reference, TICK_SECONDS, movement::Kernel::SCALAR);
+    }
+
+    std::cout << "detected="sv << movement::KernelName(movement::DetectKernel()) << std::endl;
+    bool all_match = true;
+    for (auto kernel : { movement::Kernel::SCALAR, movement::Kernel::SSE2, movement::Kernel::AVX2 })
+    {
+        if (!movement::IsKernelSupported(kernel))
+        {
+            std::cout << "kernel="sv << movement::KernelName(kernel) << " unsupported"sv << std::endl;
+            continue;
+        }
+
+        movement::DogsState state = initial;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < ticks; ++t)
+        {
+            movement::MoveDogs(state, TICK_SECONDS, kernel);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        const bool match = SameState(state, reference);
+        all_match = all_match && match;
+        const double ns_per_dog = elapsed.count() / static_cast<double>(dogs * ticks);
+        std::cout << "kernel="sv << movement::KernelName(kernel)
+            << " dogs="sv << dogs
+            << " ticks="sv << ticks
+            << " ms_per_tick="sv << elapsed.count() / 1e6 / static_cast<double>(ticks)
+            << " ns_per_dog="sv << ns_per_dog
+            << " match="sv << (match ? "yes"sv : "no"sv) << std::endl;
+    }
+    return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
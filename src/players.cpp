@@ -0,0 +1,79 @@
+#include "players.h"
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace app
+{
+    Token Players::GenerateToken()
+    {
+        std::ostringstream out;
+        out << std::hex << std::setfill('0')
+            << std::setw(16) << generator1_()
+            << std::setw(16) << generator2_();
+        return Token{ out.str() };
+    }
+
+    Player& Players::Add(model::GameSession& session, const model::Dog& dog)
+    {
+        Token token = GenerateToken();
+        while (token_to_player_.contains(token))
+        {
+            token = GenerateToken();
+        }
+        return Add(std::move(token), session, dog.GetId());
+    }
+
+    Player& Players::Add(Token token, model::GameSession& session, model::Dog::Id dog_id)
+    {
+        if (token_to_player_.contains(token))
+        {
+            throw std::invalid_argument("Duplicate player token");
+        }
+
+        const size_t index = players_.size();
+        Player& player = players_.emplace_back(std::move(token), session, dog_id);
+        try
+        {
+            token_to_player_.emplace(player.GetToken(), index);
+            dog_to_player_.emplace(DogKey{ &session, dog_id }, index);
+        }
+        catch (...)
+        {
+            token_to_player_.erase(player.GetToken());
+            players_.pop_back();
+            throw;
+        }
+        return player;
+    }
+
+    Player* Players::FindByToken(const Token& token) noexcept
+    {
+        if (auto it = token_to_player_.find(token); it != token_to_player_.end())
+        {
+            return &players_[it->second];
+        }
+        return nullptr;
+    }
+
+    void Players::RemoveByDog(const model::GameSession& session, model::Dog::Id dog_id)
+    {
+        auto it = dog_to_player_.find(DogKey{ &session, dog_id });
+        if (it == dog_to_player_.end())
+        {
+            return;
+        }
+        const size_t index = it->second;
+        dog_to_player_.erase(it);
+        token_to_player_.erase(players_[index].GetToken());
+
+        if (index != players_.size() - 1)
+        {
+            Player& moved = players_[index] = std::move(players_.back());
+            token_to_player_[moved.GetToken()] = index;
+            dog_to_player_[DogKey{ &moved.GetSession(), moved.GetId() }] = index;
+        }
+        players_.pop_back();
+    }
+}  // namespace app
@@ -0,0 +1,127 @@
+#pragma once
+#include <deque>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "model.h"
+#include "tagged.h"
+
+namespace app
+{
+    namespace detail
+    {
+        struct TokenTag {};
+    }  // namespace detail
+
+    // Токен авторизации игрока: 32 шестнадцатеричные цифры
+    using Token = util::Tagged<std::string, detail::TokenTag>;
+
+    class Player
+    {
+    public:
+        Player(Token token, model::GameSession& session, model::Dog::Id dog_id) noexcept
+            : token_{ std::move(token) }
+            , session_{ &session }
+            , dog_id_{ dog_id }
+        {}
+
+        const Token& GetToken() const noexcept
+        {
+            return token_;
+        }
+
+        model::GameSession& GetSession() const noexcept
+        {
+            return *session_;
+        }
+
+        model::Dog::Id GetId() const noexcept
+        {
+            return dog_id_;
+        }
+
+        // Собаки в радиусе обзора, переданные игроку в ответе с версией version, или nullptr,
+        // если последний такой ответ был с другой версией
+        const std::vector<model::Dog::Id>* GetVisibleDogs(model::GameSession::Version version) const noexcept
+        {
+            return visible_version_ == version ? &visible_dogs_ : nullptr;
+        }
+
+        void SetVisibleDogs(model::GameSession::Version version, std::vector<model::Dog::Id> dogs)
+        {
+            visible_version_ = version;
+            visible_dogs_ = std::move(dogs);
+        }
+
+    private:
+        Token token_;
+        model::GameSession* session_;
+        model::Dog::Id dog_id_;
+        std::optional<model::GameSession::Version> visible_version_;
+        std::vector<model::Dog::Id> visible_dogs_;
+    };
+
+    class Players
+    {
+    public:
+        using Container = std::deque<Player>;
+
+        Player& Add(model::GameSession& session, const model::Dog& dog);
+
+        // Добавляет игрока с известным токеном, например при восстановлении из снимка
+        Player& Add(Token token, model::GameSession& session, model::Dog::Id dog_id);
+
+        Player* FindByToken(const Token& token) noexcept;
+
+        // Удаляет игрока, управлявшего собакой dog_id сеанса session. На место удалённого
+        // переносится последний игрок, поэтому указатели на игроков после вызова недействительны
+        void RemoveByDog(const model::GameSession& session, model::Dog::Id dog_id);
+
+        const Container& GetPlayers() const noexcept
+        {
+            return players_;
+        }
+
+    private:
+        struct DogKey
+        {
+            const model::GameSession* session;
+            model::Dog::Id dog_id;
+
+            bool operator==(const DogKey&) const = default;
+        };
+
+        struct DogKeyHasher
+        {
+            size_t operator()(const DogKey& key) const noexcept
+            {
+                return std::hash<const void*>{}(key.session) * 37 + std::hash<std::uint32_t>{}(*key.dog_id);
+            }
+        };
+
+        // Игроки адресуются индексами в players_
+        using TokenToPlayer = std::unordered_map<Token, size_t, util::TaggedHasher<Token>>;
+        using DogToPlayer = std::unordered_map<DogKey, size_t, DogKeyHasher>;
+
+        Container players_;
+        TokenToPlayer token_to_player_;
+        DogToPlayer dog_to_player_;
+
+        std::random_device random_device_;
+        std::mt19937_64 generator1_{ [this]
+        {
+            std::uniform_int_distribution<std::mt19937_64::result_type> dist;
+            return dist(random_device_);
+        }() };
+        std::mt19937_64 generator2_{ [this]
+        {
+            std::uniform_int_distribution<std::mt19937_64::result_type> dist;
+            return dist(random_device_);
+        }() };
+
+        Token GenerateToken();
+    };
+}  // namespace app
@@ -0,0 +1,236 @@
+#include "rate_limit.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace rate_limit
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        // Соседние записи, среди которых ищется корзина клиента: обычно это одна-две строки кеша
+        constexpr std::size_t PROBES = 8;
+        // Запись, которую удаляет Evict. Запрос к такой корзине пропускается: она всё равно полна
+        constexpr std::uint64_t EVICTING = std::numeric_limits<std::uint64_t>::max();
+        constexpr std::uint64_t NS_PER_SECOND = 1'000'000'000;
+        constexpr std::size_t MAX_RETRY_AFTER = 60;
+
+        std::uint64_t Mix(std::uint64_t value) noexcept
+        {
+            // Финализатор splitmix64
+            value ^= value >> 30;
+            value *= 0xbf58476d1ce4e5b9ull;
+            value ^= value >> 27;
+            value *= 0x94d049bb133111ebull;
+            return value ^ (value >> 31);
+        }
+
+        std::string MakeRejection(std::size_t retry_after)
+        {
+            const std::string body = R"({"code": "tooManyRequests", "message": "Request rate limit exceeded"})"s;
+            return "HTTP/1.1 429 Too Many Requests\r\n"s
+                + "Content-Type: application/json\r\n"s
+                + "Cache-Control: no-cache\r\n"s
+                + "Retry-After: "s + std::to_string(retry_after) + "\r\n"s
+                + "Content-Length: "s + std::to_string(body.size()) + "\r\n\r\n"s
+                + body;
+        }
+
+        double ParseNumber(std::string_view text, std::string_view spec)
+        {
+            // std::from_chars для double есть не во всех стандартных библиотеках
+            const std::string value{ text };
+            std::size_t end = 0;
+            double number = 0.0;
+            try
+            {
+                number = std::stod(value, &end);
+            }
+            catch (const std::exception&)
+            {
+                end = 0;
+            }
+            if (value.empty() || end != value.size() || !std::isfinite(number) || number < 0.0)
+            {
+                throw std::invalid_argument("Invalid rate limit "s + std::string{ spec });
+            }
+            return number;
+        }
+    }  // namespace
+
+    std::array<Rate, CLASS_COUNT> ParseRates(std::string_view spec)
+    {
+        std::array<Rate, CLASS_COUNT> rates{};
+        std::string_view rest = spec;
+        while (!rest.empty())
+        {
+            const std::size_t comma = rest.find(',');
+            const std::string_view item = rest.substr(0, comma);
+            rest = comma == std::string_view::npos ? ""sv : rest.substr(comma + 1);
+            const std::size_t equals = item.find('=');
+            if (equals == std::string_view::npos)
+            {
+                throw std::invalid_argument("Invalid rate limit "s + std::string{ spec });
+            }
+            const std::string_view name = item.substr(0, equals);
+            std::size_t index = 0;
+            while (index < CLASS_COUNT && metrics::PriorityName(static_cast<metrics::Priority>(index)) != name)
+            {
+                ++index;
+            }
+            if (index == CLASS_COUNT)
+            {
+                throw std::invalid_argument("Unknown request class "s + std::string{ name });
+            }
+            const std::string_view value = item.substr(equals + 1);
+            const std::size_t colon = value.find(':');
+            rates[index].per_second = ParseNumber(value.substr(0, colon), spec);
+            rates[index].burst = colon == std::string_view::npos ? 0.0 : ParseNumber(value.substr(colon + 1), spec);
+        }
+        return rates;
+    }
+
+    Limiter::Limiter(const Settings& settings)
+        : classify_{ settings.classify }
+        , start_{ Clock::now() }
+        , mask_{ std::bit_ceil(std::max<std::size_t>(settings.capacity, PROBES)) - 1 }
+        , entries_{ std::make_unique<Entry[]>(mask_ + 1) }
+    {
+        for (std::size_t i = 0; i < CLASS_COUNT; ++i)
+        {
+            const Rate& rate = settings.rates[i];
+            if (rate.per_second <= 0.0)
+            {
+                continue;
+            }
+            const double burst = rate.burst > 0.0 ? rate.burst : std::max(rate.per_second, 1.0);
+            buckets_[i].interval = std::max<std::uint64_t>(1,
+                static_cast<std::uint64_t>(static_cast<double>(NS_PER_SECOND) / rate.per_second));
+            buckets_[i].capacity = static_cast<std::uint64_t>(static_cast<double>(buckets_[i].interval) * burst);
+        }
+        for (std::size_t seconds = 1; seconds <= MAX_RETRY_AFTER; ++seconds)
+        {
+            rejections_.push_back(MakeRejection(seconds));
+        }
+    }
+
+    std::uint64_t Limiter::ClientKey(const net::ip::address& address) noexcept
+    {
+        if (address.is_v4())
+        {
+            return Mix(address.to_v4().to_uint());
+        }
+        const net::ip::address_v6 v6 = address.to_v6();
+        if (v6.is_v4_mapped())
+        {
+            return Mix(net::ip::make_address_v4(net::ip::v4_mapped, v6).to_uint());
+        }
+        const auto bytes = v6.to_bytes();
+        std::uint64_t high = 0;
+        std::uint64_t low = 0;
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            high = (high << 8) | bytes[i];
+            low = (low << 8) | bytes[i + 8];
+        }
+        return Mix(Mix(high) ^ low);
+    }
+
+    std::string_view Limiter::Acquire(std::uint64_t client, std::string_view target, Clock::time_point now) noexcept
+    {
+        const metrics::Priority priority = classify_(target);
+        const std::size_t index = std::min(static_cast<std::size_t>(priority), CLASS_COUNT - 1);
+        const Bucket& bucket = buckets_[index];
+        if (bucket.interval == 0)
+        {
+            return {};
+        }
+        // Младший бит отличает занятый ключ от пустой записи
+        const std::uint64_t key = Mix(client + index + 1) | 1;
+        Entry* entry = Find(key);
+        if (!entry)
+        {
+            metrics::CountRateLimitMiss();
+            return {};
+        }
+        const auto elapsed = static_cast<std::uint64_t>(std::max<std::int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count(), 0));
+        std::uint64_t full_at = entry->full_at.load(std::memory_order_relaxed);
+        std::uint64_t next = 0;
+        do
+        {
+            if (full_at == EVICTING)
+            {
+                return {};
+            }
+            // Каждый запрос сдвигает момент заполнения корзины на интервал маркера
+            next = std::max(full_at, elapsed) + bucket.interval;
+            if (next - elapsed > bucket.capacity)
+            {
+                metrics::CountRateLimited(priority);
+                const std::uint64_t wait = next - elapsed - bucket.capacity;
+                const std::size_t seconds = std::clamp<std::size_t>((wait + NS_PER_SECOND - 1) / NS_PER_SECOND, 1,
+                    MAX_RETRY_AFTER);
+                return rejections_[seconds - 1];
+            }
+        } while (!entry->full_at.compare_exchange_weak(full_at, next, std::memory_order_relaxed));
+        return {};
+    }
+
+    Limiter::Entry* Limiter::Find(std::uint64_t key) noexcept
+    {
+        const std::size_t start = static_cast<std::size_t>(key >> 1);
+        // Сначала ищется существующая корзина: Evict освобождает ячейки посреди цепочки проб,
+        // и занятая раньше времени пустая ячейка выдала бы клиенту новую, полную маркеров корзину
+        for (std::size_t i = 0; i < PROBES; ++i)
+        {
+            Entry& entry = entries_[(start + i) & mask_];
+            if (entry.key.load(std::memory_order_acquire) == key)
+            {
+                return &entry;
+            }
+        }
+        for (std::size_t i = 0; i < PROBES; ++i)
+        {
+            Entry& entry = entries_[(start + i) & mask_];
+            std::uint64_t current = entry.key.load(std::memory_order_acquire);
+            // При неудаче current получает ключ, занявший ячейку: им может оказаться тот же клиент
+            if ((current == 0 && entry.key.compare_exchange_strong(current, key, std::memory_order_acq_rel))
+                || current == key)
+            {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    std::size_t Limiter::Evict(Clock::time_point now) noexcept
+    {
+        const auto elapsed = static_cast<std::uint64_t>(std::max<std::int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count(), 0));
+        std::size_t evicted = 0;
+        for (std::size_t i = 0; i <= mask_; ++i)
+        {
+            Entry& entry = entries_[i];
+            if (entry.key.load(std::memory_order_relaxed) == 0)
+            {
+                continue;
+            }
+            std::uint64_t full_at = entry.full_at.load(std::memory_order_relaxed);
+            if (full_at == EVICTING || full_at > elapsed
+                || !entry.full_at.compare_exchange_strong(full_at, EVICTING, std::memory_order_acq_rel))
+            {
+                continue;
+            }
+            // Ключ освобождается раньше сброса срока: запрос, успевший найти старый ключ, видит EVICTING
+            entry.key.store(0, std::memory_order_release);
+            entry.full_at.store(0, std::memory_order_release);
+            ++evicted;
+        }
+        return evicted;
+    }
+}  // namespace rate_limit
@@ -0,0 +1,95 @@
+#pragma once
+#include <boost/asio/ip/address.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "metrics.h"
+
+namespace rate_limit
+{
+    namespace net = boost::asio;
+
+    constexpr std::size_t CLASS_COUNT = static_cast<std::size_t>(metrics::Priority::COUNT);
+
+    // Ограничение запросов одного клиента в одном классе. per_second == 0 - без ограничения
+    struct Rate
+    {
+        double per_second = 0.0;
+        // Запросы, которые можно выполнить подряд после простоя. 0 - per_second
+        double burst = 0.0;
+    };
+
+    // Класс запроса по его цели
+    using Classifier = metrics::Priority (*)(std::string_view target) noexcept;
+
+    struct Settings
+    {
+        std::array<Rate, CLASS_COUNT> rates{};
+        Classifier classify = nullptr;
+        // Число записей таблицы, округляется вверх до степени двойки
+        std::size_t capacity = 65536;
+    };
+
+    // Разбирает ограничения вида "game=20,static=100:200" (запросов в секунду и, через двоеточие, burst).
+    // Выбрасывает std::invalid_argument
+    std::array<Rate, CLASS_COUNT> ParseRates(std::string_view spec);
+
+    // Ограничение частоты запросов с одного IP-адреса, отдельно по классам запросов (token bucket).
+    // Корзины хранятся в хеш-таблице фиксированного размера с открытой адресацией. Запись - ключ (адрес и класс)
+    // и одно 64-битное значение: момент, когда корзина снова будет полна (GCRA). Проверка запроса - чтение ключей
+    // нескольких соседних записей и одно compare-and-swap, без блокировок и выделений памяти.
+    // Если для клиента нет места среди соседних записей, запрос пропускается.
+    // Записи полных корзин удаляет Evict, вызываемый в фоне
+    class Limiter
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit Limiter(const Settings& settings);
+
+        Limiter(const Limiter&) = delete;
+        Limiter& operator=(const Limiter&) = delete;
+
+        // Ключ клиента, вычисляется один раз на соединение
+        static std::uint64_t ClientKey(const net::ip::address& address) noexcept;
+
+        // Забирает из корзины клиента маркер для запроса к target. Если корзина пуста, возвращает ответ 429
+        // с Retry-After, иначе пустую строку
+        std::string_view Acquire(std::uint64_t client, std::string_view target, Clock::time_point now) noexcept;
+
+        // Удаляет записи корзин, полных к моменту now. Возвращает число удалённых записей
+        std::size_t Evict(Clock::time_point now) noexcept;
+
+    private:
+        struct Entry
+        {
+            std::atomic<std::uint64_t> key{ 0 };
+            // Момент (в наносекундах от start_), когда корзина снова будет полна. 0 - корзина полна
+            std::atomic<std::uint64_t> full_at{ 0 };
+        };
+
+        struct Bucket
+        {
+            // Интервал между маркерами и запас маркеров корзины в наносекундах
+            std::uint64_t interval = 0;
+            std::uint64_t capacity = 0;
+        };
+
+        Classifier classify_;
+        std::array<Bucket, CLASS_COUNT> buckets_{};
+        Clock::time_point start_;
+        std::size_t mask_;
+        std::unique_ptr<Entry[]> entries_;
+        // Ответы 429 с Retry-After от 1 до MAX_RETRY_AFTER секунд
+        std::vector<std::string> rejections_;
+
+        Entry* Find(std::uint64_t key) noexcept;
+    };
+}  // namespace rate_limit
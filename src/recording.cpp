@@ -0,0 +1,224 @@
+#include "recording.h"
+
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+#include "binary_io.h"
+
+namespace serialization
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        constexpr std::string_view MAGIC = "GREP"sv;
+        constexpr std::uint32_t FORMAT_VERSION = 1;
+
+        enum class EntryType : std::uint8_t
+        {
+            JOIN = 1,
+            MOVE = 2,
+            TICK = 3
+        };
+
+        // Код направления в записи MOVE, означающий остановку собаки
+        constexpr std::uint8_t STOP = 0xFF;
+
+        template <typename T>
+        std::uint64_t HashPod(T value, std::uint64_t hash) noexcept
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            return Fnv1a({ reinterpret_cast<const char*>(&value), sizeof(value) }, hash);
+        }
+    }  // namespace
+
+    std::uint64_t HashGameState(const model::Game& game)
+    {
+        std::uint64_t hash = FNV1A_OFFSET;
+        for (const model::GameSession& session : game.GetSessions())
+        {
+            hash = Fnv1a(*session.GetMap().GetId(), hash);
+            hash = HashPod(session.GetVersion(), hash);
+            hash = HashPod(session.GetDogs().size(), hash);
+            for (const model::Dog& dog : session.GetDogs())
+            {
+                const model::Position position = session.GetDogPosition(dog);
+                const model::Velocity velocity = session.GetDogVelocity(dog);
+                hash = HashPod(*dog.GetId(), hash);
+                hash = HashPod(position.x, hash);
+                hash = HashPod(position.y, hash);
+                hash = HashPod(velocity.x, hash);
+                hash = HashPod(velocity.y, hash);
+                hash = HashPod(dog.GetDirection(), hash);
+                hash = HashPod(dog.GetScore(), hash);
+                hash = HashPod(dog.GetIdleTime().count(), hash);
+                for (const model::FoundObject& object : dog.GetBag())
+                {
+                    hash = HashPod(*object.id, hash);
+                }
+            }
+            hash = HashPod(session.GetLootCount(), hash);
+            for (size_t i = 0; i < session.GetLootCount(); ++i)
+            {
+                const model::LostObject object = session.GetLostObject(i);
+                hash = HashPod(*object.id, hash);
+                hash = HashPod(object.type, hash);
+                hash = HashPod(object.position.x, hash);
+                hash = HashPod(object.position.y, hash);
+            }
+        }
+        return hash;
+    }
+
+    std::uint64_t HashConfigFile(const std::filesystem::path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+        const std::string data{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+        return Fnv1a(data);
+    }
+
+    Recorder::Recorder(const std::filesystem::path& path, const app::Application& application, std::uint64_t seed,
+        std::uint64_t config_hash)
+        : application_{ application }
+        , out_{ path, std::ios::binary | std::ios::trunc }
+    {
+        if (!out_)
+        {
+            throw std::runtime_error("Failed to create " + path.string());
+        }
+        record_.assign(MAGIC);
+        BinaryWriter writer{ record_ };
+        writer.Pod(FORMAT_VERSION);
+        writer.Pod(seed);
+        writer.Pod(config_hash);
+        Write();
+    }
+
+    void Recorder::OnJoin(const app::Token& token, std::string_view user_name, const model::Map::Id& map_id)
+    {
+        record_.clear();
+        BinaryWriter writer{ record_ };
+        writer.Pod(EntryType::JOIN);
+        writer.String(*token);
+        writer.String(*map_id);
+        writer.String(user_name);
+        Write();
+    }
+
+    void Recorder::OnMove(const app::Token& token, std::optional<model::Direction> direction)
+    {
+        record_.clear();
+        BinaryWriter writer{ record_ };
+        writer.Pod(EntryType::MOVE);
+        writer.String(*token);
+        writer.Pod(direction ? static_cast<std::uint8_t>(*direction) : STOP);
+        Write();
+    }
+
+    void Recorder::OnTick(std::chrono::milliseconds delta)
+    {
+        record_.clear();
+        BinaryWriter writer{ record_ };
+        writer.Pod(EntryType::TICK);
+        writer.Pod(static_cast<std::int64_t>(delta.count()));
+        writer.Pod(HashGameState(application_.GetGame()));
+        Write();
+    }
+
+    void Recorder::Write()
+    {
+        out_.write(record_.data(), static_cast<std::streamsize>(record_.size()));
+    }
+
+    Recording::Recording(const std::filesystem::path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+        data_.assign(std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{});
+
+        constexpr size_t HEADER_SIZE = MAGIC.size() + sizeof(FORMAT_VERSION) + 2 * sizeof(std::uint64_t);
+        BinaryReader reader{ data_ };
+        if (data_.size() < HEADER_SIZE || reader.Take(MAGIC.size()) != MAGIC
+            || reader.Pod<std::uint32_t>() != FORMAT_VERSION)
+        {
+            throw std::runtime_error(path.string() + " is not a simulation recording of a supported version");
+        }
+        header_.seed = reader.Pod<std::uint64_t>();
+        header_.config_hash = reader.Pod<std::uint64_t>();
+        data_.erase(0, data_.size() - reader.Remaining());
+    }
+
+    ReplayResult Recording::Replay(app::Application& application, bool verify) const
+    {
+        ReplayResult result;
+        BinaryReader reader{ data_ };
+        while (!reader.AtEnd())
+        {
+            // Запись сначала читается целиком: обрезанная при сбое запись не применяется
+            BinaryReader entry = reader;
+            try
+            {
+                switch (entry.Pod<EntryType>())
+                {
+                case EntryType::JOIN:
+                {
+                    app::Token token{ entry.String() };
+                    const model::Map::Id map_id{ entry.String() };
+                    std::string name = entry.String();
+                    if (!application.JoinGame(std::move(name), map_id, std::move(token)))
+                    {
+                        throw std::invalid_argument("Recording refers to unknown map " + *map_id);
+                    }
+                    ++result.joins;
+                    break;
+                }
+                case EntryType::MOVE:
+                {
+                    const app::Token token{ entry.String() };
+                    const auto direction = entry.Pod<std::uint8_t>();
+                    const app::Player* player = application.FindPlayer(token);
+                    if (!player || (direction != STOP && direction > static_cast<std::uint8_t>(model::Direction::EAST)))
+                    {
+                        throw std::invalid_argument("Recording has an invalid move record");
+                    }
+                    application.MovePlayer(*player, direction == STOP
+                        ? std::nullopt
+                        : std::optional{ static_cast<model::Direction>(direction) });
+                    ++result.moves;
+                    break;
+                }
+                case EntryType::TICK:
+                {
+                    const std::chrono::milliseconds delta{ entry.Pod<std::int64_t>() };
+                    const auto hash = entry.Pod<std::uint64_t>();
+                    application.Tick(delta);
+                    ++result.ticks;
+                    if (verify && HashGameState(application.GetGame()) != hash)
+                    {
+                        result.mismatch_tick = result.ticks;
+                        return result;
+                    }
+                    break;
+                }
+                default:
+                    throw std::invalid_argument("Recording has a record of unknown type");
+                }
+            }
+            catch (const std::runtime_error&)
+            {
+                // BinaryReader сообщает о нехватке данных: запись обрезана
+                break;
+            }
+            reader = entry;
+        }
+        return result;
+    }
+}  // namespace serialization
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include "application.h"
+
+namespace serialization
+{
+    // Хеш состояния игровых сеансов: версий, собак (с побитовым учётом координат и скоростей) и трофеев.
+    // Совпадение хешей после каждого тика означает, что симуляция воспроизведена в точности
+    std::uint64_t HashGameState(const model::Game& game);
+
+    // Контрольная сумма файла конфигурации игры
+    std::uint64_t HashConfigFile(const std::filesystem::path& path);
+
+    // Записывает входные данные симуляции: зерно генератора, входы игроков, команды и длительности тиков,
+    // а после каждого тика - хеш получившегося состояния. Запись начинается с пустой игры,
+    // поэтому по ней можно повторить симуляцию без сервера. Данные буферизуются и не синхронизируются с диском
+    class Recorder : public app::ActionJournal
+    {
+    public:
+        // config_hash - контрольная сумма файла конфигурации, с которой должна выполняться повторная симуляция
+        Recorder(const std::filesystem::path& path, const app::Application& application, std::uint64_t seed,
+            std::uint64_t config_hash);
+
+        void OnJoin(const app::Token& token, std::string_view user_name, const model::Map::Id& map_id) override;
+
+        void OnMove(const app::Token& token, std::optional<model::Direction> direction) override;
+
+        void OnTick(std::chrono::milliseconds delta) override;
+
+    private:
+        const app::Application& application_;
+        std::ofstream out_;
+        std::string record_;
+
+        void Write();
+    };
+
+    struct RecordingHeader
+    {
+        std::uint64_t seed = 0;
+        std::uint64_t config_hash = 0;
+    };
+
+    struct ReplayResult
+    {
+        std::uint64_t ticks = 0;
+        std::uint64_t joins = 0;
+        std::uint64_t moves = 0;
+        // Номер первого тика, хеш состояния после которого не совпал с записанным
+        std::optional<std::uint64_t> mismatch_tick;
+    };
+
+    // Запись целиком, прочитанная в память, чтобы повторная симуляция не зависела от скорости диска
+    class Recording
+    {
+    public:
+        explicit Recording(const std::filesystem::path& path);
+
+        const RecordingHeader& GetHeader() const noexcept
+        {
+            return header_;
+        }
+
+        // Применяет записанные действия к application, игра которого загружена из той же конфигурации
+        // и засеяна записанным зерном. Если verify, после каждого тика сверяет хеш состояния и
+        // останавливается на первом расхождении. Обрезанный при сбое хвост записи игнорируется
+        ReplayResult Replay(app::Application& application, bool verify) const;
+
+    private:
+        RecordingHeader header_;
+        std::string data_;
+    };
+}  // namespace serialization
@@ -0,0 +1,431 @@
+#include "records.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+
+#include "binary_io.h"
+#include "logger.h"
+#include "state_serialization.h"
+
+namespace records
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        constexpr std::string_view MAGIC = "GREC"sv;
+        constexpr std::uint32_t FORMAT_VERSION = 1;
+        constexpr size_t FILE_HEADER_SIZE = MAGIC.size() + sizeof(FORMAT_VERSION);
+        // Заголовок записи: длина тела и контрольная сумма тела
+        constexpr size_t HEADER_SIZE = 2 * sizeof(std::uint32_t);
+        // Размер блока, которым читается файл при запуске
+        constexpr size_t READ_BLOCK_SIZE = 1 << 20;
+
+        std::uint32_t RecordChecksum(std::string_view body) noexcept
+        {
+            return static_cast<std::uint32_t>(serialization::Fnv1a(body));
+        }
+
+        void AppendRecord(std::string& out, const app::PlayerRecord& record)
+        {
+            const size_t start = out.size();
+            out.append(HEADER_SIZE, '\0');
+            serialization::BinaryWriter writer{ out };
+            writer.Pod(record.id);
+            writer.Pod(static_cast<std::int32_t>(record.score));
+            writer.Pod(static_cast<std::int64_t>(record.play_time.count()));
+            writer.String(record.name);
+
+            const std::string_view body = std::string_view{ out }.substr(start + HEADER_SIZE);
+            const auto size = static_cast<std::uint32_t>(body.size());
+            const std::uint32_t checksum = RecordChecksum(body);
+            std::memcpy(out.data() + start, &size, sizeof(size));
+            std::memcpy(out.data() + start + sizeof(size), &checksum, sizeof(checksum));
+        }
+    }  // namespace
+
+    bool Leaderboard::Less(const Node& lhs, const Node& rhs) noexcept
+    {
+        if (lhs.score != rhs.score)
+        {
+            return lhs.score > rhs.score;
+        }
+        if (lhs.play_time != rhs.play_time)
+        {
+            return lhs.play_time < rhs.play_time;
+        }
+        return lhs.id < rhs.id;
+    }
+
+    std::uint32_t Leaderboard::NextPriority() noexcept
+    {
+        // xorshift64: приоритеты должны быть лишь независимы от ключей
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 7;
+        random_ ^= random_ << 17;
+        return static_cast<std::uint32_t>(random_ >> 32);
+    }
+
+    void Leaderboard::Update(std::uint32_t node) noexcept
+    {
+        nodes_[node].size = 1 + SizeOf(nodes_[node].left) + SizeOf(nodes_[node].right);
+    }
+
+    std::uint32_t Leaderboard::UpdateSizes(std::uint32_t node) noexcept
+    {
+        if (node == NIL)
+        {
+            return 0;
+        }
+        // Глубина декартова дерева со случайными приоритетами - O(log n), рекурсия безопасна
+        nodes_[node].size = 1 + UpdateSizes(nodes_[node].left) + UpdateSizes(nodes_[node].right);
+        return nodes_[node].size;
+    }
+
+    void Leaderboard::Split(std::uint32_t node, const Node& key, std::uint32_t& left, std::uint32_t& right) noexcept
+    {
+        if (node == NIL)
+        {
+            left = right = NIL;
+            return;
+        }
+        if (Less(nodes_[node], key))
+        {
+            Split(nodes_[node].right, key, nodes_[node].right, right);
+            left = node;
+        }
+        else
+        {
+            Split(nodes_[node].left, key, left, nodes_[node].left);
+            right = node;
+        }
+        Update(node);
+    }
+
+    std::uint32_t Leaderboard::Insert(std::uint32_t node, std::uint32_t item) noexcept
+    {
+        if (node == NIL)
+        {
+            return item;
+        }
+        if (nodes_[item].priority > nodes_[node].priority)
+        {
+            Split(node, nodes_[item], nodes_[item].left, nodes_[item].right);
+            Update(item);
+            return item;
+        }
+        if (Less(nodes_[item], nodes_[node]))
+        {
+            nodes_[node].left = Insert(nodes_[node].left, item);
+        }
+        else
+        {
+            nodes_[node].right = Insert(nodes_[node].right, item);
+        }
+        Update(node);
+        return node;
+    }
+
+    std::uint32_t Leaderboard::AddNode(const app::PlayerRecord& record)
+    {
+        if (nodes_.size() >= NIL)
+        {
+            throw std::length_error("Too many records");
+        }
+        const auto index = static_cast<std::uint32_t>(nodes_.size());
+        Node& node = nodes_.emplace_back();
+        node.id = record.id;
+        node.play_time = record.play_time.count();
+        node.score = record.score;
+        node.priority = NextPriority();
+        names_.push_back(record.name);
+        return index;
+    }
+
+    void Leaderboard::Insert(const app::PlayerRecord& record)
+    {
+        root_ = Insert(root_, AddNode(record));
+    }
+
+    void Leaderboard::Assign(std::vector<app::PlayerRecord> records)
+    {
+        std::sort(records.begin(), records.end(), [](const app::PlayerRecord& lhs, const app::PlayerRecord& rhs)
+        {
+            if (lhs.score != rhs.score)
+            {
+                return lhs.score > rhs.score;
+            }
+            if (lhs.play_time != rhs.play_time)
+            {
+                return lhs.play_time < rhs.play_time;
+            }
+            return lhs.id < rhs.id;
+        });
+
+        nodes_.clear();
+        names_.clear();
+        nodes_.reserve(records.size());
+        names_.reserve(records.size());
+        root_ = NIL;
+
+        // Узлы добавляются в порядке ключей. Правая ветвь дерева хранится в стеке:
+        // новый узел забирает из неё узлы с меньшими приоритетами в своё левое поддерево
+        std::vector<std::uint32_t> right_spine;
+        for (const app::PlayerRecord& record : records)
+        {
+            const std::uint32_t item = AddNode(record);
+            std::uint32_t last = NIL;
+            while (!right_spine.empty() && nodes_[right_spine.back()].priority < nodes_[item].priority)
+            {
+                last = right_spine.back();
+                right_spine.pop_back();
+            }
+            nodes_[item].left = last;
+            if (right_spine.empty())
+            {
+                root_ = item;
+            }
+            else
+            {
+                nodes_[right_spine.back()].right = item;
+            }
+            right_spine.push_back(item);
+        }
+        UpdateSizes(root_);
+    }
+
+    std::vector<app::PlayerRecord> Leaderboard::GetPage(size_t start, size_t max_items) const
+    {
+        std::vector<app::PlayerRecord> result;
+        if (start >= nodes_.size() || max_items == 0)
+        {
+            return result;
+        }
+
+        // Спуск к узлу с позицией start. В стеке остаются предки, из которых спуск шёл влево:
+        // это следующие за текущим узлы в порядке обхода
+        std::vector<std::uint32_t> path;
+        std::uint32_t node = root_;
+        while (true)
+        {
+            const size_t left_size = SizeOf(nodes_[node].left);
+            if (start < left_size)
+            {
+                path.push_back(node);
+                node = nodes_[node].left;
+            }
+            else if (start == left_size)
+            {
+                path.push_back(node);
+                break;
+            }
+            else
+            {
+                start -= left_size + 1;
+                node = nodes_[node].right;
+            }
+        }
+
+        result.reserve(std::min(max_items, nodes_.size()));
+        while (result.size() < max_items && !path.empty())
+        {
+            node = path.back();
+            path.pop_back();
+            const Node& item = nodes_[node];
+            result.push_back({ item.id, names_[node], item.score, std::chrono::milliseconds{ item.play_time } });
+            for (std::uint32_t next = item.right; next != NIL; next = nodes_[next].left)
+            {
+                path.push_back(next);
+            }
+        }
+        return result;
+    }
+
+    RecordsStore::RecordsStore(std::optional<std::filesystem::path> path)
+        : path_{ std::move(path) }
+    {
+        if (path_)
+        {
+            Load();
+        }
+    }
+
+    RecordsStore::~RecordsStore()
+    {
+        if (fd_ >= 0)
+        {
+            ::fdatasync(fd_);
+            ::close(fd_);
+        }
+    }
+
+    void RecordsStore::Load()
+    {
+        fd_ = ::open(path_->c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Failed to open " + path_->string());
+        }
+
+        std::vector<app::PlayerRecord> records;
+        std::string buffer;
+        // Смещение в файле конца последней целой записи
+        off_t valid_end = 0;
+        bool header_checked = false;
+        bool corrupted = false;
+        bool eof = false;
+        while (!eof && !corrupted)
+        {
+            const size_t size = buffer.size();
+            buffer.resize(size + READ_BLOCK_SIZE);
+            const ssize_t bytes = ::read(fd_, buffer.data() + size, READ_BLOCK_SIZE);
+            if (bytes < 0)
+            {
+                if (errno == EINTR)
+                {
+                    buffer.resize(size);
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "Failed to read " + path_->string());
+            }
+            buffer.resize(size + static_cast<size_t>(bytes));
+            eof = bytes == 0;
+
+            serialization::BinaryReader reader{ buffer };
+            if (!header_checked)
+            {
+                if (reader.Remaining() < FILE_HEADER_SIZE)
+                {
+                    continue;
+                }
+                if (reader.Take(MAGIC.size()) != MAGIC || reader.Pod<std::uint32_t>() != FORMAT_VERSION)
+                {
+                    throw std::runtime_error(path_->string() + " is not a records file of a supported version");
+                }
+                header_checked = true;
+                valid_end = FILE_HEADER_SIZE;
+            }
+            while (reader.Remaining() >= HEADER_SIZE)
+            {
+                // Запись, не поместившаяся в буфер целиком, дочитывается со следующим блоком
+                serialization::BinaryReader frame = reader;
+                const auto body_size = frame.Pod<std::uint32_t>();
+                const auto checksum = frame.Pod<std::uint32_t>();
+                if (frame.Remaining() < body_size)
+                {
+                    break;
+                }
+                const std::string_view body = frame.Take(body_size);
+                reader = frame;
+                if (RecordChecksum(body) != checksum)
+                {
+                    corrupted = true;
+                    break;
+                }
+                serialization::BinaryReader entry{ body };
+                app::PlayerRecord record;
+                record.id = entry.Pod<std::uint64_t>();
+                record.score = entry.Pod<std::int32_t>();
+                record.play_time = std::chrono::milliseconds{ entry.Pod<std::int64_t>() };
+                record.name = entry.String();
+                valid_end += static_cast<off_t>(HEADER_SIZE + body_size);
+                // Номера рекордов в файле возрастают. Повтор возможен, если рекорд записали дважды
+                if (record.id > last_id_)
+                {
+                    last_id_ = record.id;
+                    records.push_back(std::move(record));
+                }
+            }
+            buffer.erase(0, buffer.size() - reader.Remaining());
+        }
+
+        if (!header_checked)
+        {
+            // Файл короче заголовка остаётся после сбоя при его записи: в нём ещё нет ни одного рекорда
+            if (!buffer.empty())
+            {
+                logger::Message(logger::Level::ERROR, "Records file "s + path_->string() + " has a truncated header, it is recreated"s);
+                if (::ftruncate(fd_, 0) != 0)
+                {
+                    throw std::system_error(errno, std::generic_category(), "Failed to truncate " + path_->string());
+                }
+            }
+            // Новый файл
+            std::string header{ MAGIC };
+            serialization::BinaryWriter{ header }.Pod(FORMAT_VERSION);
+            serialization::WriteAll(fd_, header, *path_);
+            ::fdatasync(fd_);
+            serialization::SyncParentDirectory(*path_);
+        }
+        else if (corrupted || !buffer.empty())
+        {
+            logger::Message(logger::Level::ERROR, "Records file "s + path_->string() + " has a damaged tail, it is discarded"s);
+            if (::ftruncate(fd_, valid_end) != 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "Failed to truncate " + path_->string());
+            }
+        }
+
+        std::unique_lock lock{ mutex_ };
+        leaderboard_.Assign(std::move(records));
+    }
+
+    void RecordsStore::Add(const app::PlayerRecord& record)
+    {
+        if (record.id <= last_id_)
+        {
+            return;
+        }
+        last_id_ = record.id;
+        if (fd_ >= 0)
+        {
+            AppendRecord(pending_, record);
+        }
+        std::unique_lock lock{ mutex_ };
+        leaderboard_.Insert(record);
+    }
+
+    void RecordsStore::Commit()
+    {
+        if (pending_.empty())
+        {
+            return;
+        }
+        try
+        {
+            serialization::WriteAll(fd_, pending_, *path_);
+        }
+        catch (const std::exception& ex)
+        {
+            // Рекорды остаются в таблице до перезапуска сервера
+            logger::Message(logger::Level::ERROR, "Failed to write records: "s + ex.what());
+        }
+        pending_.clear();
+    }
+
+    void RecordsStore::Sync() const
+    {
+        if (fd_ >= 0 && ::fdatasync(fd_) != 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Failed to sync " + path_->string());
+        }
+    }
+
+    std::vector<app::PlayerRecord> RecordsStore::GetPage(size_t start, size_t max_items) const
+    {
+        std::shared_lock lock{ mutex_ };
+        return leaderboard_.GetPage(start, max_items);
+    }
+
+    size_t RecordsStore::Size() const
+    {
+        std::shared_lock lock{ mutex_ };
+        return leaderboard_.Size();
+    }
+}  // namespace records
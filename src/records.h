@@ -0,0 +1,118 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "application.h"
+
+namespace records
+{
+    // Упорядоченный индекс рекордов: декартово дерево (treap), в узлах которого хранятся размеры поддеревьев.
+    // Рекорды упорядочены по убыванию очков, затем по возрастанию времени игры и номера рекорда.
+    // Узлы лежат в одном векторе и ссылаются друг на друга индексами
+    class Leaderboard
+    {
+    public:
+        void Insert(const app::PlayerRecord& record);
+
+        // Заменяет содержимое индекса: рекорды сортируются, и дерево строится за линейное время
+        void Assign(std::vector<app::PlayerRecord> records);
+
+        size_t Size() const noexcept
+        {
+            return nodes_.size();
+        }
+
+        // Рекорды с позициями [start, start + max_items) в порядке таблицы. O(log n + max_items)
+        std::vector<app::PlayerRecord> GetPage(size_t start, size_t max_items) const;
+
+    private:
+        static constexpr std::uint32_t NIL = UINT32_MAX;
+
+        struct Node
+        {
+            std::uint64_t id;
+            std::int64_t play_time;
+            std::int32_t score;
+            std::uint32_t priority;
+            std::uint32_t left = NIL;
+            std::uint32_t right = NIL;
+            std::uint32_t size = 1;
+        };
+
+        std::vector<Node> nodes_;
+        // Имена хранятся отдельно от узлов, чтобы спуск по дереву не тянул их в кеш
+        std::vector<std::string> names_;
+        std::uint32_t root_ = NIL;
+        std::uint64_t random_ = 0x9E3779B97F4A7C15ull;
+
+        static bool Less(const Node& lhs, const Node& rhs) noexcept;
+
+        std::uint32_t NextPriority() noexcept;
+
+        std::uint32_t SizeOf(std::uint32_t node) const noexcept
+        {
+            return node == NIL ? 0 : nodes_[node].size;
+        }
+
+        void Update(std::uint32_t node) noexcept;
+
+        std::uint32_t UpdateSizes(std::uint32_t node) noexcept;
+
+        // Делит поддерево node на узлы меньше key и остальные
+        void Split(std::uint32_t node, const Node& key, std::uint32_t& left, std::uint32_t& right) noexcept;
+
+        std::uint32_t Insert(std::uint32_t node, std::uint32_t item) noexcept;
+
+        std::uint32_t AddNode(const app::PlayerRecord& record);
+    };
+
+    // Таблица рекордов игроков, покинувших игру. Рекорды дописываются в файл-журнал, а при запуске
+    // файл читается потоком блоков и по нему заново строится индекс. Повреждённый хвост файла
+    // (запись, не дописанная при сбое) отбрасывается.
+    // Добавление рекордов выполняется в api strand, чтение страниц таблицы - из любого потока
+    class RecordsStore : public app::RecordsSink
+    {
+    public:
+        // Без файла рекорды хранятся только в памяти
+        explicit RecordsStore(std::optional<std::filesystem::path> path);
+
+        RecordsStore(const RecordsStore&) = delete;
+        RecordsStore& operator=(const RecordsStore&) = delete;
+
+        ~RecordsStore();
+
+        void Add(const app::PlayerRecord& record) override;
+
+        // Дописывает в файл рекорды, добавленные с предыдущего вызова, одним вызовом write
+        void Commit() override;
+
+        std::uint64_t GetLastId() const noexcept override
+        {
+            return last_id_;
+        }
+
+        // Сбрасывает файл рекордов на диск. Вызывается перед сохранением снимка игры: после него
+        // журнал действий, по которому можно было бы восстановить рекорды, удаляется
+        void Sync() const;
+
+        std::vector<app::PlayerRecord> GetPage(size_t start, size_t max_items) const;
+
+        size_t Size() const;
+
+    private:
+        std::optional<std::filesystem::path> path_;
+        int fd_ = -1;
+        // Номер последнего сохранённого рекорда. Изменяется только в api strand
+        std::uint64_t last_id_ = 0;
+        std::string pending_;
+
+        mutable std::shared_mutex mutex_;
+        Leaderboard leaderboard_;
+
+        void Load();
+    };
+}  // namespace records
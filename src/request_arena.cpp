@@ -0,0 +1,97 @@
+#include "request_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "memory_pool.h"
+
+namespace request_arena
+{
+    namespace
+    {
+        using PoolAllocator = memory_pool::Allocator<Arena, metrics::Pool::ARENA>;
+
+        std::byte* Align(std::byte* pointer, std::size_t alignment) noexcept
+        {
+            const auto address = reinterpret_cast<std::uintptr_t>(pointer);
+            return pointer + ((alignment - address % alignment) % alignment);
+        }
+    }  // namespace
+
+    Arena::Arena() noexcept
+        : position_{ storage_ }
+        , end_{ storage_ + STORAGE_SIZE }
+    {}
+
+    Arena::~Arena()
+    {
+        FreeChunks();
+    }
+
+    Arena* Arena::Create()
+    {
+        PoolAllocator allocator;
+        return new (allocator.allocate(1)) Arena;
+    }
+
+    void Arena::Release() noexcept
+    {
+        Deallocate();
+    }
+
+    void* Arena::Allocate(std::size_t size, std::size_t alignment)
+    {
+        std::byte* start = Align(position_, alignment);
+        if (start + size > end_)
+        {
+            start = static_cast<std::byte*>(AllocateChunk(size, alignment));
+        }
+        position_ = start + size;
+        references_.fetch_add(1, std::memory_order_relaxed);
+        return start;
+    }
+
+    void Arena::Deallocate() noexcept
+    {
+        if (references_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            Destroy();
+        }
+    }
+
+    bool Arena::Reset() noexcept
+    {
+        if (references_.load(std::memory_order_acquire) != 1)
+        {
+            return false;
+        }
+        FreeChunks();
+        position_ = storage_;
+        end_ = storage_ + STORAGE_SIZE;
+        return true;
+    }
+
+    void* Arena::AllocateChunk(std::size_t size, std::size_t alignment)
+    {
+        const std::size_t chunk_size = std::max(sizeof(Chunk) + alignment + size, CHUNK_SIZE);
+        auto* chunk = new (::operator new(chunk_size)) Chunk{ chunks_ };
+        chunks_ = chunk;
+        end_ = reinterpret_cast<std::byte*>(chunk) + chunk_size;
+        return Align(reinterpret_cast<std::byte*>(chunk + 1), alignment);
+    }
+
+    void Arena::FreeChunks() noexcept
+    {
+        while (chunks_)
+        {
+            ::operator delete(std::exchange(chunks_, chunks_->next));
+        }
+    }
+
+    void Arena::Destroy() noexcept
+    {
+        PoolAllocator allocator;
+        this->~Arena();
+        allocator.deallocate(this, 1);
+    }
+}  // namespace request_arena
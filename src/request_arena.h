@@ -0,0 +1,150 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace request_arena
+{
+    // Память запросов одного соединения: поля заголовка и тело запроса, поля заголовка ответа.
+    // Выделение сдвигает указатель во встроенном буфере, освобождение памяти не возвращает,
+    // а перед чтением следующего запроса арена возвращается к началу (Reset).
+    // Выделяет память одновременно только один поток: соединение, пока оно читает запрос,
+    // или обработчик запроса, пока соединение ждёт ответ. Освобождать можно из любого потока:
+    // объект, переживший свой запрос (например, запрос в очереди api strand), не даёт арене вернуться
+    // к началу и сохраняет её память после закрытия соединения
+    class Arena
+    {
+    public:
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // Арена берётся из пула памяти потока
+        static Arena* Create();
+
+        // Владелец отказывается от арены. Память освобождается, когда будут освобождены все выделенные объекты
+        void Release() noexcept;
+
+        void* Allocate(std::size_t size, std::size_t alignment);
+
+        void Deallocate() noexcept;
+
+        // Возвращает арену к началу, если все выделенные из неё объекты освобождены.
+        // Иначе новые объекты размещаются после ещё живых
+        bool Reset() noexcept;
+
+    private:
+        static constexpr std::size_t STORAGE_SIZE = 4096;
+        static constexpr std::size_t CHUNK_SIZE = 16384;
+
+        // Дополнительный блок памяти на случай, если запрос не помещается во встроенный буфер
+        struct Chunk
+        {
+            Chunk* next;
+        };
+
+        // Владелец и выделенные объекты
+        std::atomic<std::size_t> references_{ 1 };
+        std::byte* position_;
+        std::byte* end_;
+        Chunk* chunks_ = nullptr;
+        alignas(std::max_align_t) std::byte storage_[STORAGE_SIZE];
+
+        Arena() noexcept;
+        ~Arena();
+
+        void* AllocateChunk(std::size_t size, std::size_t alignment);
+        void FreeChunks() noexcept;
+        void Destroy() noexcept;
+    };
+
+    namespace detail
+    {
+        inline thread_local Arena* current = nullptr;
+    }  // namespace detail
+
+    // Арена запроса, который обрабатывает текущий поток, или nullptr
+    inline Arena* Current() noexcept
+    {
+        return detail::current;
+    }
+
+    // Делает арену текущей для потока на время жизни объекта. Так ответы, которые обработчик создаёт
+    // конструктором по умолчанию, размещают поля заголовка в арене запроса
+    class Scope
+    {
+    public:
+        explicit Scope(Arena* arena) noexcept
+            : previous_{ std::exchange(detail::current, arena) }
+        {}
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            detail::current = previous_;
+        }
+
+    private:
+        Arena* previous_;
+    };
+
+    // Аллокатор арены. Созданный по умолчанию аллокатор привязывается к текущей арене потока;
+    // без арены память выделяется в куче
+    template <typename T>
+    class Allocator
+    {
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        Allocator() noexcept
+            : arena_{ Current() }
+        {}
+
+        explicit Allocator(Arena* arena) noexcept
+            : arena_{ arena }
+        {}
+
+        template <typename U>
+        Allocator(const Allocator<U>& other) noexcept
+            : arena_{ other.GetArena() }
+        {}
+
+        T* allocate(std::size_t n)
+        {
+            if (arena_)
+            {
+                return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+            }
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* pointer, std::size_t) noexcept
+        {
+            if (arena_)
+            {
+                return arena_->Deallocate();
+            }
+            ::operator delete(pointer);
+        }
+
+        Arena* GetArena() const noexcept
+        {
+            return arena_;
+        }
+
+        template <typename U>
+        bool operator==(const Allocator<U>& other) const noexcept
+        {
+            return arena_ == other.GetArena();
+        }
+
+    private:
+        Arena* arena_;
+    };
+}  // namespace request_arena
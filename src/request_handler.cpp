@@ -1,5 +1,9 @@
 #include "request_handler.h"
 
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+
 namespace http_handler
 {
     std::size_t HasherPath::operator()(const fs::path& p) const noexcept
@@ -8,10 +12,16 @@ namespace http_handler
     }
 
     using namespace classes_response;
-	RequestHandler::RequestHandler(model::Game& game, const fs::path& wwwroot)
-		: game_{ game }
+	RequestHandler::RequestHandler(app::Application& application, model::Game& game, const records::RecordsStore& records,
+        const fs::path& wwwroot, Strand api_strand, const Settings& settings)
+		: application_{ application }
+        , game_{ game }
+        , records_{ records }
         , wwwroot_{wwwroot}
-	{         
+        , api_strand_{ api_strand }
+        , settings_{ settings }
+	{ 
+        application_.AddListener(broadcaster_);        
         for (auto const& dir_entry : std::filesystem::recursive_directory_iterator{ wwwroot_ })
         {
             if (fs::is_regular_file(dir_entry.symlink_status()))
@@ -22,10 +32,17 @@ namespace http_handler
         responses_.insert({ ResponseType::MAPS, std::make_shared<ResponseMaps>(game_) });
         responses_.insert({ ResponseType::ERROR_TYPE_REQUEST, std::make_shared<ResponseErrorVersion>() });
         responses_.insert({ ResponseType::ERROR_FIND_MAP_ID, std::make_shared<ResponseErrorFindIdMap>() });
+        responses_.insert({ ResponseType::ERROR_GAME_MAP_NOT_FOUND, std::make_shared<ResponseErrorGameMapNotFound>() });
         responses_.insert({ ResponseType::FIND_MAP_ID, std::make_shared<ResponseMapId>(game_) });
         responses_.insert({ ResponseType::FILE, std::make_shared<ResponseFile>() });
         responses_.insert({ ResponseType::FILE_NOT_FOUND, std::make_shared<ResponseFileNotFound>() });
         responses_.insert({ ResponseType::FILE_OUTSIDE, std::make_shared<ResponseFileOutside>() });
+        responses_.insert({ ResponseType::GAME, std::make_shared<ResponseGame>() });
+        responses_.insert({ ResponseType::METRICS, std::make_shared<ResponseMetrics>() });
+        responses_.insert({ ResponseType::ERROR_INVALID_ARGUMENT, std::make_shared<ResponseErrorInvalidArgument>() });
+        responses_.insert({ ResponseType::ERROR_INVALID_TOKEN, std::make_shared<ResponseErrorInvalidToken>() });
+        responses_.insert({ ResponseType::ERROR_UNKNOWN_TOKEN, std::make_shared<ResponseErrorUnknownToken>() });
+        responses_.insert({ ResponseType::ERROR_METHOD_NOT_ALLOWED, std::make_shared<ResponseErrorMethodNotAllowed>() });
         responses_.insert({ "", std::make_shared<ResponseClear>() });
     }
 
@@ -268,4 +285,431 @@ namespace http_handler
         return result;
     }
     
+    classes_response::TypeClassResponse RequestHandler::CreateResponseGameJson(const json::value& value, const http::verb& method)
+    {
+        classes_response::TypeClassResponse result;
+        result.method = method;
+        result.name = classes_response::ResponseType::GAME;
+        result.data = json::serialize(value);
+        result.file_extension = classes_response::Extension::JSON;
+        return result;
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponseErrorInvalidArgument(std::string message, const http::verb& method)
+    {
+        classes_response::TypeClassResponse result;
+        result.method = method;
+        result.name = classes_response::ResponseType::ERROR_INVALID_ARGUMENT;
+        result.data = std::move(message);
+        result.file_extension = classes_response::Extension::JSON;
+        return result;
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponseErrorMethodNotAllowed(std::string allow, const http::verb& method)
+    {
+        classes_response::TypeClassResponse result;
+        result.method = method;
+        result.name = classes_response::ResponseType::ERROR_METHOD_NOT_ALLOWED;
+        result.data = std::move(allow);
+        result.file_extension = classes_response::Extension::JSON;
+        return result;
+    }
+    app::Player* RequestHandler::AuthorizePlayer(std::string_view authorization, const http::verb& method,
+        classes_response::TypeClassResponse& error)
+    {
+        constexpr std::string_view BEARER = "Bearer "sv;
+        constexpr size_t TOKEN_SIZE = 32;
+
+        error.method = method;
+        error.file_extension = classes_response::Extension::JSON;
+        if (!authorization.starts_with(BEARER) || authorization.size() != BEARER.size() + TOKEN_SIZE)
+        {
+            error.name = classes_response::ResponseType::ERROR_INVALID_TOKEN;
+            return nullptr;
+        }
+        app::Token token{ std::string{ authorization.substr(BEARER.size()) } };
+        app::Player* player = application_.FindPlayer(token);
+        if (!player)
+        {
+            error.name = classes_response::ResponseType::ERROR_UNKNOWN_TOKEN;
+        }
+        return player;
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponseJoin(std::string_view body, const http::verb& method)
+    {
+        if (method != http::verb::post)
+        {
+            return CreateResponseErrorMethodNotAllowed("POST"s, method);
+        }
+
+        std::string user_name;
+        std::string map_id;
+        try
+        {
+            const json::value request = json::parse(body);
+            user_name = std::string{ request.at("userName").as_string() };
+            map_id = std::string{ request.at("mapId").as_string() };
+        }
+        catch (...)
+        {
+            return CreateResponseErrorInvalidArgument("Join game request parse error"s, method);
+        }
+        if (user_name.empty())
+        {
+            return CreateResponseErrorInvalidArgument("Invalid name"s, method);
+        }
+
+        auto joined = application_.JoinGame(std::move(user_name), model::Map::Id{ map_id });
+        if (!joined)
+        {
+            classes_response::TypeClassResponse result;
+            result.method = method;
+            result.name = classes_response::ResponseType::ERROR_GAME_MAP_NOT_FOUND;
+            return result;
+        }
+        json::object response;
+        response["authToken"] = *joined->token;
+        response["playerId"] = *joined->player_id;
+        return CreateResponseGameJson(response, method);
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponsePlayers(std::string_view authorization, const http::verb& method)
+    {
+        if (method != http::verb::get && method != http::verb::head)
+        {
+            return CreateResponseErrorMethodNotAllowed("GET, HEAD"s, method);
+        }
+        classes_response::TypeClassResponse error;
+        app::Player* player = AuthorizePlayer(authorization, method, error);
+        if (!player)
+        {
+            return error;
+        }
+        return CreateResponseGameJson(json_loader::MakeJsonResponsePlayers(player->GetSession()), method);
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponseState(std::string_view authorization, std::string_view query,
+        const http::verb& method)
+    {
+        if (method != http::verb::get && method != http::verb::head)
+        {
+            return CreateResponseErrorMethodNotAllowed("GET, HEAD"s, method);
+        }
+        classes_response::TypeClassResponse error;
+        app::Player* player = AuthorizePlayer(authorization, method, error);
+        if (!player)
+        {
+            return error;
+        }
+
+        // since -   ,  .     
+        std::optional<model::GameSession::Version> since;
+        if (const auto value = FindQueryParameter(query, "since"sv))
+        {
+            model::GameSession::Version version = 0;
+            auto [ptr, ec] = std::from_chars(value->data(), value->data() + value->size(), version);
+            if (ec != std::errc{} || ptr != value->data() + value->size())
+            {
+                return CreateResponseErrorInvalidArgument("Invalid state version"s, method);
+            }
+            since = version;
+        }
+
+        const model::GameSession& session = player->GetSession();
+        std::optional<std::vector<model::Dog::Id>> changes;
+        if (since)
+        {
+            changes = session.GetChangesSince(*since);
+        }
+
+        const model::Dog* dog = session.FindDog(player->GetId());
+        if (session.GetViewRadius() <= 0.0 || !dog)
+        {
+            const bool with_loot = since && session.GetLootVersion() > *since;
+            return CreateResponseGameJson(json_loader::MakeJsonResponseState(session, changes, with_loot), method);
+        }
+
+        //            .
+        //      ,        
+        const auto position = session.GetDogPosition(*dog);
+        auto visible = session.FindDogsNear(position, session.GetViewRadius());
+        const auto visible_loot = session.FindLootNear(position, session.GetViewRadius());
+        //       ,     ,
+        //          since.     
+        //   ,         
+        const std::vector<model::Dog::Id>* known = since ? player->GetVisibleDogs(*since) : nullptr;
+        json::object state;
+        if (!changes || !known)
+        {
+            state = json_loader::MakeJsonResponseState(session, visible, true, &visible, &visible_loot);
+        }
+        else
+        {
+            std::vector<model::Dog::Id> visible_changes;
+            std::set_intersection(changes->begin(), changes->end(), visible.begin(), visible.end(),
+                std::back_inserter(visible_changes));
+            std::vector<model::Dog::Id> appeared;
+            std::set_difference(visible.begin(), visible.end(), known->begin(), known->end(),
+                std::back_inserter(appeared));
+            std::vector<model::Dog::Id> dogs;
+            std::set_union(visible_changes.begin(), visible_changes.end(), appeared.begin(), appeared.end(),
+                std::back_inserter(dogs));
+            state = json_loader::MakeJsonResponseState(session, dogs, false, &visible, &visible_loot);
+        }
+        player->SetVisibleDogs(session.GetVersion(), std::move(visible));
+        return CreateResponseGameJson(std::move(state), method);
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponseAction(std::string_view authorization,
+        std::string_view content_type, std::string_view body, const http::verb& method)
+    {
+        if (method != http::verb::post)
+        {
+            return CreateResponseErrorMethodNotAllowed("POST"s, method);
+        }
+        classes_response::TypeClassResponse error;
+        app::Player* player = AuthorizePlayer(authorization, method, error);
+        if (!player)
+        {
+            return error;
+        }
+        if (content_type != classes_response::ContentType::APPLICATION_JSON)
+        {
+            return CreateResponseErrorInvalidArgument("Invalid content type"s, method);
+        }
+
+        std::optional<model::Direction> direction;
+        try
+        {
+            const json::value request = json::parse(body);
+            const std::string_view move = request.at("move").as_string();
+            if (move == "U"sv)
+            {
+                direction = model::Direction::NORTH;
+            }
+            else if (move == "D"sv)
+            {
+                direction = model::Direction::SOUTH;
+            }
+            else if (move == "L"sv)
+            {
+                direction = model::Direction::WEST;
+            }
+            else if (move == "R"sv)
+            {
+                direction = model::Direction::EAST;
+            }
+            else if (!move.empty())
+            {
+                throw std::invalid_argument("Unknown move");
+            }
+        }
+        catch (...)
+        {
+            return CreateResponseErrorInvalidArgument("Failed to parse action"s, method);
+        }
+
+        application_.MovePlayer(*player, direction);
+        return CreateResponseGameJson(json::object{}, method);
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponseTick(std::string_view body, const http::verb& method)
+    {
+        if (!settings_.manual_tick)
+        {
+            return CreateResponseErrorTypeRequest(method);
+        }
+        if (method != http::verb::post)
+        {
+            return CreateResponseErrorMethodNotAllowed("POST"s, method);
+        }
+
+        std::int64_t delta = 0;
+        try
+        {
+            delta = json::parse(body).at("timeDelta").as_int64();
+        }
+        catch (...)
+        {
+            return CreateResponseErrorInvalidArgument("Failed to parse tick request JSON"s, method);
+        }
+        if (delta < 0)
+        {
+            return CreateResponseErrorInvalidArgument("Invalid time delta"s, method);
+        }
+
+        application_.Tick(std::chrono::milliseconds{ delta });
+        return CreateResponseGameJson(json::object{}, method);
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponseRecords(std::string_view query, const http::verb& method)
+    {
+        if (method != http::verb::get && method != http::verb::head)
+        {
+            return CreateResponseErrorMethodNotAllowed("GET, HEAD"s, method);
+        }
+
+        constexpr size_t MAX_ITEMS = 100;
+        size_t start = 0;
+        size_t max_items = MAX_ITEMS;
+        for (const auto& [name, target] : { std::pair{ "start"sv, &start }, std::pair{ "maxItems"sv, &max_items } })
+        {
+            const auto value = FindQueryParameter(query, name);
+            if (!value)
+            {
+                continue;
+            }
+            auto [ptr, ec] = std::from_chars(value->data(), value->data() + value->size(), *target);
+            if (ec != std::errc{} || ptr != value->data() + value->size())
+            {
+                return CreateResponseErrorInvalidArgument("Invalid records page parameters"s, method);
+            }
+        }
+        if (max_items > MAX_ITEMS)
+        {
+            return CreateResponseErrorInvalidArgument("maxItems must not exceed 100"s, method);
+        }
+
+        return CreateResponseGameJson(json_loader::MakeJsonResponseRecords(records_.GetPage(start, max_items)), method);
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponseMetrics(const http::verb& method)
+    {
+        if (method != http::verb::get && method != http::verb::head)
+        {
+            return CreateResponseErrorMethodNotAllowed("GET, HEAD"s, method);
+        }
+        classes_response::TypeClassResponse result;
+        result.method = method;
+        result.name = classes_response::ResponseType::METRICS;
+        result.data = metrics::RenderPrometheus();
+        return result;
+    }
+    metrics::Route RequestHandler::ClassifyRoute(std::string_view target) noexcept
+    {
+        using classes_response::RequestType;
+        target = target.substr(0, target.find('?'));
+        if (!target.starts_with(RequestType::API))
+        {
+            return metrics::Route::STATIC;
+        }
+        if (target == RequestType::API_V1_MAPS)
+        {
+            return metrics::Route::MAPS;
+        }
+        if (target.starts_with(RequestType::API_V1_MAPS) && target.size() > RequestType::API_V1_MAPS.size()
+            && target[RequestType::API_V1_MAPS.size()] == '/')
+        {
+            return metrics::Route::MAP;
+        }
+        if (target == RequestType::API_V1_GAME_JOIN)
+        {
+            return metrics::Route::JOIN;
+        }
+        if (target == RequestType::API_V1_GAME_PLAYERS)
+        {
+            return metrics::Route::PLAYERS;
+        }
+        if (target == RequestType::API_V1_GAME_STATE)
+        {
+            return metrics::Route::STATE;
+        }
+        if (target == RequestType::API_V1_GAME_ACTION)
+        {
+            return metrics::Route::ACTION;
+        }
+        if (target == RequestType::API_V1_GAME_TICK)
+        {
+            return metrics::Route::TICK;
+        }
+        if (target == RequestType::API_V1_GAME_RECORDS)
+        {
+            return metrics::Route::RECORDS;
+        }
+        if (target == RequestType::API_V1_METRICS)
+        {
+            return metrics::Route::METRICS;
+        }
+        return metrics::Route::OTHER;
+    }
+    std::optional<std::string_view> RequestHandler::FindQueryParameter(std::string_view query,
+        std::string_view name) noexcept
+    {
+        while (!query.empty())
+        {
+            const size_t end = std::min(query.find('&'), query.size());
+            const std::string_view param = query.substr(0, end);
+            query.remove_prefix(std::min(end + 1, query.size()));
+
+            const size_t eq = param.find('=');
+            if (param.substr(0, eq) == name)
+            {
+                return eq == std::string_view::npos ? std::string_view{} : param.substr(eq + 1);
+            }
+        }
+        return std::nullopt;
+    }
+    void RequestHandler::Upgrade(beast::tcp_stream&& stream, StringRequest&& req)
+    {
+        auto session = std::make_shared<http_server::WebSocketSession>(std::move(stream), settings_.ws_queue_limit);
+        net::dispatch(api_strand_, [this, session, req = std::move(req)]() mutable
+        {
+            std::string target{ req.target() };
+            std::string query;
+            if (auto pos = target.find('?'); pos != std::string::npos)
+            {
+                query = target.substr(pos + 1);
+                target.erase(pos);
+            }
+            if (target != classes_response::RequestType::API_V1_GAME_WS)
+            {
+                auto error = CreateResponseErrorTypeRequest(req.method());
+                return session->Reject(std::get<StringResponse>(responses_[error.name]->GetResponses(error)));
+            }
+
+            std::string authorization{ req[http::field::authorization] };
+            if (const auto token = FindQueryParameter(query, "token"sv); authorization.empty() && token)
+            {
+                authorization = "Bearer "s + std::string{ *token };
+            }
+            classes_response::TypeClassResponse error;
+            app::Player* player = AuthorizePlayer(authorization, req.method(), error);
+            if (!player)
+            {
+                return session->Reject(std::get<StringResponse>(responses_[error.name]->GetResponses(error)));
+            }
+
+            broadcaster_.Subscribe(session, *player);
+            session->Accept(std::move(req));
+        });
+    }
+    classes_response::TypeClassResponse RequestHandler::CreateResponseGame(std::string&& target, const http::verb& method,
+        std::string_view authorization, std::string_view content_type, std::string_view body)
+    {
+        std::string query;
+        if (auto pos = target.find('?'); pos != std::string::npos)
+        {
+            query = target.substr(pos + 1);
+            target.erase(pos);
+        }
+
+        using classes_response::RequestType;
+        if (target == RequestType::API_V1_GAME_JOIN)
+        {
+            return CreateResponseJoin(body, method);
+        }
+        else if (target == RequestType::API_V1_GAME_PLAYERS)
+        {
+            return CreateResponsePlayers(authorization, method);
+        }
+        else if (target == RequestType::API_V1_GAME_STATE)
+        {
+            return CreateResponseState(authorization, query, method);
+        }
+        else if (target == RequestType::API_V1_GAME_ACTION)
+        {
+            return CreateResponseAction(authorization, content_type, body, method);
+        }
+        else if (target == RequestType::API_V1_GAME_TICK)
+        {
+            return CreateResponseTick(body, method);
+        }
+        else if (target == RequestType::API_V1_GAME_RECORDS)
+        {
+            return CreateResponseRecords(query, method);
+        }
+        return CreateResponseErrorTypeRequest(method);
+    }
 }  // namespace http_handler
@@ -1,10 +1,23 @@
 #pragma once
 #include "http_server.h"
 #include "model.h"
+#include "application.h"
+#include "admission.h"
 #include "classes_response.h"
+#include "compute_pool.h"
+#include "metrics.h"
+#include "records.h"
+#include "request_scheduler.h"
+#include "state_broadcaster.h"
+#include "tracing.h"
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/json.hpp>
+#include <chrono>
 #include <sstream>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <variant>
 #include <filesystem>
@@ -13,6 +26,7 @@
 
 namespace http_handler
 {
+    namespace net = boost::asio;
     namespace sys = boost::system;
     namespace beast = boost::beast;
     namespace http = beast::http;
@@ -24,10 +38,10 @@ namespace http_handler
     using StringRequest = http::request<http::string_body>;
 
     // Ответ, тело которого представлено в виде строки
-    using StringResponse = http::response<http::string_body>;
+    using StringResponse = classes_response::StringResponse;
 
     // Ответ, тело которого представлено в виде файла
-    using FileResponse = http::response<http::file_body>;
+    using FileResponse = classes_response::FileResponse;
 
     using Responses = std::variant<StringResponse, FileResponse>;
 
@@ -37,10 +51,34 @@ namespace http_handler
        
     };
 
+    // Доступ game_server_bench к закрытым методам разбора запросов
+    struct BenchAccess;
+
     class RequestHandler
     {
+        friend struct BenchAccess;
+
     public:
-        explicit RequestHandler(model::Game& game, const fs::path& wwwroot);
+        using Strand = net::strand<net::io_context::executor_type>;
+
+        struct Settings
+        {
+            // Игровое время продвигается запросами POST /api/v1/game/tick
+            bool manual_tick = true;
+            // Максимальное количество неотправленных кадров в очереди подписчика WebSocket
+            size_t ws_queue_limit = 8;
+            // Пул, в котором строятся тяжёлые ответы (описание карты). nullptr - они строятся в потоке соединения
+            compute_pool::Pool* offload = nullptr;
+            // Очереди классов приоритета, через которые проходят все запросы. nullptr - запросы обрабатываются
+            // сразу в порядке чтения
+            request_scheduler::Scheduler* scheduler = nullptr;
+            // Получает время ожидания запросов в очередях и подстраивает по нему предел запросов.
+            // nullptr - время ожидания не передаётся
+            admission::Controller* admission = nullptr;
+        };
+
+        RequestHandler(app::Application& application, model::Game& game, const records::RecordsStore& records,
+            const fs::path& wwwroot, Strand api_strand, const Settings& settings);
 
         RequestHandler(const RequestHandler&) = delete;
         RequestHandler& operator=(const RequestHandler&) = delete;
@@ -48,21 +86,45 @@ namespace http_handler
         template <typename Body, typename Allocator, typename Send>
         void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send)
         {
-            auto answer = HandleRequest(std::move(req));
-            if (std::holds_alternative<StringResponse>(answer))
-            {               
-                send(std::get<0>(answer));
-            }
-            else
+            const auto start = std::chrono::steady_clock::now();
+            const metrics::Route route = ClassifyRoute(req.target());
+            const tracing::RequestId trace = tracing::CurrentRequest();
+            if (settings_.scheduler)
             {
-                send(std::get<1>(answer));
+                settings_.scheduler->Submit(PriorityOf(route), [this, start, route, trace,
+                    arena = request_arena::Current(), req = std::move(req), send = std::forward<Send>(send)]() mutable
+                {
+                    const request_arena::Scope arena_scope{ arena };
+                    const auto dequeued = std::chrono::steady_clock::now();
+                    if (trace)
+                    {
+                        tracing::Record(trace, "queue_wait", start, dequeued);
+                    }
+                    Dispatch(std::move(req), std::move(send), route, trace, start, dequeued);
+                });
+                return;
             }
-            
+            Dispatch(std::move(req), std::forward<Send>(send), route, trace, start, start);
         }
 
+        // Класс приоритета запроса к target: по нему выбираются очередь планировщика и корзина ограничения частоты
+        static metrics::Priority ClassifyPriority(std::string_view target) noexcept
+        {
+            return PriorityOf(ClassifyRoute(target));
+        }
+
+        // Подписывает соединение, приславшее запрос Upgrade на /api/v1/game/ws, на рассылку состояния.
+        // Токен передаётся в заголовке Authorization или в параметре запроса token
+        void Upgrade(beast::tcp_stream&& stream, StringRequest&& req);
+
     private:
+        app::Application& application_;
         model::Game& game_;
+        const records::RecordsStore& records_;
         fs::path wwwroot_;
+        Strand api_strand_;
+        Settings settings_;
+        StateBroadcaster broadcaster_;
         std::unordered_map<std::string_view, std::shared_ptr<classes_response::Response>> responses_;
         std::unordered_set<fs::path, HasherPath> files_;
 
@@ -98,11 +160,155 @@ namespace http_handler
 
         classes_response::TypeClassResponse CreateResponseErrorTypeRequest(const http::verb& method);       
 
+        classes_response::TypeClassResponse CreateResponseGameJson(const json::value& value, const http::verb& method);
+
+        classes_response::TypeClassResponse CreateResponseErrorInvalidArgument(std::string message, const http::verb& method);
+
+        classes_response::TypeClassResponse CreateResponseErrorMethodNotAllowed(std::string allow, const http::verb& method);
+
+        // Находит игрока по заголовку Authorization. При ошибке возвращает nullptr и заполняет error
+        app::Player* AuthorizePlayer(std::string_view authorization, const http::verb& method,
+            classes_response::TypeClassResponse& error);
+
+        classes_response::TypeClassResponse CreateResponseJoin(std::string_view body, const http::verb& method);
+
+        classes_response::TypeClassResponse CreateResponsePlayers(std::string_view authorization, const http::verb& method);
+
+        classes_response::TypeClassResponse CreateResponseState(std::string_view authorization, std::string_view query,
+            const http::verb& method);
+
+        classes_response::TypeClassResponse CreateResponseAction(std::string_view authorization, std::string_view content_type,
+            std::string_view body, const http::verb& method);
+
+        classes_response::TypeClassResponse CreateResponseTick(std::string_view body, const http::verb& method);
+
+        classes_response::TypeClassResponse CreateResponseRecords(std::string_view query, const http::verb& method);
+
+        classes_response::TypeClassResponse CreateResponseMetrics(const http::verb& method);
+
+        // Маршрут запроса для метрик. Параметры запроса не учитываются
+        static metrics::Route ClassifyRoute(std::string_view target) noexcept;
+
+        // Значение параметра name в строке параметров query (часть адреса после '?').
+        // Параметр без '=' имеет пустое значение, отсутствующий - std::nullopt
+        static std::optional<std::string_view> FindQueryParameter(std::string_view query, std::string_view name) noexcept;
+
+        // Ответ на запрос маршрута строится долго и не зависит от игрового состояния
+        static bool IsHeavy(metrics::Route route) noexcept
+        {
+            return route == metrics::Route::MAP;
+        }
+
+        classes_response::TypeClassResponse CreateResponseGame(std::string&& target, const http::verb& method,
+            std::string_view authorization, std::string_view content_type, std::string_view body);
+
+        // Класс приоритета запроса: игровое API выше описаний карт, описания карт выше статических файлов
+        static metrics::Priority PriorityOf(metrics::Route route) noexcept
+        {
+            switch (route)
+            {
+            case metrics::Route::JOIN:
+            case metrics::Route::PLAYERS:
+            case metrics::Route::STATE:
+            case metrics::Route::ACTION:
+            case metrics::Route::TICK:
+                return metrics::Priority::GAME;
+            case metrics::Route::STATIC:
+            case metrics::Route::OTHER:
+                return metrics::Priority::STATIC;
+            default:
+                return metrics::Priority::METADATA;
+            }
+        }
+
+        // Передаёт запрос исполнителю его маршрута. start - время получения запроса обработчиком,
+        // dispatched - время, с которого отсчитывается ожидание api_strand_ или пула
+        template <typename Body, typename Allocator, typename Send>
+        void Dispatch(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, metrics::Route route,
+            tracing::RequestId trace, std::chrono::steady_clock::time_point start,
+            std::chrono::steady_clock::time_point dispatched)
+        {
+            // Таблица рекордов читается под собственной блокировкой и не ждёт игровых тиков
+            if (req.target().starts_with(classes_response::RequestType::API_V1_GAME)
+                && !req.target().starts_with(classes_response::RequestType::API_V1_GAME_RECORDS))
+            {
+                // Запросы игрового API меняют состояние игры, поэтому выполняются последовательно в api_strand_
+                metrics::CountStrandQueued();
+                net::dispatch(api_strand_, [this, start, dispatched, route, trace, arena = request_arena::Current(),
+                    req = std::move(req), send = std::forward<Send>(send)]() mutable
+                {
+                    metrics::CountStrandStarted();
+                    ReportQueueWait(start);
+                    // Соединение ждёт ответа и не пользуется своей ареной, пока запрос выполняется здесь
+                    const request_arena::Scope arena_scope{ arena };
+                    if (trace)
+                    {
+                        tracing::Record(trace, "strand_wait", dispatched, std::chrono::steady_clock::now());
+                    }
+                    SendResponses(HandleRequest(std::move(req), trace), route, start, send);
+                });
+                return;
+            }
+            if (settings_.offload && IsHeavy(route))
+            {
+                // Сериализация большой карты не задерживает остальные соединения потока ввода-вывода.
+                // send продолжает работу в strand соединения
+                settings_.offload->Submit([this, start, dispatched, route, trace, arena = request_arena::Current(),
+                    req = std::move(req), send = std::forward<Send>(send)]() mutable
+                {
+                    ReportQueueWait(start);
+                    const request_arena::Scope arena_scope{ arena };
+                    if (trace)
+                    {
+                        tracing::Record(trace, "offload_wait", dispatched, std::chrono::steady_clock::now());
+                    }
+                    SendResponses(HandleRequest(std::move(req), trace), route, start, send);
+                });
+                return;
+            }
+            // Без планировщика такой запрос обрабатывается сразу и в очередях не ждёт
+            if (dispatched != start)
+            {
+                ReportQueueWait(start);
+            }
+            SendResponses(HandleRequest(std::move(req), trace), route, start, send);
+        }
+
+        // Запрос, полученный обработчиком в start, дождался своей очереди
+        void ReportQueueWait(std::chrono::steady_clock::time_point start) const noexcept
+        {
+            if (settings_.admission)
+            {
+                settings_.admission->RequestStarted(std::chrono::steady_clock::now() - start);
+            }
+        }
+
+        // start - время получения запроса обработчиком: время ожидания api_strand_ входит в длительность обработки
+        template <typename Send>
+        static void SendResponses(Responses&& answer, metrics::Route route, std::chrono::steady_clock::time_point start,
+            Send& send)
+        {
+            const unsigned status = std::visit([](const auto& response)
+            {
+                return response.result_int();
+            }, answer);
+            metrics::CountRequest(route, status, std::chrono::steady_clock::now() - start);
+            if (std::holds_alternative<StringResponse>(answer))
+            {
+                send(std::get<0>(std::move(answer)));
+            }
+            else
+            {
+                send(std::get<1>(std::move(answer)));
+            }
+        }
+
         template <typename Body, typename Allocator>
         classes_response::TypeClassResponse ParseRequest(http::request<Body, http::basic_fields<Allocator>>&& req);
 
+        // Фазы разбора маршрута и построения ответа записываются в трассировку запроса trace
         template <typename Body, typename Allocator>
-        Responses HandleRequest(http::request<Body, http::basic_fields<Allocator>>&& req);     
+        Responses HandleRequest(http::request<Body, http::basic_fields<Allocator>>&& req, tracing::RequestId trace);
     };
 
     template<typename Body, typename Allocator>
@@ -115,10 +321,19 @@ namespace http_handler
         {
             return CreateResponseFile(std::move(target), req.method());
         }
+        else if (target.starts_with(classes_response::RequestType::API_V1_GAME))
+        {
+            return CreateResponseGame(std::move(target), req.method(), req[http::field::authorization],
+                req[http::field::content_type], req.body());
+        }
         else if (target == classes_response::RequestType::API_V1_MAPS)
         {
             return CreateResponseMaps(req.method());
         }
+        else if (target == classes_response::RequestType::API_V1_METRICS)
+        {
+            return CreateResponseMetrics(req.method());
+        }
         else if (target.substr(0, 12) == classes_response::RequestType::API_V1_MAPS && target.size() > 12)
         {
             return CreateResponseMapId(std::move(target), req.method());
@@ -131,9 +346,15 @@ namespace http_handler
     }
 
     template<typename Body, typename Allocator>
-    inline Responses RequestHandler::HandleRequest(http::request<Body, http::basic_fields<Allocator>>&& req)
+    inline Responses RequestHandler::HandleRequest(http::request<Body, http::basic_fields<Allocator>>&& req,
+        tracing::RequestId trace)
     {
-        classes_response::TypeClassResponse str = ParseRequest(std::move(req));
+        classes_response::TypeClassResponse str;
+        {
+            const tracing::Span span{ trace, "route" };
+            str = ParseRequest(std::move(req));
+        }
+        const tracing::Span span{ trace, "response" };
         return responses_[str.name]->GetResponses(str);
     }
 }  // namespace http_handler
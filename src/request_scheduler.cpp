@@ -0,0 +1,48 @@
+#include "request_scheduler.h"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+
+namespace request_scheduler
+{
+    Scheduler::Scheduler(net::io_context& ioc)
+        : executor_{ ioc.get_executor() }
+    {}
+
+    void Scheduler::Submit(metrics::Priority priority, compute_pool::Task task)
+    {
+        const std::size_t index = std::min(static_cast<std::size_t>(priority), PRIORITY_COUNT - 1);
+        {
+            std::lock_guard lock{ mutex_ };
+            queues_[index].push_back({ std::move(task), std::chrono::steady_clock::now() });
+        }
+        metrics::CountScheduled(static_cast<metrics::Priority>(index));
+        net::post(executor_, [this]
+        {
+            RunNext();
+        });
+    }
+
+    void Scheduler::RunNext()
+    {
+        Entry entry;
+        std::size_t index = 0;
+        {
+            std::lock_guard lock{ mutex_ };
+            while (index < PRIORITY_COUNT && queues_[index].empty())
+            {
+                ++index;
+            }
+            // Обработок в io_context столько же, сколько задач в очередях
+            if (index == PRIORITY_COUNT)
+            {
+                return;
+            }
+            entry = std::move(queues_[index].front());
+            queues_[index].pop_front();
+        }
+        metrics::CountScheduleWait(static_cast<metrics::Priority>(index), std::chrono::steady_clock::now() - entry.queued);
+        entry.task();
+    }
+}  // namespace request_scheduler
@@ -0,0 +1,45 @@
+#pragma once
+#include <boost/asio/io_context.hpp>
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <mutex>
+
+#include "compute_pool.h"
+#include "metrics.h"
+
+namespace request_scheduler
+{
+    namespace net = boost::asio;
+
+    // Очереди обработки запросов по классам приоритета. Каждая поставленная задача отправляет в io_context
+    // одну обработку, которая выполняет задачу самого приоритетного непустого класса. Поэтому запрос игрового
+    // API, пришедший во время наплыва запросов статических файлов, обрабатывается следующим, а не после всех
+    // уже прочитанных запросов файлов
+    class Scheduler
+    {
+    public:
+        explicit Scheduler(net::io_context& ioc);
+
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        void Submit(metrics::Priority priority, compute_pool::Task task);
+
+    private:
+        static constexpr std::size_t PRIORITY_COUNT = static_cast<std::size_t>(metrics::Priority::COUNT);
+
+        struct Entry
+        {
+            compute_pool::Task task;
+            std::chrono::steady_clock::time_point queued;
+        };
+
+        net::io_context::executor_type executor_;
+        std::mutex mutex_;
+        std::array<std::deque<Entry>, PRIORITY_COUNT> queues_;
+
+        void RunNext();
+    };
+}  // namespace request_scheduler
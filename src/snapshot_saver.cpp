@@ -0,0 +1,120 @@
+#include "snapshot_saver.h"
+
+#include <string>
+
+#include "logger.h"
+#include "state_serialization.h"
+
+namespace serialization
+{
+    SnapshotSaver::SnapshotSaver(const app::Application& application, std::filesystem::path path,
+        std::chrono::milliseconds period, Journal* journal, const records::RecordsStore* records)
+        : application_{ application }
+        , path_{ std::move(path) }
+        , period_{ period }
+        , journal_{ journal }
+        , records_{ records }
+        , writer_{ [this](std::stop_token stop)
+        {
+            Run(std::move(stop));
+        } }
+    {}
+
+    SnapshotSaver::~SnapshotSaver()
+    {
+        {
+            // Под мьютексом, чтобы фоновый поток не пропустил уведомление между проверкой условия и ожиданием
+            std::lock_guard lock{ mutex_ };
+            writer_.request_stop();
+        }
+        cv_.notify_all();
+    }
+
+    void SnapshotSaver::OnTick(std::chrono::milliseconds delta)
+    {
+        if (period_.count() <= 0)
+        {
+            return;
+        }
+        since_save_ += delta;
+        if (since_save_ < period_)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard lock{ mutex_ };
+            if (writing_)
+            {
+                return;
+            }
+        }
+        since_save_ = {};
+        Capture();
+        {
+            std::lock_guard lock{ mutex_ };
+            std::swap(front_, back_);
+            writing_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    void SnapshotSaver::SaveNow()
+    {
+        std::unique_lock lock{ mutex_ };
+        cv_.wait(lock, [this]
+        {
+            return !writing_;
+        });
+        Capture();
+        Write(front_);
+    }
+
+    void SnapshotSaver::Capture()
+    {
+        application_.CaptureSnapshot(front_);
+        front_.journal_sequence = journal_ ? journal_->Rotate() : 0;
+    }
+
+    void SnapshotSaver::Run(std::stop_token stop)
+    {
+        std::unique_lock lock{ mutex_ };
+        while (true)
+        {
+            cv_.wait(lock, [this, &stop]
+            {
+                return writing_ || stop.stop_requested();
+            });
+            if (!writing_)
+            {
+                return;
+            }
+
+            lock.unlock();
+            Write(back_);
+            lock.lock();
+            writing_ = false;
+            cv_.notify_all();
+        }
+    }
+
+    void SnapshotSaver::Write(const app::ApplicationSnapshot& snapshot) const noexcept
+    {
+        try
+        {
+            if (records_)
+            {
+                records_->Sync();
+            }
+            SaveSnapshotFile(path_, snapshot);
+            if (journal_)
+            {
+                journal_->RemoveSegmentsUpTo(snapshot.journal_sequence);
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            logger::Message(logger::Level::ERROR, std::string{ "Failed to save game state: " } + ex.what());
+        }
+    }
+}  // namespace serialization
@@ -0,0 +1,63 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#include "application.h"
+#include "journal.h"
+#include "records.h"
+
+namespace serialization
+{
+    // Периодически сохраняет состояние игры в файл, не задерживая тик.
+    // В api strand на границе тика состояние копируется в передний буфер, после чего буферы
+    // меняются местами, и фоновый поток сериализует и записывает задний буфер. Память буферов
+    // переиспользуется между сохранениями, поэтому копирование сводится к копированию массивов.
+    // Если предыдущее сохранение ещё пишется, очередное откладывается до следующего тика.
+    // Если задан журнал действий, снимок запоминает номер его последней записи, а после
+    // успешного сохранения учтённые в снимке сегменты журнала удаляются. Перед сохранением на диск
+    // сбрасывается файл рекордов: рекорды, номера которых учтены в снимке, уже не восстановить по журналу
+    class SnapshotSaver : public app::ApplicationListener
+    {
+    public:
+        // period - интервал игрового времени между сохранениями. 0 - сохранять только при остановке
+        SnapshotSaver(const app::Application& application, std::filesystem::path path, std::chrono::milliseconds period,
+            Journal* journal = nullptr, const records::RecordsStore* records = nullptr);
+
+        SnapshotSaver(const SnapshotSaver&) = delete;
+        SnapshotSaver& operator=(const SnapshotSaver&) = delete;
+
+        ~SnapshotSaver();
+
+        void OnTick(std::chrono::milliseconds delta) override;
+
+        // Дожидается фоновой записи и синхронно сохраняет текущее состояние.
+        // Вызывается при остановке сервера, когда игровое состояние больше не изменяется
+        void SaveNow();
+
+    private:
+        const app::Application& application_;
+        std::filesystem::path path_;
+        std::chrono::milliseconds period_;
+        std::chrono::milliseconds since_save_{};
+        Journal* journal_;
+        const records::RecordsStore* records_;
+
+        // Передний буфер заполняется только в api strand, задний - читает только фоновый поток
+        app::ApplicationSnapshot front_;
+        app::ApplicationSnapshot back_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool writing_ = false;
+        std::jthread writer_;
+
+        void Run(std::stop_token stop);
+
+        void Capture();
+
+        void Write(const app::ApplicationSnapshot& snapshot) const noexcept;
+    };
+}  // namespace serialization
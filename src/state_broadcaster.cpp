@@ -0,0 +1,128 @@
+#include "state_broadcaster.h"
+
+#include "json_loader.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace http_handler
+{
+    void StateBroadcaster::Subscribe(std::shared_ptr<http_server::WebSocketSession> session, const app::Player& player)
+    {
+        subscribers_[&player.GetSession()].push_back({ std::move(session), player.GetId() });
+    }
+
+    void StateBroadcaster::OnTick([[maybe_unused]] std::chrono::milliseconds delta)
+    {
+        for (auto& [game_session, subscribers] : subscribers_)
+        {
+            std::erase_if(subscribers, [](const Subscriber& subscriber)
+            {
+                auto session = subscriber.session.lock();
+                return !session || session->IsClosed();
+            });
+            if (subscribers.empty())
+            {
+                continue;
+            }
+
+            const auto version = game_session->GetVersion();
+            const auto changes = game_session->GetChangesSince(version - 1);
+            if (game_session->GetViewRadius() > 0.0)
+            {
+                BroadcastInterest(*game_session, subscribers, changes.value_or(std::vector<model::Dog::Id>{}));
+            }
+            else
+            {
+                Broadcast(*game_session, subscribers, changes);
+            }
+
+            // Собака подписчика покинула игру, и его токен больше не действует: соединение закрывается.
+            // Без радиуса обзора подписчик успевает получить кадр, в котором его собака пришла как null
+            std::erase_if(subscribers, [game = game_session](const Subscriber& subscriber)
+            {
+                if (game->FindDog(subscriber.dog_id))
+                {
+                    return false;
+                }
+                if (auto session = subscriber.session.lock())
+                {
+                    session->Close();
+                }
+                return true;
+            });
+        }
+    }
+
+    void StateBroadcaster::Broadcast(const model::GameSession& game_session, std::vector<Subscriber>& subscribers,
+        const std::optional<std::vector<model::Dog::Id>>& changes)
+    {
+        const bool loot_changed = game_session.GetLootVersion() == game_session.GetVersion();
+        const Frame delta = std::make_shared<const std::string>(boost::json::serialize(
+            json_loader::MakeJsonResponseState(game_session, changes, loot_changed)));
+        Frame full;
+
+        for (const Subscriber& subscriber : subscribers)
+        {
+            auto session = subscriber.session.lock();
+            if (!session)
+            {
+                continue;
+            }
+            if (session->NeedsKeyFrame())
+            {
+                if (!full)
+                {
+                    full = std::make_shared<const std::string>(boost::json::serialize(
+                        json_loader::MakeJsonResponseState(game_session, std::nullopt)));
+                }
+                session->Push(full, true);
+            }
+            else
+            {
+                session->Push(delta, false);
+            }
+        }
+    }
+
+    void StateBroadcaster::BroadcastInterest(const model::GameSession& game_session,
+        std::vector<Subscriber>& subscribers, const std::vector<model::Dog::Id>& changes)
+    {
+        cell_frames_.clear();
+        for (Subscriber& subscriber : subscribers)
+        {
+            auto session = subscriber.session.lock();
+            const model::Dog* dog = game_session.FindDog(subscriber.dog_id);
+            if (!session || !dog)
+            {
+                continue;
+            }
+
+            const auto cell = game_session.GetInterestCell(*dog);
+            CellFrames& frames = cell_frames_[cell];
+            const bool key_frame = session->NeedsKeyFrame() || subscriber.cell != cell;
+            subscriber.cell = cell;
+            Frame& frame = key_frame ? frames.full : frames.delta;
+            if (!frame)
+            {
+                const auto visible = game_session.FindDogsAroundCell(cell);
+                const auto visible_loot = game_session.FindLootAroundCell(cell);
+                if (key_frame)
+                {
+                    frame = std::make_shared<const std::string>(boost::json::serialize(
+                        json_loader::MakeJsonResponseState(game_session, visible, true, &visible, &visible_loot)));
+                }
+                else
+                {
+                    std::vector<model::Dog::Id> visible_changes;
+                    std::set_intersection(changes.begin(), changes.end(), visible.begin(), visible.end(),
+                        std::back_inserter(visible_changes));
+                    frame = std::make_shared<const std::string>(boost::json::serialize(
+                        json_loader::MakeJsonResponseState(game_session, visible_changes, false, &visible,
+                            &visible_loot)));
+                }
+            }
+            session->Push(frame, key_frame);
+        }
+    }
+}  // namespace http_handler
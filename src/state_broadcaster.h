@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "application.h"
+#include "websocket_session.h"
+
+namespace http_handler
+{
+    // Рассылает подписчикам WebSocket состояние игровых сеансов после каждого тика.
+    // Кадр каждой карты сериализуется один раз за тик и разделяется между всеми её подписчиками.
+    // Опорный кадр с полным состоянием сериализуется, только если он нужен хотя бы одному подписчику.
+    // Если у сеанса задан радиус обзора, кадры строятся для ячеек сетки интереса: подписчик получает
+    // собак и трофеи из ячейки своей собаки и соседних с ней, а кадр разделяется между подписчиками одной ячейки.
+    // Когда собака подписчика переходит в другую ячейку, он получает опорный кадр новой ячейки: в обзор попадают
+    // и стоящие собаки, которых нет в наборе изменений.
+    // Подписчик, собака которого покинула игру, удаляется из рассылки, а его соединение закрывается.
+    // Все методы вызываются в api strand
+    class StateBroadcaster : public app::ApplicationListener
+    {
+    public:
+        void Subscribe(std::shared_ptr<http_server::WebSocketSession> session, const app::Player& player);
+
+        void OnTick(std::chrono::milliseconds delta) override;
+
+    private:
+        struct Subscriber
+        {
+            std::weak_ptr<http_server::WebSocketSession> session;
+            model::Dog::Id dog_id;
+            // Ячейка сетки интереса, для которой подписчику отправлен последний кадр
+            std::optional<model::InterestGrid::Cell> cell;
+        };
+
+        using Frame = http_server::WebSocketSession::Frame;
+
+        struct CellFrames
+        {
+            Frame delta;
+            Frame full;
+        };
+
+        std::unordered_map<const model::GameSession*, std::vector<Subscriber>> subscribers_;
+        // Кадры ячеек текущего тика. Очищается перед обработкой каждого сеанса
+        std::unordered_map<model::InterestGrid::Cell, CellFrames, model::InterestGrid::CellHasher> cell_frames_;
+
+        void Broadcast(const model::GameSession& game_session, std::vector<Subscriber>& subscribers,
+            const std::optional<std::vector<model::Dog::Id>>& changes);
+
+        void BroadcastInterest(const model::GameSession& game_session, std::vector<Subscriber>& subscribers,
+            const std::vector<model::Dog::Id>& changes);
+    };
+}  // namespace http_handler
@@ -0,0 +1,269 @@
+#include "state_serialization.h"
+
+#include "binary_io.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <system_error>
+
+namespace serialization
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        constexpr std::string_view MAGIC = "GSNP"sv;
+        constexpr std::uint32_t FORMAT_VERSION = 3;
+
+        void WriteSession(BinaryWriter& writer, const model::GameSessionSnapshot& session)
+        {
+            writer.String(*session.map_id);
+            writer.Pod(session.version);
+            writer.Pod(session.loot_version);
+            writer.Pod(session.next_dog_id);
+            writer.Pod(session.next_loot_id);
+            std::ostringstream random;
+            random << session.random;
+            writer.String(random.str());
+            writer.Pod(static_cast<std::int64_t>(session.time_without_loot.count()));
+
+            const movement::DogsState& state = session.state;
+            writer.Size(state.Size());
+            for (const auto* values : { &state.x, &state.y, &state.vx, &state.vy,
+                     &state.min_x, &state.max_x, &state.min_y, &state.max_y })
+            {
+                writer.Doubles(*values);
+            }
+            for (const model::Dog& dog : session.dogs)
+            {
+                writer.Pod(*dog.GetId());
+                writer.String(dog.GetName());
+                writer.Pod(static_cast<std::uint8_t>(dog.GetDirection()));
+                writer.Pod(static_cast<std::int32_t>(dog.GetScore()));
+                writer.Pod(static_cast<std::int64_t>(dog.GetPlayTime().count()));
+                writer.Pod(static_cast<std::int64_t>(dog.GetIdleTime().count()));
+                writer.Size(dog.GetBag().size());
+                for (const model::FoundObject& object : dog.GetBag())
+                {
+                    writer.Pod(*object.id);
+                    writer.Pod(static_cast<std::uint64_t>(object.type));
+                }
+            }
+
+            writer.Size(session.loot.size());
+            for (const model::LostObject& object : session.loot)
+            {
+                writer.Pod(*object.id);
+                writer.Pod(static_cast<std::uint64_t>(object.type));
+                writer.Pod(object.position.x);
+                writer.Pod(object.position.y);
+            }
+        }
+
+        model::GameSessionSnapshot ReadSession(BinaryReader& reader)
+        {
+            model::GameSessionSnapshot session;
+            session.map_id = model::Map::Id{ reader.String() };
+            session.version = reader.Pod<std::uint64_t>();
+            session.loot_version = reader.Pod<std::uint64_t>();
+            session.next_dog_id = reader.Pod<std::uint32_t>();
+            session.next_loot_id = reader.Pod<std::uint32_t>();
+            std::istringstream random{ reader.String() };
+            random >> session.random;
+            if (!random)
+            {
+                throw std::runtime_error("Snapshot has corrupted random generator state");
+            }
+            session.time_without_loot = std::chrono::milliseconds{ reader.Pod<std::int64_t>() };
+
+            movement::DogsState& state = session.state;
+            const size_t dogs_count = reader.Size();
+            for (auto* values : { &state.x, &state.y, &state.vx, &state.vy,
+                     &state.min_x, &state.max_x, &state.min_y, &state.max_y })
+            {
+                reader.Doubles(*values, dogs_count);
+            }
+            session.dogs.reserve(dogs_count);
+            for (size_t i = 0; i < dogs_count; ++i)
+            {
+                const model::Dog::Id id{ reader.Pod<std::uint32_t>() };
+                model::Dog& dog = session.dogs.emplace_back(id, reader.String(), i);
+                const auto direction = reader.Pod<std::uint8_t>();
+                if (direction > static_cast<std::uint8_t>(model::Direction::EAST))
+                {
+                    throw std::runtime_error("Snapshot has invalid dog direction");
+                }
+                dog.SetDirection(static_cast<model::Direction>(direction));
+                dog.SetScore(reader.Pod<std::int32_t>());
+                const std::chrono::milliseconds play_time{ reader.Pod<std::int64_t>() };
+                dog.SetTimes(play_time, std::chrono::milliseconds{ reader.Pod<std::int64_t>() });
+                const size_t bag_size = reader.Size();
+                for (size_t j = 0; j < bag_size; ++j)
+                {
+                    const model::LostObject::Id object_id{ reader.Pod<std::uint32_t>() };
+                    dog.PutToBag({ object_id, static_cast<size_t>(reader.Pod<std::uint64_t>()) });
+                }
+            }
+
+            const size_t loot_count = reader.Size();
+            session.loot.reserve(loot_count);
+            for (size_t i = 0; i < loot_count; ++i)
+            {
+                const model::LostObject::Id id{ reader.Pod<std::uint32_t>() };
+                const auto type = static_cast<size_t>(reader.Pod<std::uint64_t>());
+                const double x = reader.Pod<double>();
+                const double y = reader.Pod<double>();
+                session.loot.push_back({ id, type, { x, y } });
+            }
+            return session;
+        }
+    }  // namespace
+
+    void WriteSnapshot(std::string& out, const app::ApplicationSnapshot& snapshot)
+    {
+        out.clear();
+        BinaryWriter writer{ out };
+        out.append(MAGIC);
+        writer.Pod(FORMAT_VERSION);
+        writer.Pod(snapshot.journal_sequence);
+        writer.Pod(snapshot.next_record_id);
+        writer.Size(snapshot.sessions.size());
+        for (const auto& session : snapshot.sessions)
+        {
+            WriteSession(writer, session);
+        }
+        writer.Size(snapshot.players.size());
+        for (const auto& player : snapshot.players)
+        {
+            writer.String(*player.token);
+            writer.String(*player.map_id);
+            writer.Pod(*player.dog_id);
+        }
+        writer.Pod(Fnv1a(out));
+    }
+
+    app::ApplicationSnapshot ReadSnapshot(std::string_view data)
+    {
+        constexpr size_t CHECKSUM_SIZE = sizeof(std::uint64_t);
+        if (data.size() < MAGIC.size() + sizeof(FORMAT_VERSION) + CHECKSUM_SIZE || !data.starts_with(MAGIC))
+        {
+            throw std::runtime_error("Not a game state snapshot");
+        }
+        const std::string_view payload = data.substr(0, data.size() - CHECKSUM_SIZE);
+        BinaryReader tail{ data.substr(payload.size()) };
+        if (tail.Pod<std::uint64_t>() != Fnv1a(payload))
+        {
+            throw std::runtime_error("Snapshot checksum mismatch");
+        }
+
+        BinaryReader reader{ payload.substr(MAGIC.size()) };
+        if (reader.Pod<std::uint32_t>() != FORMAT_VERSION)
+        {
+            throw std::runtime_error("Unsupported snapshot format version");
+        }
+
+        app::ApplicationSnapshot snapshot;
+        snapshot.journal_sequence = reader.Pod<std::uint64_t>();
+        snapshot.next_record_id = reader.Pod<std::uint64_t>();
+        const size_t sessions_count = reader.Size();
+        snapshot.sessions.reserve(sessions_count);
+        for (size_t i = 0; i < sessions_count; ++i)
+        {
+            snapshot.sessions.push_back(ReadSession(reader));
+        }
+        const size_t players_count = reader.Size();
+        snapshot.players.reserve(players_count);
+        for (size_t i = 0; i < players_count; ++i)
+        {
+            app::PlayerSnapshot& player = snapshot.players.emplace_back();
+            player.token = app::Token{ reader.String() };
+            player.map_id = model::Map::Id{ reader.String() };
+            player.dog_id = model::Dog::Id{ reader.Pod<std::uint32_t>() };
+        }
+        if (!reader.AtEnd())
+        {
+            throw std::runtime_error("Snapshot has trailing data");
+        }
+        return snapshot;
+    }
+
+    void WriteAll(int fd, std::string_view data, const std::filesystem::path& path)
+    {
+        while (!data.empty())
+        {
+            const ssize_t written = ::write(fd, data.data(), data.size());
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "Failed to write " + path.string());
+            }
+            data.remove_prefix(static_cast<size_t>(written));
+        }
+    }
+
+    void SyncParentDirectory(const std::filesystem::path& path) noexcept
+    {
+        const std::filesystem::path dir = path.has_parent_path() ? path.parent_path() : std::filesystem::path{ "." };
+        if (const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); dir_fd >= 0)
+        {
+            ::fsync(dir_fd);
+            ::close(dir_fd);
+        }
+    }
+
+    void SaveSnapshotFile(const std::filesystem::path& path, const app::ApplicationSnapshot& snapshot)
+    {
+        std::string data;
+        WriteSnapshot(data, snapshot);
+
+        std::filesystem::path temp_path = path;
+        temp_path += ".tmp";
+        const int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), "Failed to create " + temp_path.string());
+        }
+        try
+        {
+            WriteAll(fd, data, temp_path);
+            // Данные должны оказаться на диске раньше, чем переименование сделает файл видимым
+            if (::fsync(fd) != 0)
+            {
+                throw std::system_error(errno, std::generic_category(), "Failed to sync " + temp_path.string());
+            }
+        }
+        catch (...)
+        {
+            ::close(fd);
+            std::filesystem::remove(temp_path);
+            throw;
+        }
+        ::close(fd);
+        std::filesystem::rename(temp_path, path);
+
+        SyncParentDirectory(path);
+    }
+
+    std::optional<app::ApplicationSnapshot> LoadSnapshotFile(const std::filesystem::path& path)
+    {
+        if (!std::filesystem::exists(path))
+        {
+            return std::nullopt;
+        }
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            throw std::runtime_error("Failed to open " + path.string());
+        }
+        const std::string data{ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} };
+        return ReadSnapshot(data);
+    }
+}  // namespace serialization
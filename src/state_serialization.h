@@ -0,0 +1,31 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "application.h"
+
+namespace serialization
+{
+    // Компактный двоичный формат снимка: сигнатура, версия формата, затем поля в порядке объявления.
+    // Числа записываются в порядке байтов машины, строки и массивы - с 32-битной длиной впереди.
+    // Файл предназначен для перезапуска того же сервера, а не для переноса между платформами
+    void WriteSnapshot(std::string& out, const app::ApplicationSnapshot& snapshot);
+
+    // Бросает std::runtime_error, если данные повреждены или записаны другой версией формата
+    app::ApplicationSnapshot ReadSnapshot(std::string_view data);
+
+    // Записывает снимок во временный файл рядом с path, сбрасывает его на диск и атомарно
+    // заменяет им path. При сбое на любом шаге прежний файл остаётся нетронутым
+    void SaveSnapshotFile(const std::filesystem::path& path, const app::ApplicationSnapshot& snapshot);
+
+    // std::nullopt, если файла нет
+    std::optional<app::ApplicationSnapshot> LoadSnapshotFile(const std::filesystem::path& path);
+
+    // Записывает data в файловый дескриптор целиком, повторяя прерванные вызовы write
+    void WriteAll(int fd, std::string_view data, const std::filesystem::path& path);
+
+    // Сбрасывает на диск каталог файла, чтобы создание или переименование файла пережило сбой питания
+    void SyncParentDirectory(const std::filesystem::path& path) noexcept;
+}  // namespace serialization
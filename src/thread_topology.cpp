@@ -0,0 +1,226 @@
+#include "thread_topology.h"
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+
+namespace thread_topology
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        unsigned ParseCpu(std::string_view text, std::string_view list)
+        {
+            unsigned cpu = 0;
+            const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), cpu);
+            if (text.empty() || ec != std::errc{} || end != text.data() + text.size() || cpu >= CPU_SETSIZE)
+            {
+                throw std::invalid_argument("Invalid CPU list "s + std::string{ list });
+            }
+            return cpu;
+        }
+
+        // Процессоры, за которыми действительно закреплены потоки группы
+        std::set<unsigned> UsedCpus(const Group& group)
+        {
+            std::set<unsigned> cpus;
+            for (unsigned i = 0; i < group.threads && i < group.cpus.size(); ++i)
+            {
+                cpus.insert(group.cpus[i]);
+            }
+            return cpus;
+        }
+
+        template <typename Container>
+        std::string Join(const Container& values)
+        {
+            std::string result;
+            for (const auto value : values)
+            {
+                result += (result.empty() ? ""s : ","s) + std::to_string(value);
+            }
+            return result;
+        }
+
+        // Список процессоров в формате cpuset
+        std::string FormatCpus(const std::set<unsigned>& cpus)
+        {
+            std::string result;
+            for (auto it = cpus.begin(); it != cpus.end();)
+            {
+                const unsigned first = *it;
+                unsigned last = first;
+                while (++it != cpus.end() && *it == last + 1)
+                {
+                    ++last;
+                }
+                result += (result.empty() ? ""s : ","s) + std::to_string(first);
+                if (last != first)
+                {
+                    result += "-"s + std::to_string(last);
+                }
+            }
+            return result;
+        }
+
+        std::set<int> Nodes(const std::set<unsigned>& cpus)
+        {
+            std::set<int> nodes;
+            for (const unsigned cpu : cpus)
+            {
+                nodes.insert(NodeOfCpu(cpu));
+            }
+            return nodes;
+        }
+    }  // namespace
+
+    std::vector<unsigned> ParseCpuList(std::string_view list)
+    {
+        std::vector<unsigned> cpus;
+        std::string_view rest = list;
+        while (!rest.empty())
+        {
+            const size_t comma = rest.find(',');
+            const std::string_view item = rest.substr(0, comma);
+            rest = comma == std::string_view::npos ? ""sv : rest.substr(comma + 1);
+            const size_t dash = item.find('-');
+            const unsigned first = ParseCpu(item.substr(0, dash), list);
+            const unsigned last = dash == std::string_view::npos ? first : ParseCpu(item.substr(dash + 1), list);
+            if (last < first)
+            {
+                throw std::invalid_argument("Invalid CPU list "s + std::string{ list });
+            }
+            for (unsigned cpu = first; cpu <= last; ++cpu)
+            {
+                if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end())
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        if (cpus.empty())
+        {
+            throw std::invalid_argument("Empty CPU list"s);
+        }
+        return cpus;
+    }
+
+    int NodeOfCpu(unsigned cpu)
+    {
+        // Каталог процессора содержит ссылку nodeN на его узел
+        std::error_code ec;
+        const std::filesystem::path dir = "/sys/devices/system/cpu/cpu"s + std::to_string(cpu);
+        for (std::filesystem::directory_iterator it{ dir, ec }, end; !ec && it != end; it.increment(ec))
+        {
+            const std::string name = it->path().filename().string();
+            int node = -1;
+            if (name.starts_with("node"sv)
+                && std::from_chars(name.data() + 4, name.data() + name.size(), node).ptr == name.data() + name.size())
+            {
+                return node;
+            }
+        }
+        return -1;
+    }
+
+    std::optional<unsigned> CpuOf(const Group& group, unsigned index) noexcept
+    {
+        if (group.cpus.empty())
+        {
+            return std::nullopt;
+        }
+        return group.cpus[index % group.cpus.size()];
+    }
+
+    std::string PinCurrentThread(unsigned cpu)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (const int error = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set); error != 0)
+        {
+            return "cannot pin thread to cpu "s + std::to_string(cpu) + ": "s + std::strerror(error);
+        }
+        const int node = NodeOfCpu(cpu);
+        if (node < 0 || node >= 63)
+        {
+            return {};
+        }
+        // Ядро читает maxnode - 1 бит маски
+        const unsigned long mask = 1ul << node;
+        if (::syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, sizeof(mask) * 8) != 0)
+        {
+            return "cannot prefer NUMA node "s + std::to_string(node) + " for cpu "s + std::to_string(cpu) + ": "s
+                + std::strerror(errno);
+        }
+        return {};
+    }
+
+    std::vector<std::string> Describe(const std::vector<Group>& groups)
+    {
+        std::vector<std::string> lines;
+        for (const Group& group : groups)
+        {
+            std::string line = group.name + ": "s + std::to_string(group.threads) + " threads"s;
+            const std::set<unsigned> cpus = UsedCpus(group);
+            if (cpus.empty())
+            {
+                line += group.threads != 0 ? ", not pinned"s : ""s;
+            }
+            else
+            {
+                const std::set<int> nodes = Nodes(cpus);
+                line += " on cpus "s + FormatCpus(cpus);
+                line += nodes.count(-1) != 0 ? " (NUMA node unknown)"s
+                    : (nodes.size() == 1 ? " (NUMA node "s : " (NUMA nodes "s) + Join(nodes) + ")"s;
+            }
+            lines.push_back(std::move(line));
+        }
+        return lines;
+    }
+
+    std::vector<std::string> Check(const std::vector<Group>& groups)
+    {
+        std::vector<std::string> warnings;
+        for (size_t i = 0; i < groups.size(); ++i)
+        {
+            const Group& group = groups[i];
+            const std::set<unsigned> cpus = UsedCpus(group);
+            if (const std::set<int> nodes = Nodes(cpus); nodes.size() > 1 && nodes.count(-1) == 0)
+            {
+                warnings.push_back(group.name + " threads span NUMA nodes "s + Join(nodes)
+                    + ": memory freed on one socket is reused by threads on another"s);
+            }
+            if (!group.cpus.empty() && group.threads > group.cpus.size())
+            {
+                warnings.push_back(group.name + ": "s + std::to_string(group.threads) + " threads share "s
+                    + std::to_string(group.cpus.size()) + " cpus"s);
+            }
+            for (size_t j = i + 1; j < groups.size(); ++j)
+            {
+                std::set<unsigned> shared;
+                const std::set<unsigned> other = UsedCpus(groups[j]);
+                std::set_intersection(cpus.begin(), cpus.end(), other.begin(), other.end(),
+                    std::inserter(shared, shared.end()));
+                if (!shared.empty())
+                {
+                    warnings.push_back("cpus "s + FormatCpus(shared) + " are shared by "s + group.name + " and "s
+                        + groups[j].name + " threads"s);
+                }
+            }
+        }
+        return warnings;
+    }
+}  // namespace thread_topology
@@ -0,0 +1,37 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace thread_topology
+{
+    // Группа рабочих потоков с общим назначением и набором процессоров
+    struct Group
+    {
+        std::string name;
+        unsigned threads = 0;
+        // Поток i группы закрепляется за процессором cpus[i % cpus.size()]. Пустой набор - потоки размещает ОС
+        std::vector<unsigned> cpus;
+    };
+
+    // Разбирает список процессоров в формате cpuset, например "0-7,16-23". Выбрасывает std::invalid_argument
+    std::vector<unsigned> ParseCpuList(std::string_view list);
+
+    // Узел NUMA процессора или -1, если он неизвестен
+    int NodeOfCpu(unsigned cpu);
+
+    // Процессор потока index группы или nullopt, если потоки группы не закрепляются
+    std::optional<unsigned> CpuOf(const Group& group, unsigned index) noexcept;
+
+    // Закрепляет вызывающий поток за процессором и делает узел NUMA процессора предпочтительным для памяти,
+    // которую поток выделяет первым: пулы памяти потока, его буферы и стек оказываются на том же сокете.
+    // Возвращает описание ошибки или пустую строку
+    std::string PinCurrentThread(unsigned cpu);
+
+    // Размещение групп для журнала: по строке на группу
+    std::vector<std::string> Describe(const std::vector<Group>& groups);
+
+    // Предупреждения о размещении: группа на нескольких узлах NUMA, процессоры, общие для групп
+    std::vector<std::string> Check(const std::vector<Group>& groups);
+}  // namespace thread_topology
@@ -0,0 +1,74 @@
+#pragma once
+#include "sdk.h"
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace app
+{
+    namespace net = boost::asio;
+    namespace sys = boost::system;
+
+    // Периодически вызывает обработчик в заданном strand, передавая время, прошедшее с предыдущего вызова
+    class Ticker : public std::enable_shared_from_this<Ticker>
+    {
+    public:
+        using Strand = net::strand<net::io_context::executor_type>;
+        using Handler = std::function<void(std::chrono::milliseconds delta)>;
+
+        Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
+            : strand_{ strand }
+            , timer_{ strand_ }
+            , period_{ period }
+            , handler_{ std::move(handler) }
+        {}
+
+        void Start()
+        {
+            net::dispatch(strand_, [self = shared_from_this()]
+            {
+                self->last_tick_ = Clock::now();
+                self->ScheduleTick();
+            });
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        Strand strand_;
+        net::steady_timer timer_;
+        std::chrono::milliseconds period_;
+        Handler handler_;
+        Clock::time_point last_tick_;
+
+        void ScheduleTick()
+        {
+            timer_.expires_after(period_);
+            timer_.async_wait(net::bind_executor(strand_, [self = shared_from_this()](sys::error_code ec)
+            {
+                self->OnTick(ec);
+            }));
+        }
+
+        void OnTick(sys::error_code ec)
+        {
+            if (ec)
+            {
+                return;
+            }
+            const auto now = Clock::now();
+            const auto delta = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_tick_);
+            // Дробная часть миллисекунды переносится на следующий тик
+            last_tick_ += delta;
+            handler_(delta);
+            ScheduleTick();
+        }
+    };
+}  // namespace app
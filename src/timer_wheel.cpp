@@ -0,0 +1,152 @@
+#include "timer_wheel.h"
+
+#include <sys/socket.h>
+
+#include <algorithm>
+
+namespace timer_wheel
+{
+    using namespace std::literals;
+
+    //------------------Deadline----------------
+    void Deadline::Arm(std::chrono::milliseconds timeout)
+    {
+        if (!wheel_ || Expired())
+        {
+            return;
+        }
+        const auto tick = wheel_->tick_.count();
+        const auto ticks = static_cast<std::uint64_t>((std::max(timeout.count(), decltype(tick){ 0 }) + tick - 1) / tick);
+        // Текущий тик уже частично прошёл, поэтому срок не истекает раньше timeout
+        const std::uint64_t deadline = wheel_->current_.load(std::memory_order_acquire) + ticks + 1;
+        // Порядок seq_cst согласован с обходом слота в Advance: либо колесо увидит новый срок,
+        // либо Arm увидит, что запись уже покинула слот, и поставит её заново
+        deadline_.store(deadline);
+        if (slot_tick_.load() > deadline)
+        {
+            wheel_->Schedule(*this);
+        }
+    }
+
+    void Deadline::Cancel() noexcept
+    {
+        if (wheel_)
+        {
+            Disarm();
+            wheel_->Remove(*this);
+        }
+    }
+
+    //------------------Wheel----------------
+    Wheel::Wheel(const Settings& settings)
+        : start_{ Clock::now() }
+        , tick_{ std::max(settings.tick, 1ms) }
+        , slots_(std::max<std::size_t>(settings.slots, 2), nullptr)
+    {}
+
+    std::size_t Wheel::Advance(Clock::time_point now)
+    {
+        if (now < start_)
+        {
+            return 0;
+        }
+        const auto target = static_cast<std::uint64_t>((now - start_) / tick_);
+        std::size_t expired = 0;
+        std::lock_guard lock{ mutex_ };
+        for (std::uint64_t tick = current_.load(std::memory_order_relaxed) + 1; tick <= target; ++tick)
+        {
+            current_.store(tick, std::memory_order_release);
+            // Слот отсоединяется целиком: записи с более поздним сроком в том же слоте ждут следующего оборота
+            Deadline* entry = std::exchange(slots_[tick % slots_.size()], nullptr);
+            while (entry)
+            {
+                Deadline* next = entry->next_;
+                entry->prev_ = nullptr;
+                entry->next_ = nullptr;
+                entry->slot_tick_.store(Deadline::NEVER);
+                expired += Expire(*entry);
+                entry = next;
+            }
+        }
+        return expired;
+    }
+
+    void Wheel::Schedule(Deadline& entry)
+    {
+        std::lock_guard lock{ mutex_ };
+        const std::uint64_t deadline = entry.deadline_.load(std::memory_order_acquire);
+        if (deadline == Deadline::NEVER || entry.slot_tick_.load(std::memory_order_relaxed) <= deadline)
+        {
+            return;
+        }
+        Unlink(entry);
+        Link(entry, deadline);
+    }
+
+    void Wheel::Remove(Deadline& entry) noexcept
+    {
+        std::lock_guard lock{ mutex_ };
+        Unlink(entry);
+    }
+
+    void Wheel::Link(Deadline& entry, std::uint64_t tick) noexcept
+    {
+        tick = std::max(tick, current_.load(std::memory_order_relaxed) + 1);
+        Deadline*& head = slots_[tick % slots_.size()];
+        entry.prev_ = nullptr;
+        entry.next_ = head;
+        if (head)
+        {
+            head->prev_ = &entry;
+        }
+        head = &entry;
+        entry.slot_tick_.store(tick, std::memory_order_release);
+    }
+
+    void Wheel::Unlink(Deadline& entry) noexcept
+    {
+        const std::uint64_t tick = entry.slot_tick_.load(std::memory_order_relaxed);
+        if (tick == Deadline::NEVER)
+        {
+            return;
+        }
+        if (entry.prev_)
+        {
+            entry.prev_->next_ = entry.next_;
+        }
+        else
+        {
+            slots_[tick % slots_.size()] = entry.next_;
+        }
+        if (entry.next_)
+        {
+            entry.next_->prev_ = entry.prev_;
+        }
+        entry.prev_ = nullptr;
+        entry.next_ = nullptr;
+        entry.slot_tick_.store(Deadline::NEVER, std::memory_order_release);
+    }
+
+    bool Wheel::Expire(Deadline& entry) noexcept
+    {
+        const std::uint64_t current = current_.load(std::memory_order_relaxed);
+        std::uint64_t deadline = entry.deadline_.load();
+        do
+        {
+            if (deadline == Deadline::NEVER)
+            {
+                // Срок снят: запись покидает колесо до следующего Arm
+                return false;
+            }
+            if (deadline > current)
+            {
+                Link(entry, deadline);
+                return false;
+            }
+            // Соединение может одновременно назначить новый срок: тогда запись переставляется, а не истекает
+        } while (!entry.deadline_.compare_exchange_weak(deadline, Deadline::NEVER, std::memory_order_acq_rel));
+        entry.expired_.store(true, std::memory_order_release);
+        ::shutdown(entry.socket_, SHUT_RDWR);
+        return true;
+    }
+}  // namespace timer_wheel
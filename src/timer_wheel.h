@@ -0,0 +1,157 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace timer_wheel
+{
+    class Wheel;
+
+    // Срок текущей операции соединения. Назначение и снятие срока не выделяют памяти и обычно не захватывают
+    // колесо: Arm и Disarm только записывают срок, а колесо переносит запись в нужный слот, когда обходит слот,
+    // в котором она находится. Колесо захватывается, только если запись не стоит ни в одном слоте
+    // или новый срок раньше её слота. По истечении срока колесо закрывает сокет (shutdown),
+    // и ожидающая операция соединения завершается с ошибкой
+    class Deadline
+    {
+    public:
+        // Срок без колеса не отслеживается
+        Deadline() = default;
+
+        Deadline(Wheel* wheel, int socket) noexcept
+            : wheel_{ wheel }
+            , socket_{ socket }
+        {}
+
+        Deadline(const Deadline&) = delete;
+        Deadline& operator=(const Deadline&) = delete;
+
+        ~Deadline()
+        {
+            Cancel();
+        }
+
+        bool Bound() const noexcept
+        {
+            return wheel_ != nullptr;
+        }
+
+        // Назначает срок через timeout от текущего тика колеса
+        void Arm(std::chrono::milliseconds timeout);
+
+        // Снимает срок. Запись удаляется из колеса при обходе её слота
+        void Disarm() noexcept
+        {
+            deadline_.store(NEVER, std::memory_order_release);
+        }
+
+        // Удаляет запись из колеса. После вызова колесо не обращается к сокету
+        void Cancel() noexcept;
+
+        // Колесо закрыло сокет по истечении срока
+        bool Expired() const noexcept
+        {
+            return expired_.load(std::memory_order_acquire);
+        }
+
+    private:
+        friend class Wheel;
+
+        static constexpr std::uint64_t NEVER = UINT64_MAX;
+
+        Wheel* wheel_ = nullptr;
+        int socket_ = -1;
+        // Тик, в котором истекает срок
+        std::atomic<std::uint64_t> deadline_{ NEVER };
+        // Тик слота, в котором стоит запись (NEVER - запись не в колесе). Изменяется под блокировкой колеса
+        std::atomic<std::uint64_t> slot_tick_{ NEVER };
+        std::atomic<bool> expired_{ false };
+        Deadline* prev_ = nullptr;
+        Deadline* next_ = nullptr;
+    };
+
+    // Хешированное колесо таймеров: слот записи - тик её срока по модулю числа слотов. Запись, срок которой
+    // дальше одного оборота колеса, проверяется при каждом обороте. Точность - от одного до двух тиков.
+    // Каждый рабочий поток сервера держит своё колесо для соединений, которые он создал. Обработчики соединения
+    // и продвижение колеса могут выполняться в других потоках, поэтому слоты защищены блокировкой,
+    // которую почти всегда захватывает только один поток
+    class Wheel
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Settings
+        {
+            std::chrono::milliseconds tick{ 100 };
+            std::size_t slots = 1024;
+        };
+
+        explicit Wheel(const Settings& settings);
+
+        Wheel(const Wheel&) = delete;
+        Wheel& operator=(const Wheel&) = delete;
+
+        // Обходит слоты тиков до момента now включительно и закрывает сокеты записей с истёкшим сроком.
+        // Возвращает количество истёкших записей
+        std::size_t Advance(Clock::time_point now);
+
+        std::chrono::milliseconds GetTick() const noexcept
+        {
+            return tick_;
+        }
+
+    private:
+        friend class Deadline;
+
+        Clock::time_point start_;
+        std::chrono::milliseconds tick_;
+        // Последний обойдённый тик
+        std::atomic<std::uint64_t> current_{ 0 };
+        std::mutex mutex_;
+        std::vector<Deadline*> slots_;
+
+        // Ставит запись в слот её срока, если она ещё не стоит в более раннем слоте
+        void Schedule(Deadline& entry);
+        void Remove(Deadline& entry) noexcept;
+
+        // Требуют блокировки
+        void Link(Deadline& entry, std::uint64_t tick) noexcept;
+        void Unlink(Deadline& entry) noexcept;
+        bool Expire(Deadline& entry) noexcept;
+    };
+
+    namespace detail
+    {
+        inline thread_local Wheel* current = nullptr;
+    }  // namespace detail
+
+    // Колесо текущего рабочего потока или nullptr
+    inline Wheel* Current() noexcept
+    {
+        return detail::current;
+    }
+
+    // Делает колесо колесом потока на время жизни объекта
+    class Scope
+    {
+    public:
+        explicit Scope(Wheel* wheel) noexcept
+            : previous_{ std::exchange(detail::current, wheel) }
+        {}
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            detail::current = previous_;
+        }
+
+    private:
+        Wheel* previous_;
+    };
+}  // namespace timer_wheel
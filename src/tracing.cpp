@@ -0,0 +1,253 @@
+#include "tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tracing
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        // Ячейка буфера защищена счётчиком версий (seqlock): писатель не ждёт читателя,
+        // а читатель отбрасывает ячейку, перезаписанную во время чтения.
+        // Нечётная версия - ячейка записывается, 2 * (позиция + 1) - в ячейке интервал с этой позицией
+        struct Slot
+        {
+            std::atomic<std::uint64_t> version{ 0 };
+            std::atomic<const char*> name{ nullptr };
+            std::atomic<std::uint64_t> request{ 0 };
+            std::atomic<std::int64_t> start_ns{ 0 };
+            std::atomic<std::int64_t> end_ns{ 0 };
+        };
+
+        struct Interval
+        {
+            const char* name;
+            std::uint64_t request;
+            std::int64_t start_ns;
+            std::int64_t end_ns;
+        };
+
+        // Кольцевой буфер последних интервалов потока. Пишет только поток-владелец
+        class Ring
+        {
+        public:
+            Ring(size_t capacity, unsigned thread_index)
+                : slots_(capacity)
+                , thread_index_{ thread_index }
+            {}
+
+            void Push(const char* name, RequestId request, std::int64_t start_ns, std::int64_t end_ns) noexcept
+            {
+                const std::uint64_t position = next_.load(std::memory_order_relaxed);
+                Slot& slot = slots_[position % slots_.size()];
+                slot.version.store(2 * position + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.name.store(name, std::memory_order_relaxed);
+                slot.request.store(request, std::memory_order_relaxed);
+                slot.start_ns.store(start_ns, std::memory_order_relaxed);
+                slot.end_ns.store(end_ns, std::memory_order_relaxed);
+                slot.version.store(2 * (position + 1), std::memory_order_release);
+                next_.store(position + 1, std::memory_order_release);
+            }
+
+            void Collect(std::vector<Interval>& out) const
+            {
+                const std::uint64_t next = next_.load(std::memory_order_acquire);
+                const std::uint64_t first = next - std::min<std::uint64_t>(next, slots_.size());
+                for (std::uint64_t position = first; position < next; ++position)
+                {
+                    const Slot& slot = slots_[position % slots_.size()];
+                    const std::uint64_t version = slot.version.load(std::memory_order_acquire);
+                    Interval interval{ slot.name.load(std::memory_order_relaxed),
+                        slot.request.load(std::memory_order_relaxed),
+                        slot.start_ns.load(std::memory_order_relaxed),
+                        slot.end_ns.load(std::memory_order_relaxed) };
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (version == 2 * (position + 1) && slot.version.load(std::memory_order_relaxed) == version)
+                    {
+                        out.push_back(interval);
+                    }
+                }
+            }
+
+            unsigned GetThreadIndex() const noexcept
+            {
+                return thread_index_;
+            }
+
+        private:
+            std::vector<Slot> slots_;
+            unsigned thread_index_;
+            std::atomic<std::uint64_t> next_{ 0 };
+        };
+
+        struct Registry
+        {
+            std::atomic<std::uint64_t> sample_threshold{ 0 };
+            std::atomic<size_t> capacity{ 65536 };
+            std::atomic<RequestId> next_request{ 1 };
+
+            std::mutex mutex;
+            std::vector<std::shared_ptr<Ring>> rings;
+            // Выгрузки выполняются по одной
+            std::mutex flush_mutex;
+        };
+
+        Registry& GetRegistry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        Ring& LocalRing()
+        {
+            // Буфер создаётся при первом интервале потока, поэтому без трассировки память не расходуется
+            thread_local const std::shared_ptr<Ring> ring = []
+            {
+                Registry& registry = GetRegistry();
+                std::lock_guard lock{ registry.mutex };
+                auto ring = std::make_shared<Ring>(registry.capacity.load(std::memory_order_relaxed),
+                    static_cast<unsigned>(registry.rings.size()) + 1);
+                registry.rings.push_back(ring);
+                return ring;
+            }();
+            return *ring;
+        }
+
+        thread_local RequestId current_request = 0;
+
+        std::int64_t ToNanoseconds(Clock::time_point time) noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        }
+
+        void AppendMicroseconds(std::string& out, std::int64_t nanoseconds)
+        {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%lld.%03lld", static_cast<long long>(nanoseconds / 1000),
+                static_cast<long long>(nanoseconds % 1000));
+            out += buffer;
+        }
+    }  // namespace
+
+    RequestId detail::Sample() noexcept
+    {
+        // xorshift64: собственный генератор у каждого потока
+        thread_local std::uint64_t state = reinterpret_cast<std::uintptr_t>(&state) * 0x9E3779B97F4A7C15ull | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        Registry& registry = GetRegistry();
+        if (state > registry.sample_threshold.load(std::memory_order_relaxed))
+        {
+            return 0;
+        }
+        return registry.next_request.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Enable(double sample_rate, size_t interval_capacity)
+    {
+        if (!(sample_rate > 0.0 && sample_rate <= 1.0))
+        {
+            throw std::invalid_argument("Trace sample rate must be in (0, 1]");
+        }
+        Registry& registry = GetRegistry();
+        registry.sample_threshold.store(sample_rate == 1.0
+            ? std::numeric_limits<std::uint64_t>::max()
+            : static_cast<std::uint64_t>(std::ldexp(sample_rate, 64)), std::memory_order_relaxed);
+        registry.capacity.store(std::max<size_t>(interval_capacity, 1), std::memory_order_relaxed);
+        detail::enabled.store(true, std::memory_order_relaxed);
+    }
+
+    void Record(RequestId request, const char* name, Clock::time_point start, Clock::time_point end) noexcept
+    {
+        LocalRing().Push(name, request, ToNanoseconds(start), ToNanoseconds(end));
+    }
+
+    RequestId CurrentRequest() noexcept
+    {
+        return current_request;
+    }
+
+    RequestScope::RequestScope(RequestId request) noexcept
+        : previous_{ current_request }
+    {
+        current_request = request;
+    }
+
+    RequestScope::~RequestScope()
+    {
+        current_request = previous_;
+    }
+
+    size_t Flush(const std::filesystem::path& path)
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard flush_lock{ registry.flush_mutex };
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::lock_guard lock{ registry.mutex };
+            rings = registry.rings;
+        }
+
+        std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"s;
+        size_t count = 0;
+        std::vector<Interval> intervals;
+        for (const auto& ring : rings)
+        {
+            const std::string tid = std::to_string(ring->GetThreadIndex());
+            out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"sv;
+            out += tid;
+            out += ",\"args\":{\"name\":\"thread "sv;
+            out += tid;
+            out += "\"}}"sv;
+
+            intervals.clear();
+            ring->Collect(intervals);
+            for (const Interval& interval : intervals)
+            {
+                out += ",\n{\"name\":\""sv;
+                out += interval.name;
+                out += "\",\"cat\":\"http\",\"ph\":\"X\",\"pid\":1,\"tid\":"sv;
+                out += tid;
+                out += ",\"ts\":"sv;
+                AppendMicroseconds(out, interval.start_ns);
+                out += ",\"dur\":"sv;
+                AppendMicroseconds(out, std::max<std::int64_t>(interval.end_ns - interval.start_ns, 0));
+                out += ",\"args\":{\"request\":"sv;
+                out += std::to_string(interval.request);
+                out += "}}"sv;
+            }
+            count += intervals.size();
+            out += ",\n"sv;
+        }
+        if (out.ends_with(",\n"sv))
+        {
+            out.resize(out.size() - 2);
+        }
+        out += "\n]}\n"sv;
+
+        std::filesystem::path temp_path = path;
+        temp_path += ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            file.write(out.data(), static_cast<std::streamsize>(out.size()));
+            if (!file.flush())
+            {
+                throw std::runtime_error("Failed to write " + temp_path.string());
+            }
+        }
+        std::filesystem::rename(temp_path, path);
+        return count;
+    }
+}  // namespace tracing
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+namespace tracing
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Идентификатор запроса, выбранного для трассировки. 0 - запрос не трассируется
+    using RequestId = std::uint64_t;
+
+    // Трассировка запросов по фазам обработки. Интервалы (span) выбранных запросов записываются
+    // в кольцевые буферы потоков, где хранятся последние interval_capacity интервалов, и по требованию
+    // выгружаются в файл формата Chrome Trace Event, который открывается в Perfetto и chrome://tracing.
+    // Пока трассировка выключена, каждый запрос обходится одним чтением атомарного флага
+
+    namespace detail
+    {
+        inline std::atomic<bool> enabled{ false };
+
+        RequestId Sample() noexcept;
+    }  // namespace detail
+
+    // sample_rate - доля трассируемых запросов от 0 до 1
+    void Enable(double sample_rate, size_t interval_capacity = 65536);
+
+    // Решает, трассировать ли очередной запрос
+    inline RequestId SampleRequest() noexcept
+    {
+        return detail::enabled.load(std::memory_order_relaxed) ? detail::Sample() : 0;
+    }
+
+    // name должна быть строкой со статическим временем жизни
+    void Record(RequestId request, const char* name, Clock::time_point start, Clock::time_point end) noexcept;
+
+    // Записывает интервал от создания до уничтожения объекта
+    class Span
+    {
+    public:
+        Span(RequestId request, const char* name) noexcept
+            : request_{ request }
+            , name_{ name }
+        {
+            if (request_)
+            {
+                start_ = Clock::now();
+            }
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        ~Span()
+        {
+            if (request_)
+            {
+                Record(request_, name_, start_, Clock::now());
+            }
+        }
+
+    private:
+        RequestId request_;
+        const char* name_;
+        Clock::time_point start_;
+    };
+
+    // Запрос, обрабатываемый текущим потоком. Позволяет передать идентификатор через обработчики,
+    // которые о трассировке не знают
+    RequestId CurrentRequest() noexcept;
+
+    class RequestScope
+    {
+    public:
+        explicit RequestScope(RequestId request) noexcept;
+
+        RequestScope(const RequestScope&) = delete;
+        RequestScope& operator=(const RequestScope&) = delete;
+
+        ~RequestScope();
+
+    private:
+        RequestId previous_;
+    };
+
+    // Записывает накопленные интервалы в файл (через временный файл и переименование) и возвращает их количество.
+    // Может выполняться параллельно с записью интервалов
+    size_t Flush(const std::filesystem::path& path);
+}  // namespace tracing
@@ -0,0 +1,182 @@
+#include "websocket_session.h"
+
+#include <boost/asio/post.hpp>
+
+#include <utility>
+
+namespace http_server
+{
+    WebSocketSession::WebSocketSession(beast::tcp_stream&& stream, size_t queue_limit)
+        : ws_(std::move(stream))
+        , queue_limit_{ std::max<size_t>(queue_limit, 1) }
+    {}
+
+    void WebSocketSession::Accept(http::request<http::string_body>&& request)
+    {
+        net::dispatch(ws_.get_executor(), [self = shared_from_this(), request = std::move(request)]() mutable
+        {
+            // Таймауты WebSocket заменяют таймаут чтения HTTP-сессии
+            beast::get_lowest_layer(self->ws_).expires_never();
+            self->ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+            self->ws_.text(true);
+            self->ws_.async_accept(request, beast::bind_front_handler(&WebSocketSession::OnAccept, self));
+        });
+    }
+
+    void WebSocketSession::Reject(http::response<http::string_body, ArenaFields>&& response)
+    {
+        auto safe_response = std::make_shared<http::response<http::string_body, ArenaFields>>(std::move(response));
+        safe_response->keep_alive(false);
+        net::dispatch(ws_.get_executor(), [self = shared_from_this(), safe_response]
+        {
+            self->closed_.store(true, std::memory_order_relaxed);
+            http::async_write(beast::get_lowest_layer(self->ws_), *safe_response,
+                [self, safe_response](beast::error_code, std::size_t)
+                {
+                    beast::error_code ec;
+                    beast::get_lowest_layer(self->ws_).socket().shutdown(tcp::socket::shutdown_send, ec);
+                });
+        });
+    }
+
+    void WebSocketSession::Push(Frame frame, bool key_frame)
+    {
+        if (IsClosed())
+        {
+            return;
+        }
+        if (key_frame)
+        {
+            // Флаг снимается сразу, чтобы следующий тик не сериализовал лишний опорный кадр
+            needs_key_frame_.store(false, std::memory_order_relaxed);
+        }
+        net::post(ws_.get_executor(), [self = shared_from_this(), frame = std::move(frame), key_frame]() mutable
+        {
+            self->Enqueue(std::move(frame), key_frame);
+        });
+    }
+
+    void WebSocketSession::Close()
+    {
+        // Кадры, поставленные раньше, уже в очереди исполнителя и будут отправлены до закрытия
+        net::post(ws_.get_executor(), [self = shared_from_this()]
+        {
+            if (self->IsClosed())
+            {
+                return;
+            }
+            self->closed_.store(true, std::memory_order_relaxed);
+            self->closing_ = true;
+            self->Write();
+        });
+    }
+
+    void WebSocketSession::OnAccept(beast::error_code ec)
+    {
+        if (ec)
+        {
+            return Fail(ec, "websocket accept"sv);
+        }
+        accepted_ = true;
+        Read();
+        Write();
+    }
+
+    void WebSocketSession::Read()
+    {
+        // Клиент ничего не присылает, но чтение нужно для обработки ping/pong и закрытия соединения
+        ws_.async_read(read_buffer_, beast::bind_front_handler(&WebSocketSession::OnRead, shared_from_this()));
+    }
+
+    void WebSocketSession::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read)
+    {
+        if (ec == websocket::error::closed)
+        {
+            closed_.store(true, std::memory_order_relaxed);
+            return;
+        }
+        if (ec)
+        {
+            return Fail(ec, "websocket read"sv);
+        }
+        read_buffer_.consume(read_buffer_.size());
+        Read();
+    }
+
+    void WebSocketSession::Enqueue(Frame&& frame, bool key_frame)
+    {
+        if (IsClosed())
+        {
+            return;
+        }
+        if (key_frame)
+        {
+            Drop(queue_.size());
+            queue_.clear();
+        }
+        else if (NeedsKeyFrame())
+        {
+            // Без опорного кадра разностный кадр применить не к чему
+            return Drop(1);
+        }
+        else if (queue_.size() >= queue_limit_)
+        {
+            // Клиент не успевает читать: устаревшие кадры выбрасываются, а вместо них
+            // при следующем тике будет отправлен один опорный кадр
+            Drop(queue_.size() + 1);
+            queue_.clear();
+            needs_key_frame_.store(true, std::memory_order_relaxed);
+            return;
+        }
+        queue_.push_back(std::move(frame));
+        Write();
+    }
+
+    void WebSocketSession::Write()
+    {
+        if (!accepted_ || in_flight_)
+        {
+            return;
+        }
+        if (queue_.empty())
+        {
+            if (std::exchange(closing_, false))
+            {
+                // Ошибку закрытия сообщит ожидающее чтение
+                ws_.async_close(websocket::close_code::normal, [self = shared_from_this()](beast::error_code)
+                {
+                });
+            }
+            return;
+        }
+        in_flight_ = std::move(queue_.front());
+        queue_.pop_front();
+        ws_.async_write(net::buffer(*in_flight_),
+            beast::bind_front_handler(&WebSocketSession::OnWrite, shared_from_this()));
+    }
+
+    void WebSocketSession::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written)
+    {
+        in_flight_.reset();
+        if (ec)
+        {
+            return Fail(ec, "websocket write"sv);
+        }
+        Write();
+    }
+
+    void WebSocketSession::Drop(size_t frames) noexcept
+    {
+        dropped_frames_.fetch_add(frames, std::memory_order_relaxed);
+    }
+
+    void WebSocketSession::Fail(beast::error_code ec, std::string_view what)
+    {
+        closed_.store(true, std::memory_order_relaxed);
+        queue_.clear();
+        if (ec != net::error::operation_aborted && ec != beast::error::timeout)
+        {
+            ReportError(ec, what);
+        }
+    }
+}  // namespace http_server
@@ -0,0 +1,83 @@
+#pragma once
+#include "http_server.h"
+
+#include <boost/beast/websocket.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace http_server
+{
+    namespace websocket = beast::websocket;
+
+    // Сессия WebSocket, через которую сервер рассылает клиенту кадры состояния.
+    // Кадр сериализуется один раз и разделяется между всеми подписчиками через shared_ptr.
+    // Очередь неотправленных кадров ограничена: при переполнении она очищается, и сессия
+    // пропускает разностные кадры, пока не получит опорный кадр с полным состоянием
+    class WebSocketSession : public std::enable_shared_from_this<WebSocketSession>
+    {
+    public:
+        using Frame = std::shared_ptr<const std::string>;
+
+        WebSocketSession(beast::tcp_stream&& stream, size_t queue_limit);
+
+        WebSocketSession(const WebSocketSession&) = delete;
+        WebSocketSession& operator=(const WebSocketSession&) = delete;
+
+        // Завершает рукопожатие по запросу Upgrade и начинает отправку кадров
+        void Accept(http::request<http::string_body>&& request);
+
+        // Отвечает на запрос Upgrade обычным HTTP-ответом и закрывает соединение
+        void Reject(http::response<http::string_body, ArenaFields>&& response);
+
+        // Ставит кадр в очередь отправки. Может вызываться из любого потока.
+        // Опорный кадр заменяет собой все ещё не отправленные кадры
+        void Push(Frame frame, bool key_frame);
+
+        // Закрывает соединение кадром Close с кодом normal после отправки кадров, уже поставленных в очередь.
+        // Может вызываться из любого потока
+        void Close();
+
+        // true после подключения и после переполнения очереди, пока не будет поставлен опорный кадр
+        bool NeedsKeyFrame() const noexcept
+        {
+            return needs_key_frame_.load(std::memory_order_relaxed);
+        }
+
+        bool IsClosed() const noexcept
+        {
+            return closed_.load(std::memory_order_relaxed);
+        }
+
+        std::uint64_t GetDroppedFrames() const noexcept
+        {
+            return dropped_frames_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        websocket::stream<beast::tcp_stream> ws_;
+        beast::flat_buffer read_buffer_;
+        std::deque<Frame> queue_;
+        Frame in_flight_;
+        size_t queue_limit_;
+        bool accepted_ = false;
+        // Close отправляется, как только опустеет очередь кадров
+        bool closing_ = false;
+
+        std::atomic<bool> needs_key_frame_{ true };
+        std::atomic<bool> closed_{ false };
+        std::atomic<std::uint64_t> dropped_frames_{ 0 };
+
+        void OnAccept(beast::error_code ec);
+        void Read();
+        void OnRead(beast::error_code ec, std::size_t bytes_read);
+        void Enqueue(Frame&& frame, bool key_frame);
+        void Write();
+        void OnWrite(beast::error_code ec, std::size_t bytes_written);
+        void Drop(size_t frames) noexcept;
+        void Fail(beast::error_code ec, std::string_view what);
+    };
+}  // namespace http_server